@@ -0,0 +1,89 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <stdint.h>
+#include "Hal.h"
+
+// DEFERRED BINARY LOGGING
+// The control path only copies a fixed 16-byte record into a RAM ring. flush() (run as the lowest
+// priority scheduler task) formats and writes records to USB serial (stdout on the host) as the
+// port has room. Levels below ECU_LOG_LEVEL are removed at compile time, arguments included.
+//
+// Build flags:
+//   -D ECU_LOG_LEVEL=LOG_LEVEL_DEBUG  -> keep per-sample debug records (default: INFO)
+//   -D ECU_LOG_BINARY                -> flush raw framed records (decode with tools/decode_log.py)
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_NONE 3
+
+#ifndef ECU_LOG_LEVEL
+#define ECU_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Every loggable event. Append only: the numbers are the wire format (names in BinaryLog.cpp
+// and tools/decode_log.py must stay in the same order)
+enum LogEvent : uint8_t {
+    LogThrottle1 = 0, // a = raw ADC, b = pedal position (Q12)
+    LogThrottle2 = 1, // a = raw ADC, b = pedal position (Q12)
+    LogMotorCommand = 2, // a = torque sent, b = flags (brakeOK | throttleOK << 1 | BTO << 2 | DS << 3)
+    LogMotorStart = 3,
+    LogInitialStart = 4,
+    LogStartAborted = 5,
+    LogStartFault = 6,
+    LogShutdown = 7,
+    LogBTOSet = 8,
+    LogBTOReleased = 9,
+    LogTractionStart = 10, // a = slip (Q12), b = torque cap after the first cut (Q12)
+    LogTractionEnd = 11, // a = intervention length (us), b = peak slip (Q12)
+    LogFaultRaised = 12, // a = fault code, b = occurrences of that fault
+    LogNodeLost = 13, // a = CAN ID, b = StaleAction
+    LogNodeBack = 14, // a = CAN ID
+    LOG_EVENT_COUNT
+};
+
+// Fixed-size wire record (little endian)
+struct LogRecord {
+    uint32_t timestampUs;
+    uint8_t event;
+    uint8_t level;
+    uint16_t sequence; // Lets the decoder spot drops
+    int32_t a;
+    int32_t b;
+};
+
+static_assert(sizeof(LogRecord) == 16, "LogRecord wire size changed");
+
+constexpr uint8_t LOG_SYNC_0 = 0xEC;
+constexpr uint8_t LOG_SYNC_1 = 0x10;
+constexpr uint32_t LOG_RING_SIZE = 256;
+
+class BinaryLog {
+    public:
+        static void begin(Clock& clock); // -> Timestamp source, records before begin() read 0
+
+        // Hot path: timestamp + copy into the ring, counts a drop if the ring is full
+        static void record(uint8_t level, LogEvent event, int32_t a, int32_t b);
+
+        // Idle path: writes at most maxRecords, stopping early if the serial TX buffer is full
+        static uint16_t flush(uint16_t maxRecords);
+
+        static uint32_t dropped();
+
+        static const char* eventName(uint8_t event);
+};
+
+// Compile-time filtered entry points (a disabled level compiles to nothing)
+#define ECU_LOG(level, event, a, b) \
+    do { \
+        if((level) >= ECU_LOG_LEVEL) { \
+            BinaryLog::record((level), (event), (a), (b)); \
+        } \
+    } while(0)
+
+#define LOG_DEBUG(event, a, b) ECU_LOG(LOG_LEVEL_DEBUG, event, a, b)
+#define LOG_INFO(event, a, b) ECU_LOG(LOG_LEVEL_INFO, event, a, b)
+#define LOG_WARN(event, a, b) ECU_LOG(LOG_LEVEL_WARN, event, a, b)
+
+#endif
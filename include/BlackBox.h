@@ -0,0 +1,65 @@
+#ifndef BLACK_BOX_H
+#define BLACK_BOX_H
+
+#include <stdint.h>
+#include "CanTrace.h"
+
+// PRE-TRIGGER CAPTURE ("BLACK BOX")
+// A FrameTap that keeps the most recent records in a caller-provided power-of-two ring, so the
+// caller decides which RAM it lives in (DTCM, OCRAM via DMAMEM, PSRAM via EXTMEM). Recording is
+// one masked 20-byte copy per frame. trigger() marks the moment something went wrong; recording
+// goes on for the post-trigger tail and then the ring freezes until rearm(), so the snapshot holds
+// what led up to the trigger and what followed. The frozen snapshot can be read record by record
+// (USB) or as numbered 8-byte dump frames (CAN).
+
+constexpr uint8_t BLACK_BOX_REASON_SHUTDOWN = 0xFF; // Other reasons are fault codes
+constexpr uint8_t BLACK_BOX_REASON_MANUAL = 0xFE; // Dump requested before anything triggered
+constexpr uint32_t BLACK_BOX_MAX_RECORDS = 16384; // Keeps the dump frame index within u16
+constexpr uint8_t BLACK_BOX_DUMP_BYTES = 6; // Snapshot bytes per dump frame after the u16 index
+
+enum class BlackBoxState : uint8_t {
+    Recording = 0,
+    Triggered = 1, // Recording the post-trigger tail
+    Frozen = 2,
+};
+
+class BlackBox : public FrameTap {
+    private:
+        TraceRecord* records;
+        uint32_t mask;
+        uint32_t tailUs;
+
+        uint32_t head = 0; // Records written since rearm() (free running)
+        BlackBoxState state = BlackBoxState::Recording;
+        uint32_t triggerHead = 0;
+        uint32_t triggerUs = 0;
+        uint8_t reason = 0;
+
+    public:
+        // capacity must be a power of two <= BLACK_BOX_MAX_RECORDS
+        BlackBox(TraceRecord* storage, uint32_t capacity, uint32_t postTriggerUs);
+
+        void onFrame(const TraceRecord& record) override;
+
+        void trigger(uint8_t why, uint32_t nowUs); // -> Ignored unless recording
+
+        void rearm();
+
+        BlackBoxState getState() const;
+
+        uint8_t getReason() const;
+
+        uint32_t size() const; // -> Records in the snapshot
+
+        const TraceRecord& at(uint32_t index) const; // -> Oldest first
+
+        uint32_t triggerIndex() const; // -> Snapshot index of the first record after the trigger
+
+        uint32_t dumpFrames() const; // -> Header frame + snapshot bytes, 6 per frame
+
+        // Fills one 8-byte dump payload: [index(2), data(6)]. Frame 0 is [records(2), triggerIndex(2),
+        // reason, state]; the rest carry the raw TraceRecords back to back. False once index is past the end
+        bool encodeDumpFrame(uint16_t index, uint8_t* buf) const;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef BLOCK_LOGGER_H
+#define BLOCK_LOGGER_H
+
+#include <stdint.h>
+#include "CanTrace.h"
+#include "Hal.h"
+
+// ON-BOARD FRAME LOGGER (SD CARD ON THE CAR, A FILE ON THE HOST)
+// A FrameTap that packs TraceRecords into 512-byte sectors (12-byte header + 25 records) inside
+// two statically allocated buffers. onFrame() only copies the record; service() hands at most one
+// finished sector to the BlockStorage per call, and only when the storage is not busy, so neither
+// ever waits on the card. While one buffer is being written the other fills; if that one fills
+// up too, frames are counted as dropped (and noted in the next sector header) instead of waiting.
+// onFrame() and service() must run in the same context (the main loop).
+// Coverage: the logger records what the ECU reads, so with the acceptance filters on
+// (CAN_PROMISCUOUS false in main.cpp) a log holds only the routed IDs, the few extras the filter
+// plan lets through and our own TX, not the whole bus. Set CAN_PROMISCUOUS for full-bus logs.
+
+constexpr uint32_t LOG_SECTOR_SIZE = 512;
+constexpr uint32_t LOG_RECORDS_PER_SECTOR = 25;
+constexpr uint32_t LOG_BUFFER_SECTORS = 64; // 32 KiB per buffer: ~200 ms of card stall at 2x a saturated bus pair
+constexpr uint32_t LOG_SECTOR_MAGIC = 0x42554345; // "ECUB" little endian
+
+struct LogSectorHeader {
+    uint32_t magic;
+    uint32_t sequence; // Sector index since the logger started (== storage sector)
+    uint16_t records; // Valid records (< 25 only in a sector closed by flush())
+    uint16_t dropped; // Frames lost since the previous sector (saturates)
+};
+
+struct LogSector {
+    LogSectorHeader header;
+    TraceRecord records[LOG_RECORDS_PER_SECTOR];
+};
+
+static_assert(sizeof(LogSector) == LOG_SECTOR_SIZE, "LogSector must fill a sector exactly");
+
+struct BlockLogStats {
+    uint32_t frames = 0; // Records buffered
+    uint32_t dropped = 0; // Records lost (both buffers busy, storage full or not attached)
+    uint32_t sectorsWritten = 0;
+    uint32_t writeErrors = 0; // Sectors the storage refused (skipped, not retried)
+    bool full = false; // Ran past the preallocated area
+};
+
+class BlockLogger : public FrameTap {
+    private:
+        alignas(LOG_SECTOR_SIZE) LogSector buffers[2][LOG_BUFFER_SECTORS];
+
+        BlockStorage* storage = nullptr;
+
+        uint8_t fillBuffer = 0; // Buffer onFrame() appends to
+        uint32_t fillSector = 0;
+        uint32_t fillRecord = 0;
+        uint32_t sequence = 0; // Next sector header sequence
+        uint16_t droppedSinceSector = 0;
+
+        bool pending[2] = {false, false}; // Closed and waiting for service()
+        uint32_t pendingSectors[2] = {0, 0};
+        uint8_t writeBuffer = 0; // Oldest pending buffer
+        uint32_t writeIndex = 0; // Next sector of writeBuffer to hand to storage
+        uint32_t nextSector = 0; // Storage sector it goes to
+
+        BlockLogStats stats;
+
+        void drop();
+
+        void closeSector();
+
+        void closeBuffer();
+
+    public:
+        void attach(BlockStorage& storageIn);
+
+        void onFrame(const TraceRecord& record) override; // -> Copy only, never touches the storage
+
+        bool service(); // -> Writes one sector if one is ready and the storage is free
+
+        void flush(); // -> Closes the partly filled buffer so service() writes it out
+
+        bool idle() const; // -> Nothing waiting to be written
+
+        uint32_t pendingSectorCount() const;
+
+        const BlockLogStats& getStats() const;
+};
+
+#endif
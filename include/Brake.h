@@ -1,11 +1,14 @@
 #ifndef BRAKE_H
 #define BRAKE_H
 
-#include <Arduino.h>
+#include "Hal.h"
+#include "StreamFilter.h"
 
 class Brake {
     private:
-        int brakeVal;
+        int brakeVal; // Filtered, drives the light and brake-active state
+        int rawVal; // Unfiltered, so the wiring check is not delayed
+        StreamFilter<int, 8> filter{FilterConfig{FilterMode::Median, 3}};
         int timeErrorStart;
         bool brakeActive;
 
@@ -13,9 +16,11 @@ class Brake {
 
         int brakePin;
 
+        Clock& clock;
+        Gpio& gpio;
+
     public:
-        Brake();
-        Brake(int pin);
+        Brake(Clock& clockIn, Gpio& gpioIn);
 
         void updateValue(int data);
 
@@ -27,6 +32,8 @@ class Brake {
         int getBrakeErrorState();
         void updateLight();
 
+        void setFilter(const FilterConfig& config); // -> Takes effect on the next sample
+
 };
 
 #endif
\ No newline at end of file
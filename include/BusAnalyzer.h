@@ -0,0 +1,119 @@
+#ifndef BUS_ANALYZER_H
+#define BUS_ANALYZER_H
+
+#include <stdint.h>
+#include "Hal.h"
+
+// ONLINE BUS LOAD AND PER-ID TIMING
+// Every frame the ECU receives or transmits is counted against its (bus, ID) entry in a fixed
+// open-addressing table (multiplicative hash, linear probing, no deletion), so recording is O(1)
+// with no allocation: count, inter-arrival min/max/mean/jitter and the frame's exact length on the
+// wire. Bus load adds up those lengths (stuff bits worked out from the actual ID, data and CRC)
+// against the bit rate, per 100 ms window and since reset. IDs beyond the table's fill limit still
+// count toward the bus totals. The snapshot goes out as numbered 8-byte dump frames, read live:
+// parts of one entry can be a few frames apart. tools/bus_stats.py prints a dump.
+// Coverage: the analyzer only sees frames that reach software. With the acceptance filters on
+// (CAN_PROMISCUOUS false in main.cpp) that is the routed IDs, the few extra IDs the filter plan
+// lets through and our own TX, so foreign IDs are missing and the bus load reads low. setFiltered()
+// records that per bus and the dump reports it.
+
+constexpr uint8_t BUS_ANALYZER_BUSES = 2; // TRACE_BUS_COMS, TRACE_BUS_MOTOR
+constexpr uint16_t BUS_ANALYZER_SLOTS = 128; // Power of two
+constexpr uint16_t BUS_ANALYZER_MAX_ENTRIES = BUS_ANALYZER_SLOTS * 3 / 4; // Keeps probe chains short
+constexpr uint32_t BUS_ANALYZER_DEFAULT_BITRATE = 250000;
+constexpr uint32_t BUS_LOAD_WINDOW_US = 100000;
+constexpr uint8_t BUS_ANALYZER_ID_PARTS = 5; // Dump frames per ID entry
+constexpr uint8_t BUS_ANALYZER_BUS_PARTS = 3; // Dump frames per bus summary
+constexpr uint8_t BUS_ANALYZER_SUMMARY_SLOT = 0xFF; // Dump slot byte of the bus summaries
+constexpr uint16_t BUS_ANALYZER_DUMP_FRAMES = BUS_ANALYZER_BUSES * BUS_ANALYZER_BUS_PARTS
+    + BUS_ANALYZER_SLOTS * BUS_ANALYZER_ID_PARTS;
+
+static_assert((BUS_ANALYZER_SLOTS & (BUS_ANALYZER_SLOTS - 1)) == 0, "Slot count must be a power of two");
+static_assert(BUS_ANALYZER_SLOTS < BUS_ANALYZER_SUMMARY_SLOT, "Slot index must fit the dump slot byte");
+
+// Bits a classic frame occupies on the wire: SOF to CRC with its real stuff bits, then CRC
+// delimiter, ACK, EOF and intermission
+uint32_t StuffedFrameBits(const CAN_message_t& msg);
+
+struct BusIdStats {
+    uint32_t key = 0; // id | extended << 29 | bus << 30, BUS_ANALYZER_EMPTY if the slot is free
+    uint32_t count = 0;
+    uint32_t lastUs = 0;
+    uint32_t minGapUs = UINT32_MAX;
+    uint32_t maxGapUs = 0;
+    uint8_t len = 0; // DLC of the last frame
+    uint64_t gapSumUs = 0;
+    uint64_t gapSquareSum = 0; // For the jitter (standard deviation of the gaps)
+    uint64_t bits = 0;
+};
+
+struct BusLoadStats {
+    uint32_t bitrate = BUS_ANALYZER_DEFAULT_BITRATE;
+    uint32_t frames = 0;
+    uint32_t untracked = 0; // Frames of IDs that found the table full
+    uint64_t bits = 0; // Since reset
+    uint32_t windowStartUs = 0;
+    uint32_t windowBits = 0;
+    uint16_t loadBp = 0; // Last complete window, 0.01 % units
+    uint16_t peakLoadBp = 0;
+    bool filtered = false; // Acceptance filters drop unrouted IDs before they are counted
+};
+
+constexpr uint32_t BUS_ANALYZER_EMPTY = 0xFFFFFFFF;
+
+class BusAnalyzer {
+    private:
+        BusIdStats slots[BUS_ANALYZER_SLOTS];
+        BusLoadStats buses[BUS_ANALYZER_BUSES];
+        uint16_t entries = 0;
+        uint32_t resetUs = 0;
+
+        static uint16_t home(uint32_t key);
+
+        void rollWindow(BusLoadStats& load, uint32_t nowUs);
+
+    public:
+        BusAnalyzer();
+
+        void record(uint8_t bus, const CAN_message_t& msg, uint32_t nowUs); // -> O(1), bus >= BUSES ignored
+
+        void roll(uint32_t nowUs); // -> Closes load windows on quiet buses (call before reading loads)
+
+        void reset(uint32_t nowUs);
+
+        void setBitrate(uint8_t bus, uint32_t bitrate);
+
+        void setFiltered(uint8_t bus, bool filtered); // -> Kept across reset(), like the bitrate
+
+        const BusIdStats* find(uint8_t bus, uint32_t id, bool extended = false) const; // -> nullptr if unseen
+
+        const BusLoadStats& getLoad(uint8_t bus) const;
+
+        uint16_t averageLoadBp(uint8_t bus, uint32_t nowUs) const; // -> Since reset
+
+        uint16_t size() const; // -> IDs tracked
+
+        // Fills one 8-byte dump payload: [slot, part, data(6)]. Bus summaries first (slot 0xFF, part
+        // bus * BUS_ANALYZER_BUS_PARTS + n), then BUS_ANALYZER_ID_PARTS frames per table slot. False for free slots
+        bool encodeDumpFrame(uint16_t index, uint8_t* buf, uint32_t nowUs) const;
+};
+
+// Counts every frame written through it (the ECU's own TX share of the bus) into a BusAnalyzer
+class MeteredCanBus : public CanBus {
+    private:
+        CanBus* inner = nullptr;
+        BusAnalyzer& analyzer;
+        Clock& clock;
+        uint8_t busId;
+
+    public:
+        MeteredCanBus(BusAnalyzer& analyzerIn, uint8_t bus, Clock& clockIn);
+
+        void attach(CanBus& innerBus);
+
+        bool read(CAN_message_t& msg) override;
+
+        bool write(const CAN_message_t& msg) override;
+};
+
+#endif
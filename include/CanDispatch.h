@@ -0,0 +1,126 @@
+#ifndef CAN_DISPATCH_H
+#define CAN_DISPATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// COMPILE-TIME CAN ID -> HANDLER TABLE
+// Routes are written once as {id, handler} pairs. At compile time they are checked for duplicates
+// and expanded into a dense array indexed by (id - base), so routing a frame is one subtract,
+// one bounds check and one indirect call no matter how many IDs are handled. A table only takes
+// the routes inside its own span, so IDs far apart (control vs diagnostics) get one table each.
+
+// Largest dense table we allow: 4 bytes per slot, and on the Teensy const tables sit in DTCM
+constexpr uint32_t MAX_DISPATCH_SPAN = 256;
+
+template<typename Handler>
+struct CanRoute {
+    uint32_t id;
+    Handler handler;
+};
+
+// Smallest ID in a route list within [from, below) (below if there is none)
+template<typename Handler, size_t N>
+constexpr uint32_t MinRouteId(const CanRoute<Handler> (&routes)[N], uint32_t from = 0, uint32_t below = UINT32_MAX) {
+    uint32_t lowest = below;
+    for(size_t i = 0; i < N; i++) {
+        if(routes[i].id >= from && routes[i].id < below && routes[i].id < lowest) {
+            lowest = routes[i].id;
+        }
+    }
+    return lowest;
+}
+
+// Largest ID in a route list within [from, below) (from if there is none)
+template<typename Handler, size_t N>
+constexpr uint32_t MaxRouteId(const CanRoute<Handler> (&routes)[N], uint32_t from = 0, uint32_t below = UINT32_MAX) {
+    uint32_t highest = from;
+    for(size_t i = 0; i < N; i++) {
+        if(routes[i].id >= from && routes[i].id < below && routes[i].id > highest) {
+            highest = routes[i].id;
+        }
+    }
+    return highest;
+}
+
+// True if no ID appears twice in the route list
+template<typename Handler, size_t N>
+constexpr bool RoutesAreUnique(const CanRoute<Handler> (&routes)[N]) {
+    for(size_t i = 0; i < N; i++) {
+        for(size_t j = i + 1; j < N; j++) {
+            if(routes[i].id == routes[j].id) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// True if every route actually has a handler attached
+template<typename Handler, size_t N>
+constexpr bool RoutesAreComplete(const CanRoute<Handler> (&routes)[N]) {
+    for(size_t i = 0; i < N; i++) {
+        if(routes[i].handler == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if the route list handles the given ID
+template<typename Handler, size_t N>
+constexpr bool RoutesContain(const CanRoute<Handler> (&routes)[N], uint32_t id) {
+    for(size_t i = 0; i < N; i++) {
+        if(routes[i].id == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// True if the route list handles exactly the given IDs, no more and no fewer
+template<typename Handler, size_t N, size_t M>
+constexpr bool RoutesMatch(const CanRoute<Handler> (&routes)[N], const uint32_t (&ids)[M]) {
+    for(size_t i = 0; i < M; i++) {
+        if(!RoutesContain(routes, ids[i])) {
+            return false;
+        }
+    }
+    for(size_t i = 0; i < N; i++) {
+        bool listed = false;
+        for(size_t j = 0; j < M; j++) {
+            listed = listed || routes[i].id == ids[j];
+        }
+        if(!listed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Dense lookup table built from the routes in [base, base + Span) (unhandled slots hold nullptr)
+template<typename Handler, uint32_t Span>
+struct CanDispatchTable {
+    static_assert(Span > 0 && Span <= MAX_DISPATCH_SPAN, "CAN dispatch table span out of range");
+
+    uint32_t base;
+    Handler handlers[Span];
+
+    template<size_t N>
+    constexpr CanDispatchTable(const CanRoute<Handler> (&routes)[N], uint32_t baseId)
+        : base(baseId), handlers{} {
+        for(size_t i = 0; i < N; i++) {
+            if((routes[i].id - baseId) < Span) {
+                handlers[routes[i].id - baseId] = routes[i].handler;
+            }
+        }
+    }
+
+    // Returns the handler for an ID or nullptr if the ID is not routed
+    constexpr Handler lookup(uint32_t id) const {
+        // Unsigned wrap sends IDs below base out of range too
+        return ((id - base) < Span) ? handlers[id - base] : nullptr;
+    }
+};
+
+#endif
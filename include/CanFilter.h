@@ -0,0 +1,132 @@
+#ifndef CAN_FILTER_H
+#define CAN_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "CanDispatch.h"
+
+// COMPILE-TIME ACCEPTANCE FILTERS FROM A ROUTE TABLE
+// A CAN controller filter is an (id, mask) pair: it accepts every ID that matches id on the mask
+// bits. The routed IDs start as one exact filter each; two filters with the same mask that differ
+// in one masked bit are merged into one (still exact), like minimising a logic function. Only if
+// that leaves more filters than the controller has are the closest pairs merged inexactly, and
+// extraIds says how many unrouted IDs get through as a result (route() still drops them).
+// Standard (11-bit) IDs only, which is all the route table holds.
+
+constexpr uint32_t CAN_STANDARD_ID_MASK = 0x7FF;
+
+struct AcceptanceFilter {
+    uint32_t id;
+    uint32_t mask;
+};
+
+constexpr bool FilterAccepts(const AcceptanceFilter& filter, uint32_t id) {
+    return ((id ^ filter.id) & filter.mask) == 0;
+}
+
+// IDs one filter accepts (2 ^ don't-care bits)
+constexpr uint32_t FilterSpan(const AcceptanceFilter& filter) {
+    uint32_t span = 1;
+    for(uint32_t bit = 1; bit <= CAN_STANDARD_ID_MASK; bit <<= 1) {
+        if((filter.mask & bit) == 0) {
+            span <<= 1;
+        }
+    }
+    return span;
+}
+
+// Smallest filter that accepts everything both filters accept
+constexpr AcceptanceFilter MergeFilters(const AcceptanceFilter& a, const AcceptanceFilter& b) {
+    const uint32_t mask = a.mask & b.mask & ~(a.id ^ b.id);
+    return {a.id & mask, mask};
+}
+
+template<size_t MaxFilters>
+struct AcceptancePlan {
+    AcceptanceFilter filters[MaxFilters] = {};
+    uint8_t count = 0;
+    uint16_t extraIds = 0; // Unrouted standard IDs the filters let through
+    bool standardOnly = true; // False if a route ID doesn't fit 11 bits
+
+    constexpr bool accepts(uint32_t id) const {
+        for(uint8_t i = 0; i < count; i++) {
+            if(FilterAccepts(filters[i], id)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+template<size_t MaxFilters, typename Handler, size_t N>
+constexpr AcceptancePlan<MaxFilters> MakeAcceptancePlan(const CanRoute<Handler> (&routes)[N]) {
+    static_assert(MaxFilters > 0, "Acceptance plan needs at least one filter");
+
+    AcceptanceFilter work[N] = {};
+    size_t count = N;
+    AcceptancePlan<MaxFilters> plan;
+    for(size_t i = 0; i < N; i++) {
+        work[i] = {routes[i].id & CAN_STANDARD_ID_MASK, CAN_STANDARD_ID_MASK};
+        plan.standardOnly = plan.standardOnly && routes[i].id <= CAN_STANDARD_ID_MASK;
+    }
+
+    // Exact merges until none is left
+    for(bool merged = true; merged;) {
+        merged = false;
+        for(size_t i = 0; i < count && !merged; i++) {
+            for(size_t j = i + 1; j < count && !merged; j++) {
+                const uint32_t diff = (work[i].id ^ work[j].id) & work[i].mask;
+                if(work[i].mask == work[j].mask && diff != 0 && (diff & (diff - 1)) == 0) {
+                    work[i] = MergeFilters(work[i], work[j]);
+                    work[j] = work[--count];
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    // Over budget: merge the pair that lets through the fewest new IDs
+    while(count > MaxFilters) {
+        size_t bestI = 0;
+        size_t bestJ = 1;
+        int32_t bestCost = INT32_MAX;
+        for(size_t i = 0; i < count; i++) {
+            for(size_t j = i + 1; j < count; j++) {
+                // Negative when the two overlap
+                const int32_t cost = static_cast<int32_t>(FilterSpan(MergeFilters(work[i], work[j])))
+                    - static_cast<int32_t>(FilterSpan(work[i])) - static_cast<int32_t>(FilterSpan(work[j]));
+                if(cost < bestCost) {
+                    bestCost = cost;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        work[bestI] = MergeFilters(work[bestI], work[bestJ]);
+        work[bestJ] = work[--count];
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        plan.filters[i] = work[i];
+    }
+    plan.count = static_cast<uint8_t>(count);
+    for(uint32_t id = 0; id <= CAN_STANDARD_ID_MASK; id++) {
+        if(plan.accepts(id) && !RoutesContain(routes, id)) {
+            plan.extraIds++;
+        }
+    }
+    return plan;
+}
+
+// True if every routed ID passes the filters (a rejected one could never be handled)
+template<size_t MaxFilters, typename Handler, size_t N>
+constexpr bool PlanAcceptsRoutes(const AcceptancePlan<MaxFilters>& plan, const CanRoute<Handler> (&routes)[N]) {
+    for(size_t i = 0; i < N; i++) {
+        if(!plan.accepts(routes[i].id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
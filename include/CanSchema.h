@@ -0,0 +1,506 @@
+#ifndef CAN_SCHEMA_H
+#define CAN_SCHEMA_H
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "Hal.h"
+
+// CAN MESSAGE SCHEMA
+// One struct per payload layout the ECU sends or receives. Each field is a CanField (little-endian
+// integer at a fixed byte offset), so encode/decode inline to plain byte moves. The static_asserts
+// below each message check that its fields fit its length and do not overlap.
+// TX frames are preallocated TxFrame<Message> objects: the ID and DLC are set once, unused bytes
+// stay zero, and send paths only write the fields.
+// The profiler dump (ProfileDataId) keeps its own encoder in Profiler.cpp.
+
+constexpr uint8_t CAN_FRAME_LEN = 8; // Every ECU frame goes out with a full 8-byte DLC
+constexpr uint8_t CANFD_FRAME_LEN = 64;
+
+template<typename T, uint8_t Offset>
+struct CanField {
+    static_assert(std::is_integral<T>::value, "CAN fields are little-endian integers");
+
+    using Type = T;
+    static constexpr uint8_t BEGIN = Offset;
+    static constexpr uint8_t END = Offset + sizeof(T);
+
+    static inline T get(const uint8_t* buf) {
+        typename std::make_unsigned<T>::type value = 0;
+        for(uint8_t i = 0; i < sizeof(T); i++) {
+            value |= static_cast<typename std::make_unsigned<T>::type>(buf[Offset + i]) << (8 * i);
+        }
+        return static_cast<T>(value);
+    }
+
+    static inline void put(uint8_t* buf, T value) {
+        const typename std::make_unsigned<T>::type raw = static_cast<typename std::make_unsigned<T>::type>(value);
+        for(uint8_t i = 0; i < sizeof(T); i++) {
+            buf[Offset + i] = static_cast<uint8_t>(raw >> (8 * i));
+        }
+    }
+};
+
+//LAYOUT CHECKS
+template<uint8_t Len>
+constexpr bool FieldsFit() {
+    return Len <= CAN_FRAME_LEN;
+}
+
+template<uint8_t Len, typename First, typename... Rest>
+constexpr bool FieldsFit() {
+    return First::END <= Len && FieldsFit<Len, Rest...>();
+}
+
+template<typename Field>
+constexpr bool FieldClearOf() {
+    return true;
+}
+
+template<typename Field, typename Other, typename... Rest>
+constexpr bool FieldClearOf() {
+    return (Field::END <= Other::BEGIN || Other::END <= Field::BEGIN) && FieldClearOf<Field, Rest...>();
+}
+
+template<typename... Fields>
+struct FieldsDisjoint;
+
+template<>
+struct FieldsDisjoint<> {
+    static constexpr bool value = true;
+};
+
+template<typename First, typename... Rest>
+struct FieldsDisjoint<First, Rest...> {
+    static constexpr bool value = FieldClearOf<First, Rest...>() && FieldsDisjoint<Rest...>::value;
+};
+
+template<uint8_t Len, typename... Fields>
+constexpr bool LayoutIsValid() {
+    return FieldsFit<Len, Fields...>() && FieldsDisjoint<Fields...>::value;
+}
+
+//PAYLOAD-LESS (HealthCheckId, ThrottleMinId, ThrottleMaxId, ProfileRequestId)
+struct EmptyMsg {
+    static constexpr uint8_t LEN = 0;
+
+    static EmptyMsg decode(const uint8_t*) {
+        return {};
+    }
+
+    void encode(uint8_t*) const {}
+};
+
+//ONE SIGNED SENSOR READING (Throttle1PositionId, Throttle2PositionId, BrakePressureId)
+struct SensorValueMsg {
+    using Value = CanField<int32_t, 0>;
+    static constexpr uint8_t LEN = 4;
+
+    int32_t value;
+
+    static SensorValueMsg decode(const uint8_t* buf) {
+        return {Value::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Value::put(buf, value);
+    }
+};
+
+static_assert(LayoutIsValid<SensorValueMsg::LEN, SensorValueMsg::Value>(), "SensorValueMsg layout");
+
+//ONE STATE BYTE (StartSwitchId, DriveModeId, DCFId, DCRId, DCTId)
+struct StateByteMsg {
+    using Value = CanField<uint8_t, 0>;
+    static constexpr uint8_t LEN = 1;
+
+    uint8_t value;
+
+    static StateByteMsg decode(const uint8_t* buf) {
+        return {Value::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Value::put(buf, value);
+    }
+};
+
+static_assert(LayoutIsValid<StateByteMsg::LEN, StateByteMsg::Value>(), "StateByteMsg layout");
+
+//DASH STATUS (DriveStateId)
+struct DriveStateMsg {
+    using DriveState = CanField<uint8_t, 0>;
+    using BrakeOverride = CanField<uint8_t, 1>;
+    using DriveMode = CanField<uint8_t, 2>;
+    using StartFault = CanField<uint8_t, 3>;
+    using CarIsGood = CanField<uint8_t, 4>;
+    static constexpr uint8_t LEN = 5;
+
+    uint8_t driveState;
+    uint8_t brakeOverride;
+    uint8_t driveMode;
+    uint8_t startFault;
+    uint8_t carIsGood;
+
+    static DriveStateMsg decode(const uint8_t* buf) {
+        return {DriveState::get(buf), BrakeOverride::get(buf), DriveMode::get(buf), StartFault::get(buf),
+                CarIsGood::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        DriveState::put(buf, driveState);
+        BrakeOverride::put(buf, brakeOverride);
+        DriveMode::put(buf, driveMode);
+        StartFault::put(buf, startFault);
+        CarIsGood::put(buf, carIsGood);
+    }
+};
+
+static_assert(LayoutIsValid<DriveStateMsg::LEN, DriveStateMsg::DriveState, DriveStateMsg::BrakeOverride,
+                            DriveStateMsg::DriveMode, DriveStateMsg::StartFault, DriveStateMsg::CarIsGood>(),
+              "DriveStateMsg layout");
+
+//FAULT REPORT TO THE DASH (FaultId)
+struct FaultMsg {
+    using Code = CanField<uint8_t, 0>;
+    static constexpr uint8_t LEN = 1;
+
+    uint8_t code;
+
+    static FaultMsg decode(const uint8_t* buf) {
+        return {Code::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Code::put(buf, code);
+    }
+};
+
+static_assert(LayoutIsValid<FaultMsg::LEN, FaultMsg::Code>(), "FaultMsg layout");
+
+//RMS COMMAND MESSAGE (InverterCommandId / ControlCommandId)
+struct InverterCommandMsg {
+    using Torque = CanField<int16_t, 0>; // Nm * 10
+    using Speed = CanField<int16_t, 2>; // rpm (speed mode only)
+    using Direction = CanField<uint8_t, 4>;
+    using Enable = CanField<uint8_t, 5>; // Bit 0 = inverter enable
+    using TorqueLimit = CanField<int16_t, 6>; // Nm * 10, 0 = EEPROM default
+    static constexpr uint8_t LEN = 8;
+
+    int16_t torque;
+    int16_t speed;
+    uint8_t direction;
+    uint8_t enable;
+    int16_t torqueLimit;
+
+    static InverterCommandMsg decode(const uint8_t* buf) {
+        return {Torque::get(buf), Speed::get(buf), Direction::get(buf), Enable::get(buf), TorqueLimit::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Torque::put(buf, torque);
+        Speed::put(buf, speed);
+        Direction::put(buf, direction);
+        Enable::put(buf, enable);
+        TorqueLimit::put(buf, torqueLimit);
+    }
+};
+
+static_assert(LayoutIsValid<InverterCommandMsg::LEN, InverterCommandMsg::Torque, InverterCommandMsg::Speed,
+                            InverterCommandMsg::Direction, InverterCommandMsg::Enable,
+                            InverterCommandMsg::TorqueLimit>(),
+              "InverterCommandMsg layout");
+
+//RMS PARAMETER READ/WRITE (InverterParameterId)
+struct InverterParameterMsg {
+    using Address = CanField<uint16_t, 0>;
+    using Write = CanField<uint8_t, 2>; // 1 = write, 0 = read
+    using Data = CanField<uint16_t, 4>;
+    static constexpr uint8_t LEN = 6;
+
+    uint16_t address;
+    uint8_t write;
+    uint16_t data;
+
+    static InverterParameterMsg decode(const uint8_t* buf) {
+        return {Address::get(buf), Write::get(buf), Data::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Address::put(buf, address);
+        Write::put(buf, write);
+        Data::put(buf, data);
+    }
+};
+
+static_assert(LayoutIsValid<InverterParameterMsg::LEN, InverterParameterMsg::Address, InverterParameterMsg::Write,
+                            InverterParameterMsg::Data>(),
+              "InverterParameterMsg layout");
+
+//RMS MOTOR POSITION BROADCAST (InverterMotorPositionId)
+struct MotorPositionMsg {
+    using Angle = CanField<int16_t, 0>; // deg * 10
+    using Speed = CanField<int16_t, 2>; // rpm
+    using ElectricalFrequency = CanField<int16_t, 4>; // Hz * 10
+    using ResolverDelta = CanField<int16_t, 6>; // deg * 10
+    static constexpr uint8_t LEN = 8;
+
+    int16_t angle;
+    int16_t speed;
+    int16_t electricalFrequency;
+    int16_t resolverDelta;
+
+    static MotorPositionMsg decode(const uint8_t* buf) {
+        return {Angle::get(buf), Speed::get(buf), ElectricalFrequency::get(buf), ResolverDelta::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Angle::put(buf, angle);
+        Speed::put(buf, speed);
+        ElectricalFrequency::put(buf, electricalFrequency);
+        ResolverDelta::put(buf, resolverDelta);
+    }
+};
+
+static_assert(LayoutIsValid<MotorPositionMsg::LEN, MotorPositionMsg::Angle, MotorPositionMsg::Speed,
+                            MotorPositionMsg::ElectricalFrequency, MotorPositionMsg::ResolverDelta>(),
+              "MotorPositionMsg layout");
+
+//AXLE WHEEL SPEEDS (FrontWheelSpeedId, RearWheelSpeedId)
+struct WheelSpeedMsg {
+    using Left = CanField<int16_t, 0>; // rpm
+    using Right = CanField<int16_t, 2>; // rpm
+    static constexpr uint8_t LEN = 4;
+
+    int16_t left;
+    int16_t right;
+
+    static WheelSpeedMsg decode(const uint8_t* buf) {
+        return {Left::get(buf), Right::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Left::put(buf, left);
+        Right::put(buf, right);
+    }
+};
+
+static_assert(LayoutIsValid<WheelSpeedMsg::LEN, WheelSpeedMsg::Left, WheelSpeedMsg::Right>(), "WheelSpeedMsg layout");
+
+//IMU AXES (ImuAccelId, ImuGyroId; scaling in ImuFusion.h)
+struct ImuAxesMsg {
+    using X = CanField<int16_t, 0>;
+    using Y = CanField<int16_t, 2>;
+    using Z = CanField<int16_t, 4>;
+    static constexpr uint8_t LEN = 6;
+
+    int16_t x;
+    int16_t y;
+    int16_t z;
+
+    static ImuAxesMsg decode(const uint8_t* buf) {
+        return {X::get(buf), Y::get(buf), Z::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        X::put(buf, x);
+        Y::put(buf, y);
+        Z::put(buf, z);
+    }
+};
+
+static_assert(LayoutIsValid<ImuAxesMsg::LEN, ImuAxesMsg::X, ImuAxesMsg::Y, ImuAxesMsg::Z>(), "ImuAxesMsg layout");
+
+//SCHEDULER DIAGNOSTICS (SchedulerStatsId, saturating counters)
+struct SchedulerStatsMsg {
+    using Task = CanField<uint8_t, 0>;
+    using Overruns = CanField<uint8_t, 1>;
+    using MaxJitterUs = CanField<uint16_t, 2>;
+    using WcetUs = CanField<uint16_t, 4>;
+    using Runs = CanField<uint16_t, 6>; // Wraps
+    static constexpr uint8_t LEN = 8;
+
+    uint8_t task;
+    uint8_t overruns;
+    uint16_t maxJitterUs;
+    uint16_t wcetUs;
+    uint16_t runs;
+
+    static SchedulerStatsMsg decode(const uint8_t* buf) {
+        return {Task::get(buf), Overruns::get(buf), MaxJitterUs::get(buf), WcetUs::get(buf), Runs::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Task::put(buf, task);
+        Overruns::put(buf, overruns);
+        MaxJitterUs::put(buf, maxJitterUs);
+        WcetUs::put(buf, wcetUs);
+        Runs::put(buf, runs);
+    }
+};
+
+static_assert(LayoutIsValid<SchedulerStatsMsg::LEN, SchedulerStatsMsg::Task, SchedulerStatsMsg::Overruns,
+                            SchedulerStatsMsg::MaxJitterUs, SchedulerStatsMsg::WcetUs, SchedulerStatsMsg::Runs>(),
+              "SchedulerStatsMsg layout");
+
+//FAULT SUMMARY: [activeMask(2), latchedMask(2), occurrences(2), lastCode] (masks by FaultIndex)
+struct FaultSummaryMsg {
+    using ActiveMask = CanField<uint16_t, 0>;
+    using LatchedMask = CanField<uint16_t, 2>;
+    using Occurrences = CanField<uint16_t, 4>; // Wraps
+    using LastCode = CanField<uint8_t, 6>;
+    static constexpr uint8_t LEN = 7;
+
+    uint16_t activeMask;
+    uint16_t latchedMask;
+    uint16_t occurrences;
+    uint8_t lastCode;
+
+    static FaultSummaryMsg decode(const uint8_t* buf) {
+        return {ActiveMask::get(buf), LatchedMask::get(buf), Occurrences::get(buf), LastCode::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        ActiveMask::put(buf, activeMask);
+        LatchedMask::put(buf, latchedMask);
+        Occurrences::put(buf, occurrences);
+        LastCode::put(buf, lastCode);
+    }
+};
+
+static_assert(LayoutIsValid<FaultSummaryMsg::LEN, FaultSummaryMsg::ActiveMask, FaultSummaryMsg::LatchedMask,
+                            FaultSummaryMsg::Occurrences, FaultSummaryMsg::LastCode>(),
+              "FaultSummaryMsg layout");
+
+//LIVENESS: [alive(2), lostSinceBoot(2), flags] (bits in heartbeat policy order, flags: limp | noStart << 1)
+struct LivenessMsg {
+    using Alive = CanField<uint16_t, 0>;
+    using Lost = CanField<uint16_t, 2>;
+    using Flags = CanField<uint8_t, 4>;
+    static constexpr uint8_t LEN = 5;
+
+    uint16_t alive;
+    uint16_t lost;
+    uint8_t flags;
+
+    static LivenessMsg decode(const uint8_t* buf) {
+        return {Alive::get(buf), Lost::get(buf), Flags::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Alive::put(buf, alive);
+        Lost::put(buf, lost);
+        Flags::put(buf, flags);
+    }
+};
+
+static_assert(LayoutIsValid<LivenessMsg::LEN, LivenessMsg::Alive, LivenessMsg::Lost, LivenessMsg::Flags>(),
+              "LivenessMsg layout");
+
+//ECU STATE SNAPSHOT (logged on TRACE_BUS_ECU, not sent): [torque(2), pedal(2), activeFaults(2), flags, mode]
+//flags: driveState | BTO << 1 | limp << 2 | throttleOK << 3 | brakeOK << 4
+struct EcuStateMsg {
+    using Torque = CanField<int16_t, 0>;
+    using Pedal = CanField<uint16_t, 2>; // Q12
+    using ActiveFaults = CanField<uint16_t, 4>;
+    using Flags = CanField<uint8_t, 6>;
+    using DriveMode = CanField<uint8_t, 7>;
+    static constexpr uint8_t LEN = 8;
+
+    int16_t torque;
+    uint16_t pedal;
+    uint16_t activeFaults;
+    uint8_t flags;
+    uint8_t driveMode;
+
+    static EcuStateMsg decode(const uint8_t* buf) {
+        return {Torque::get(buf), Pedal::get(buf), ActiveFaults::get(buf), Flags::get(buf), DriveMode::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Torque::put(buf, torque);
+        Pedal::put(buf, pedal);
+        ActiveFaults::put(buf, activeFaults);
+        Flags::put(buf, flags);
+        DriveMode::put(buf, driveMode);
+    }
+};
+
+static_assert(LayoutIsValid<EcuStateMsg::LEN, EcuStateMsg::Torque, EcuStateMsg::Pedal, EcuStateMsg::ActiveFaults,
+                            EcuStateMsg::Flags, EcuStateMsg::DriveMode>(),
+              "EcuStateMsg layout");
+
+//CAN FD SENSOR BATCH (SensorBatchId on CAN3): this header, then `count` SensorSampleMsg back to back,
+//oldest first. Samples carry the classic ID they replace, so the ECU routes each one like that frame
+struct SensorBatchMsg {
+    using Sequence = CanField<uint8_t, 0>; // Free running, lets the receiver count lost batches
+    using Count = CanField<uint8_t, 1>;
+    static constexpr uint8_t LEN = 4; // Bytes 2-3 reserved
+
+    uint8_t sequence;
+    uint8_t count;
+
+    static SensorBatchMsg decode(const uint8_t* buf) {
+        return {Sequence::get(buf), Count::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        Sequence::put(buf, sequence);
+        Count::put(buf, count);
+    }
+};
+
+static_assert(LayoutIsValid<SensorBatchMsg::LEN, SensorBatchMsg::Sequence, SensorBatchMsg::Count>(),
+              "SensorBatchMsg layout");
+
+//ONE SAMPLE IN A SENSOR BATCH: [ageUs(2), id(2), value(2)]. ageUs is how long before the batch was
+//queued the sample was taken (the receiver subtracts it from its receive time)
+struct SensorSampleMsg {
+    using AgeUs = CanField<uint16_t, 0>;
+    using Id = CanField<uint16_t, 2>; // Throttle1PositionId, Throttle2PositionId or BrakePressureId
+    using Value = CanField<int16_t, 4>;
+    static constexpr uint8_t LEN = 6;
+
+    uint16_t ageUs;
+    uint16_t id;
+    int16_t value;
+
+    static SensorSampleMsg decode(const uint8_t* buf) {
+        return {AgeUs::get(buf), Id::get(buf), Value::get(buf)};
+    }
+
+    void encode(uint8_t* buf) const {
+        AgeUs::put(buf, ageUs);
+        Id::put(buf, id);
+        Value::put(buf, value);
+    }
+};
+
+static_assert(LayoutIsValid<SensorSampleMsg::LEN, SensorSampleMsg::AgeUs, SensorSampleMsg::Id,
+                            SensorSampleMsg::Value>(),
+              "SensorSampleMsg layout");
+
+constexpr uint8_t SENSOR_BATCH_MAX_SAMPLES = (CANFD_FRAME_LEN - SensorBatchMsg::LEN) / SensorSampleMsg::LEN; // 10
+
+//PREALLOCATED TX FRAME FOR ONE MESSAGE TYPE
+template<typename Message>
+class TxFrame {
+    static_assert(Message::LEN <= CAN_FRAME_LEN, "Message does not fit a classic CAN frame");
+
+    private:
+        CAN_message_t frame;
+
+    public:
+        explicit TxFrame(uint32_t id) {
+            frame.id = id;
+            frame.len = CAN_FRAME_LEN;
+            memset(frame.buf, 0, sizeof(frame.buf));
+        }
+
+        const CAN_message_t& pack(const Message& message) {
+            message.encode(frame.buf);
+            return frame;
+        }
+};
+
+#endif
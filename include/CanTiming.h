@@ -0,0 +1,55 @@
+#ifndef CAN_TIMING_H
+#define CAN_TIMING_H
+
+#include <stdint.h>
+
+// CAN FRAME LENGTHS ON THE WIRE
+// Worst-case bit counts (every stuff bit that can occur does) for classic CAN 2.0 and CAN FD
+// frames, used to turn frame counts into bus time. The classic formula is the usual
+// 47 + 8n + floor((34 + 8n - 1) / 4), with 20 more bits (and their stuffing) for a 29-bit ID. An FD frame with bit rate switching has an arbitration
+// part and a trailer at the nominal rate and everything from ESI to the CRC at the data rate.
+
+constexpr uint8_t CANFD_DLC_SIZES[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+
+// Smallest FD payload size that holds bytes (FD lengths above 8 come in fixed steps)
+constexpr uint8_t FdPayloadLen(uint8_t bytes) {
+    for(uint8_t size : CANFD_DLC_SIZES) {
+        if(size >= bytes) {
+            return size;
+        }
+    }
+    return 64;
+}
+
+constexpr uint32_t ClassicFrameBits(uint8_t len) {
+    return 47 + 8 * len + (34 + 8 * len - 1) / 4;
+}
+
+constexpr uint32_t ClassicExtendedFrameBits(uint8_t len) {
+    return 67 + 8 * len + (54 + 8 * len - 1) / 4;
+}
+
+// SOF..BRS with worst-case stuffing, then CRC delimiter, ACK, EOF and intermission
+constexpr uint32_t FdNominalBits() {
+    return 17 + 4 + 13;
+}
+
+// ESI, DLC and data with dynamic stuffing, stuff count, CRC and its fixed stuff bits
+constexpr uint32_t FdDataBits(uint8_t len) {
+    return 5 + 8 * len + (5 + 8 * len - 1) / 4 + 4 + ((len > 16) ? 21 + 7 : 17 + 6);
+}
+
+constexpr uint32_t ClassicFrameNs(uint8_t len, uint32_t bitrate) {
+    return static_cast<uint32_t>(ClassicFrameBits(len) * 1000000000ULL / bitrate);
+}
+
+constexpr uint32_t FdFrameNs(uint8_t len, uint32_t nominalBitrate, uint32_t dataBitrate) {
+    return static_cast<uint32_t>(FdNominalBits() * 1000000000ULL / nominalBitrate
+                                 + FdDataBits(FdPayloadLen(len)) * 1000000000ULL / dataBitrate);
+}
+
+static_assert(ClassicFrameBits(8) == 135, "Classic worst case for 8 data bytes");
+static_assert(ClassicExtendedFrameBits(8) == 160, "Extended worst case for 8 data bytes");
+static_assert(FdPayloadLen(13) == 16 && FdPayloadLen(64) == 64, "FD length steps");
+
+#endif
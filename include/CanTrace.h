@@ -0,0 +1,85 @@
+#ifndef CAN_TRACE_H
+#define CAN_TRACE_H
+
+#include <stdint.h>
+#include "Hal.h"
+
+// CAN TRACE FORMAT + BUS TAP
+// A trace is a 16-byte TraceHeader followed by fixed 20-byte TraceRecords (little endian), one per
+// frame seen on either bus in either direction. TappedCanBus sits between the ECU and a real (or
+// simulated) bus and reports every frame it moves to a FrameTap, so recording needs no changes
+// in the ECU itself. Frames taken by the interrupt RX path bypass CanBus::read() and are not seen.
+
+constexpr uint8_t TRACE_BUS_COMS = 0;
+constexpr uint8_t TRACE_BUS_MOTOR = 1;
+constexpr uint8_t TRACE_BUS_ECU = 2; // ECU state snapshots (EcuStateMsg payload), never on a wire
+
+constexpr uint8_t TRACE_FLAG_EXTENDED = 0x01;
+constexpr uint8_t TRACE_FLAG_TX = 0x02; // Sent by the ECU (otherwise received)
+
+constexpr uint16_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8]; // "ECUTRACE"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t reserved;
+};
+
+struct TraceRecord {
+    uint32_t timestampUs;
+    uint32_t id;
+    uint8_t bus;
+    uint8_t flags;
+    uint8_t len;
+    uint8_t reserved;
+    uint8_t data[8];
+};
+
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader wire size changed");
+static_assert(sizeof(TraceRecord) == 20, "TraceRecord wire size changed");
+
+TraceHeader MakeTraceHeader();
+
+bool IsTraceHeader(const TraceHeader& header);
+
+TraceRecord MakeTraceRecord(uint8_t bus, bool transmitted, uint32_t timestampUs, const CAN_message_t& msg);
+
+CAN_message_t TraceRecordToMessage(const TraceRecord& record);
+
+// Receives every frame a TappedCanBus moves
+class FrameTap {
+    public:
+        virtual ~FrameTap() {}
+
+        virtual void onFrame(const TraceRecord& record) = 0;
+};
+
+// Hands every record to two taps (either may be nullptr)
+class FrameTapPair : public FrameTap {
+    private:
+        FrameTap* first;
+        FrameTap* second;
+
+    public:
+        FrameTapPair(FrameTap* firstTap, FrameTap* secondTap);
+
+        void onFrame(const TraceRecord& record) override;
+};
+
+class TappedCanBus : public CanBus {
+    private:
+        CanBus& inner;
+        Clock& clock;
+        FrameTap& tap;
+        uint8_t busId;
+
+    public:
+        TappedCanBus(CanBus& innerBus, uint8_t bus, Clock& clockIn, FrameTap& frameTap);
+
+        bool read(CAN_message_t& msg) override;
+
+        bool write(const CAN_message_t& msg) override;
+};
+
+#endif
@@ -1,42 +1,259 @@
 #ifndef ECU_H
 #define ECU_H
 
-#include "FlexCAN_T4.h"
-#include "Throttle.h"
+#include "BlackBox.h"
 #include "Brake.h"
-#include "BufferPacker.h"
+#include "BusAnalyzer.h"
+#include "CanDispatch.h"
+#include "CanFilter.h"
+#include "CanTrace.h"
+#include "CanSchema.h"
+#include "EcuIDs.h"
+#include "FaultManager.h"
+#include "Hal.h"
+#include "Heartbeat.h"
+#include "ImuFusion.h"
+#include "Profiler.h"
 #include "Reserved.h"
+#include "Scheduler.h"
+#include "SpscRing.h"
+#include "Throttle.h"
+#include "TractionControl.h"
+#include "TxScheduler.h"
+#include "TorqueMap.h"
 
 //THE ECU MONITORS EVERYTHING ABOUT THE CAR AND DECIDES WHAT SHOULD BE DONE
 
-class ECU {
-    private:
+// Receive backlog statistics for one bus (readable at runtime)
+struct BusRxStats {
+    uint32_t framesRead = 0;
+    uint16_t highWater = 0; // Most frames drained from this bus in a single run() pass
+    uint32_t budgetExhausted = 0; // Passes that stopped on the drain budget with a frame left unread
+    uint32_t ringDrops = 0; // Frames the ISR dropped because this bus's ring was full (interrupt mode)
+};
 
+// CAN FD sensor batch counters (readable at runtime)
+struct SensorBatchStats {
+    uint32_t batches = 0;
+    uint32_t samples = 0; // Routed as their classic frames
+    uint32_t rejected = 0; // Unknown sample IDs, counts past the frame end, wrong frame IDs
+    uint32_t lost = 0; // Batches missing from the sequence
+};
 
-        //COMS VARS
-        FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> comsCAN;
-        FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> motorCAN;
-        CAN_message_t rmsg;
-        CAN_message_t motorCommand;
+// How run() takes frames off the buses
+enum class RxMode : uint8_t {
+    Polled, // One read per bus per pass
+    Drain, // Read both buses round-robin until empty or out of budget
+    Interrupt // FlexCAN callbacks push into SPSC rings, run() consumes the rings
+};
 
-        //State Vars
-        bool driveState = false;
-        bool startFault = false;
+// A received frame stamped by the ISR
+struct RxFrame {
+    CAN_message_t msg;
+    uint32_t rxMicros;
+};
 
-        bool carIsGood = true;
+// Boot diagnostics progress (advanced from run() so the buses keep being serviced)
+enum class BootState : uint8_t {
+    Settling, // Waiting so the other nodes are online before we ask
+    Collecting, // Health request sent, DC replies arrive through route()
+    Done
+};
 
-        // change drivemode!
-        int driveMode = 0; //0 = Full beans, 1 = Endurance, 2 = SkidPad
+// Entries in the task table in ECU.cpp
+#ifdef ECU_PROFILING
+constexpr size_t ECU_TASK_COUNT = 11;
+#else
+constexpr size_t ECU_TASK_COUNT = 10;
+#endif
+
+// CAN IDs route() hands to a handler. ECU.cpp checks its route table against this list, and the
+// native routebench builds its tables from it.
+constexpr uint32_t ECU_ROUTED_IDS[] = {
+    ReservedIDs::Throttle1PositionId,
+    ReservedIDs::Throttle2PositionId,
+    ReservedIDs::BrakePressureId,
+    ReservedIDs::StartSwitchId,
+    ReservedIDs::ThrottleMinId,
+    ReservedIDs::ThrottleMaxId,
+    ReservedIDs::DriveModeId,
+    ReservedIDs::DCFId,
+    ReservedIDs::DCRId,
+    ReservedIDs::DCTId,
+    EcuIDs::InverterMotorPositionId,
+    EcuIDs::FrontWheelSpeedId,
+    EcuIDs::RearWheelSpeedId,
+    EcuIDs::ImuAccelId,
+    EcuIDs::ImuGyroId,
+    EcuIDs::BlackBoxRequestId,
+    EcuIDs::BusStatsRequestId,
+#ifdef ECU_PROFILING
+    EcuIDs::ProfileRequestId,
+#endif
+};
 
-        //MONITORING VARS
-        BufferPacker<8> unpacker;
+// Hardware acceptance filters the route table is folded into (FlexCAN Rx FIFO with RFFN_16)
+constexpr size_t CAN_ACCEPTANCE_FILTERS = 16;
+
+// Entries in the heartbeat policy table in ECU.cpp
+constexpr size_t ECU_HEARTBEAT_COUNT = 11;
+
+constexpr uint32_t CRITICAL_RX_RING_SIZE = 64;
+constexpr uint32_t RX_RING_SIZE = 256;
+
+// HOT CONTROL STATE
+// Everything run() -> route() -> updateThrottle() -> sendMotorCommand() touches on a throttle frame,
+// packed into two 32-byte lines at the start of the ECU instead of spread over the cold sensor,
+// GPS and diagnostic fields. The ECU is a global, so on the Teensy this sits in DTCM (single-cycle,
+// never evicted); the alignment keeps it to two D-cache lines if the ECU is ever placed in OCRAM.
+struct alignas(32) ControlState {
+    uint32_t routeRxMicros = 0; // Receive time of the frame being routed
+
+    //Latest sample per throttle channel, paired by receive time instead of arrival order
+    uint32_t throttle1Micros = 0;
+    uint32_t throttle2Micros = 0;
+    uint32_t throttlePairWindowUs = 0; // Max receive-time gap between the two channels
+    uint32_t lastTorqueUpdate = 0; // millis() of the last computed torque request
+
+    //Torque map of the active drive mode (swapped whole, so a lookup never sees a mixed map)
+    const TorqueMap* torqueMap = nullptr; // Looked up through ECU::torqueCurve
+    int32_t motorSpeed = 0; // rpm, from the inverter broadcast
+
+    int torqueRequested = 0;
+    int pedalPosition = 0; // Q12, from the throttle channels
+    int16_t torqueDemand = 0; // Map output (after limp mode), before traction control
+    uint8_t throttleCode = 0; // Throttle::checkError()
+
+    RxMode rxMode = RxMode::Drain;
+    BootState bootState = BootState::Done;
+
+    bool driveState = false;
+    bool startFault = false;
+    bool carIsGood = true;
+    bool hornActive = false; // Ready-to-drive horn (ends on a deadline check in run())
+
+    bool motorState = false;
+    bool brakeOK = false;
+    bool throttleOK = false;
+    bool slipOK = true;
+    bool BTOveride = false;
+
+    bool throttle1Seen = false;
+    bool throttle2Seen = false;
+    uint8_t throttleNew = 0; // Bit 0/1: channel 1/2 arrived since the last filter sample
+    bool throttleStale = false; // Latched until a fresh pair arrives
+
+    bool limpMode = false; // A Degrade node is silent: torque is scaled down
+    bool criticalNodeLost = false; // A Shutdown node is silent: no driving
+};
+
+static_assert(sizeof(ControlState) <= 64, "Hot control state no longer fits two cache lines");
+
+class ECU {
+    // Compile-time CAN route table lives in ECU.cpp and needs the private handlers
+    friend struct EcuRoutes;
+    friend struct EcuTasks;
+
+    private:
+        ControlState control; // First, so it starts on a cache line boundary
+        TorqueCurve torqueCurve; // control.torqueMap at control.motorSpeed, rebuilt when either changes
+
+        //HARDWARE (injected so the same logic runs on the car and in the host sim)
+        Clock& clock;
+        Gpio& gpio;
+
+        //COMS VARS
+        CanBus* comsCAN = nullptr;
+        CanBus* motorCAN = nullptr;
+        CAN_message_t rmsg; // RX only: routed frames are decoded from here
+
+        //Priority TX per bus (every send goes through these, never straight to the bus)
+        TxScheduler comsTx;
+        TxScheduler motorTx;
+
+        //Preallocated TX frames (one per message so a send never clobbers another or a frame being routed)
+        TxFrame<EmptyMsg> healthCheckFrame{ReservedIDs::HealthCheckId};
+        TxFrame<DriveStateMsg> driveStateFrame{ReservedIDs::DriveStateId};
+        TxFrame<FaultMsg> faultFrame{ReservedIDs::FaultId};
+        TxFrame<FaultMsg> ecuFaultFrame{EcuIDs::EcuFaultId};
+        TxFrame<InverterCommandMsg> inverterPingFrame{EcuIDs::InverterCommandId};
+        TxFrame<InverterCommandMsg> motorCommandFrame{ReservedIDs::ControlCommandId};
+        TxFrame<InverterParameterMsg> inverterParameterFrame{EcuIDs::InverterParameterId};
+        TxFrame<SchedulerStatsMsg> schedulerStatsFrame{EcuIDs::SchedulerStatsId};
+        TxFrame<FaultSummaryMsg> faultSummaryFrame{EcuIDs::FaultSummaryId};
+        TxFrame<LivenessMsg> livenessFrame{EcuIDs::LivenessId};
+        TxFrame<EcuStateMsg> stateFrame{0}; // Packed for the log tap only
+
+        //On-board logger (SD): state snapshots and the frames TappedCanBus can't see
+        FrameTap* logTap = nullptr;
+
+        //Pre-trigger capture (fed through the log tap, frozen by the faults in blackBoxFaults)
+        BlackBox* blackBox = nullptr;
+        uint16_t blackBoxFaults = 0; // FaultIndex bits
+        bool blackBoxOnShutdown = false;
+        bool blackBoxDumpPending = false; // Requested, waiting for the snapshot to freeze
+        uint16_t blackBoxDumpCursor = 0;
+        bool blackBoxDumping = false;
+
+        //Per-ID timing and bus load (RX counted in the drain paths, TX through the meters)
+        BusAnalyzer busAnalyzer;
+        MeteredCanBus comsMeter;
+        MeteredCanBus motorMeter;
+        uint16_t busStatsDumpCursor = BUS_ANALYZER_DUMP_FRAMES; // Next dump frame (== end when idle)
+
+        //Drain mode empties both RX queues every pass (round-robin) up to a frame and time budget
+        uint16_t drainFrameBudget;
+        uint32_t drainTimeBudgetUs;
+        BusRxStats comsRxStats;
+        BusRxStats motorRxStats;
+        CAN_message_t comsHeld; // Read after the budget ran out, routed first next pass
+        CAN_message_t motorHeld;
+        bool comsHolding = false;
+        bool motorHolding = false;
+
+        //Interrupt mode: each ring has exactly one producer ISR and run() as the only consumer
+        static ECU* rxOwner;
+        SpscRing<RxFrame, CRITICAL_RX_RING_SIZE> criticalRing; // Throttle, brake, start switch
+        SpscRing<RxFrame, RX_RING_SIZE> comsRing;
+        SpscRing<RxFrame, RX_RING_SIZE> motorRing;
+        BusRxStats criticalRxStats;
+
+        //Optional CAN FD sensor bus (CAN3): batches are unpacked into classic frames and routed
+        CanFdBus* sensorCAN = nullptr;
+        CANFD_message_t fdMsg;
+        bool sensorHolding = false; // fdMsg is a batch read after the budget ran out
+        RxFrame batchSample; // One unpacked sample as the classic frame it replaces
+        BusRxStats sensorRxStats;
+        SensorBatchStats batchStats;
+        uint8_t nextBatchSequence = 0;
+        bool batchSeen = false;
+
+        //Active faults (edge frames through raiseFault(), ongoing state in the summary frame)
+        FaultManager faults;
+
+        //Watched nodes (stamped by route(), checked by checkHeartbeats())
+        HeartbeatMonitor<ECU_HEARTBEAT_COUNT> heartbeat;
+        uint8_t heartbeatChecks = 0; // Paces the liveness report and DC health polls
+
+        // Set by the dash (DriveModeId)
+        int driveMode = 0; //0 = Full beans, 1 = Endurance, 2 = SkidPad
 
         //Diagnostics
         int data1Health = 0;
         int data2Health = 0;
         int data3Health = 0;
         unsigned int timer = 0;
-        unsigned int lastInverterPing = 0;
+
+        //Periodic work (inverter ping, torque refresh, dash status, stats)
+        Scheduler<ECU, ECU_TASK_COUNT> scheduler;
+        uint8_t statsTaskIndex = 0; // Task reported by the next stats frame
+
+#ifdef ECU_PROFILING
+        uint16_t profileDumpCursor = PROFILE_DUMP_FRAMES; // Next dump frame (== end when idle)
+#endif
+
+        //Ready-to-drive horn (ends on a deadline check in run())
+        uint32_t hornStart = 0;
 
         int wheelSpeed1Health = 0;
         int wheelSpeed2Health = 0;
@@ -48,80 +265,69 @@ class ECU {
         
         //Start Switch
         bool startSwitchState = false;
-        bool prevStartSwitchState = false;
+        bool prevStartSwitchState = false; // As attemptStart() last evaluated it
 
 
         //Wheel Speed
-        int fr_wheel_rpm;
-        int fl_wheel_rpm;
-        int rr_wheel_rpm;
-        int rl_wheel_rpm;
+        int fr_wheel_rpm = 0;
+        int fl_wheel_rpm = 0;
+        int rr_wheel_rpm = 0;
+        int rl_wheel_rpm = 0;
 
 
         //GPS -> This may not have any real relevance
-        float gps_lat;
-        float gps_long;
+        float gps_lat = 0.0f;
+        float gps_long = 0.0f;
 
 
         //Accelerometer
-        float x_accel;
-        float y_accel;
-        float z_accel;
+        float x_accel = 0.0f;
+        float y_accel = 0.0f;
+        float z_accel = 0.0f;
+
+        float heading = 0.0f;
 
-        float heading;
+        float x_angle = 0.0f;
+        float y_angle = 0.0f;
+        float z_angle = 0.0f;
 
-        float x_angle;
-        float y_angle;
-        float z_angle;
+        ImuFusion imu; // -> Fills heading, x/y/z_angle and slipAngle once per gyro frame
 
         //Steering wheel
-        int steeringAngle;
+        int steeringAngle = 0;
 
         //Brake Sensor
         Brake brake;
 
         //Throttle Sensor
-        int throttle1;
-        int throttle2;
-        int handoffCalVal1;
-        int handoffCalVal2;
+        int throttle1 = 0;
+        int throttle2 = 0;
+        int handoffCalVal1 = 0;
+        int handoffCalVal2 = 0;
 
         Throttle throttle;
 
-        bool throttle1UPDATE;
-        bool throttle2UPDATE;
-
-        int torqueRequested;
-
-        int throttleCode;
+        TractionControl traction;
 
 
         //CoolantLoop
-        int coolantTemp1;
-        int coolantTemp2;
+        int coolantTemp1 = 0;
+        int coolantTemp2 = 0;
 
         //Battery
 
-        //Motor
-        bool motorState;
-        bool brakeOK;
-        bool throttleOK;
-        bool slipOK = true;
-
-        bool BTOveride;
-
         //Tractive
-        bool tractiveActive;
+        bool tractiveActive = false;
 
 
         //Car Motion
-        float slipAngle;
+        float slipAngle = 0.0f;
 
 
     public:
-        ECU();
+        ECU(Clock& clockIn, Gpio& gpioIn);
 
-        void setCAN(FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> comsCANin, FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> motorCANin);
+        void setCAN(CanBus& comsCANin, CanBus& motorCANin); // -> Keeps references, buses outlive the ECU
 
         //OVERALL CAR OPERATIONS
         void boot(); // -> initialBoot of car + diagnostics
@@ -130,31 +336,155 @@ class ECU {
 
         void InitialStart(); // -> HORN + COMMAND MOTOR
 
-        void route(); // -> ROUTES DATA TO CORRECT SENSOR OP
+        void serviceBoot(); // -> Advances boot diagnostics without blocking
+
+        void serviceHorn(); // -> Finishes the start sequence once the horn time has elapsed
+
+        void abortStart(); // -> Cancels the horn if the start switch drops mid-sequence
+
+        void route(const CAN_message_t& msg, uint32_t rxMicros); // -> ROUTES DATA TO CORRECT SENSOR OP
 
         void shutdown();
 
         void pingInverter();
 
+        void sendPeriodicTorque(); // -> Refreshes the torque command so the inverter never times out
+
+        void updateTractionControl(); // -> Steps the torque cap and re-applies it to the demand
+
+        void sendDashStatus();
+
+        void logState(); // -> EcuStateMsg snapshot to the log tap
+
+        void tapRx(uint8_t bus, const RxFrame& frame); // -> Interrupt-path frame to the log tap
+
+        bool readBus(CanBus& bus, CAN_message_t& held, bool& holding); // -> Next frame into rmsg, a held one first
+
+        void handleBlackBoxRequest(uint8_t command);
+
+        void sendBlackBoxDump(); // -> Streams the frozen snapshot a few frames at a time
+
+        void handleBusStatsRequest(uint8_t command);
+
+        void sendBusStatsDump(); // -> Streams the analyzer snapshot a few frames at a time
+
+        void sendSchedulerStats(); // -> One task's jitter/overrun/WCET per frame, round-robin
+
+        void sendFaultSummary(); // -> Active/latched masks so dropped or rate-limited edges are recovered
+
+        void checkHeartbeats(); // -> Applies the heartbeat policies, reports liveness, polls DC health
+
+        void flushLog();
+
+#ifdef ECU_PROFILING
+        void requestProfileDump();
+
+        void sendProfileDump(); // -> Sends the pending dump a few frames at a time
+#endif
+
+        const TaskStats& getTaskStats(size_t index) const;
+
+        const TractionControl& getTractionControl() const; // -> Slip, cap and intervention stats
+
+        const TxClassStats& getComsTxStats(TxClass txClass) const;
+
+        const TxClassStats& getMotorTxStats(TxClass txClass) const;
+
+        const ImuEstimate& getImuEstimate() const;
+
+        const FaultManager& getFaultManager() const;
+
+        const HeartbeatMonitor<ECU_HEARTBEAT_COUNT>& getHeartbeat() const;
+
+        bool isDriving() const;
+
+        bool isLimping() const;
+
+        int getDriveMode() const; // -> Index into DRIVE_MODES, 0 until the dash selects one
+
+        void drainBuses(); // -> Reads both buses round-robin until empty or out of budget
+
+        void drainRings(); // -> Consumes the interrupt-fed rings (critical ring first)
+
+        void drainSensorBatches(); // -> Reads the CAN FD sensor bus until empty or out of budget
+
+        void routeSensorBatch(const CANFD_message_t& msg, uint32_t rxMicros); // -> All samples in one pass
+
+        void setSensorCAN(CanFdBus& sensorCANin); // -> Enables the CAN FD batch path
+
+        const BusRxStats& getSensorRxStats() const;
+
+        BusAnalyzer& getBusAnalyzer(); // -> Bitrates are set here (default 250k)
+
+        const SensorBatchStats& getSensorBatchStats() const;
+
+        static bool isBatchedId(uint32_t id); // -> Sensor IDs a batch may carry
+
+        void setRxMode(RxMode mode);
+
+        void setLogTap(FrameTap* tap); // -> 100 Hz state snapshots + ring RX frames (nullptr = off)
+
+        void setBlackBox(BlackBox* box); // -> Must also be reachable through the log tap and bus taps
+
+        void setBlackBoxTriggers(uint16_t faultMask, bool onShutdown); // -> FaultIndex bits that freeze it
+
+        void setDrainBudget(uint16_t maxFrames, uint32_t maxMicros);
+
+        void setThrottlePairWindow(uint32_t maxMicros); // -> 0 turns pairing off: torque waits for both channels
+
+        const BusRxStats& getComsRxStats() const;
+
+        const BusRxStats& getMotorRxStats() const;
+
+        const BusRxStats& getCriticalRxStats() const;
+
+        static bool isCriticalId(uint32_t id);
+
+        static const AcceptancePlan<CAN_ACCEPTANCE_FILTERS>& getAcceptancePlan(); // -> Filters for every routed ID
+
+        static void onComsReceive(const CAN_message_t& msg); // -> comsCAN FIFO callback (ISR)
+
+        static void onMotorReceive(const CAN_message_t& msg); // -> motorCAN FIFO callback (ISR)
+
 
 
 
         //Individual Sensor Operations
-        void updateThrottle();
+        void updateThrottle1(int32_t value);
+
+        void updateThrottle2(int32_t value);
 
-        void updateBrake();
+        void updateThrottle(); // -> Computes torque on every arrival while the other channel is fresh (pairing on)
 
-        void updateSwitch();
+        void updateTorqueCommand(); // -> From control.pedalPosition to the inverter
 
-        void updateWheelSpeed();
+        void checkThrottleFreshness(); // -> Faults a throttle channel that has gone quiet
 
-        void updateAccelerometer();
+        void updateBrake(int32_t value);
+
+        void updateSwitch(uint8_t state);
+
+        void updateFrontWheelSpeeds(const WheelSpeedMsg& speeds);
+
+        void updateRearWheelSpeeds(const WheelSpeedMsg& speeds);
+
+        void updateAccelerometer(const ImuAxesMsg& accel);
+
+        void updateGyro(const ImuAxesMsg& rates);
 
         void updateCoolant();
 
         void updateSteering();
 
-        void updateDriveMode();
+        void updateDriveMode(uint8_t mode);
+
+        void updateMotorSpeed(int16_t rpm);
+
+        void updateDCFHealth(uint8_t health);
+
+        void updateDCRHealth(uint8_t health);
+
+        void updateDCTHealth(uint8_t health);
 
         void updateGPS();
 
@@ -170,13 +500,11 @@ class ECU {
 
         void resetStartFault(); // -> Sees that all throttle / brake / switch are all zero before being able to attempt start again
 
-        void calculateSlipAngle(); // -> Calculates slip angle for potential TC Control
+        void calculateSlipAngle(); // -> Copies the IMU fusion estimate into the car motion fields
 
         void checkBTOverride();
 
 
-        bool runDiagnostics();
-
         void askForDiagnostics();
 
         bool reportDiagnostics();
@@ -186,7 +514,9 @@ class ECU {
 
         void calibrateThrottleMax();
 
-        void throwError(int code);
+        void raiseFault(FaultIndex fault); // -> Edge frame on FaultId (EcuFaultId for ECU-only codes), rate limited
+
+        void throwError(int code); // -> Unconditional fault frame
 
         
 };
@@ -0,0 +1,161 @@
+#ifndef ECU_FIXTURE_H
+#define ECU_FIXTURE_H
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "CanTrace.h"
+#include "ECU.h"
+#include "SimHal.h"
+#include "TractionControl.h"
+
+// SIM FIXTURE: ONE ECU ON SIMULATED comsCAN AND motorCAN ([env:native] only)
+// The part every sim-driven check and benchmark shares: virtual clock and GPIO, both buses, the
+// ECU connected and booted, and the three DCs answering its health check. Everything that changes
+// how the ECU is wired (acceptance filters, TX queue depth, CAN FD sensor bus, taps) goes in
+// before boot(); the traffic itself is up to the caller. The frame builders, the Teensy map(), the
+// wheel-spin traces and the synthetic IMU drive below are shared by the tests in test/ and the benchmarks in main.cpp.
+
+constexpr uint64_t LOOP_PERIOD_US = 50; // Virtual time per run() pass
+constexpr uint64_t SENSOR_PERIOD_US = 10000; // Pedal/brake frames at 100 Hz
+constexpr uint64_t HEALTH_REPLY_DELAY_US = 1000; // DCs answer each health request this much later
+constexpr uint64_t START_SWITCH_US = 500000;
+constexpr uint64_t BRAKE_RELEASE_US = 3000000; // After the 2 s horn
+constexpr int32_t BRAKE_HELD = 500;
+constexpr int32_t BRAKE_RELEASED = 20; // Above the pull-down error threshold
+constexpr int32_t PEDAL_MIN = 8;
+constexpr int32_t PEDAL_MAX = 1023;
+constexpr int16_t ACCEL_Z_1G = 1000; // mg
+constexpr int16_t GYRO_Z_BIAS = 50; // 0.5 deg/s on a straight road: heading should stay near 0
+constexpr int32_t DC_HEALTHY = 2; // Health reply of a DC with nothing to report
+
+// 8-byte frame with a little-endian int32 in the first word
+CAN_message_t makeFrame(uint32_t id, int32_t value);
+
+// 8-byte frame with two little-endian int16 (left/right wheel rpm)
+CAN_message_t makeWheelFrame(uint32_t id, int16_t left, int16_t right);
+
+// 8-byte frame with three little-endian int16 (IMU x/y/z)
+CAN_message_t makeImuFrame(uint32_t id, int16_t x, int16_t y, int16_t z);
+
+// Deterministic pseudo-random sequence (xorshift32, state must not be 0)
+uint32_t xorshift(uint32_t& state);
+
+// The Teensy core's integer map(), +1 branch included (what setThrottle1/2 called before mapPedal())
+long teensyMap(long x, long inMin, long inMax, long outMin, long outMax);
+
+class EcuFixture {
+    private:
+        std::function<void(const SimTxFrame&)> comsListener;
+        std::function<void(const CAN_message_t&, uint64_t)> comsFeed;
+
+        void feedComs(const CAN_message_t& msg, uint64_t atUs); // -> Through comsFeed if one is set
+
+        void onComsFrame(const SimTxFrame& frame); // -> Listener first, then the health replies
+
+    public:
+        SimClock clock;
+        SimGpio gpio;
+        SimCanBus comsSim;
+        SimCanBus motorSim;
+        ECU ecu;
+
+        EcuFixture();
+
+        // Only the routed IDs reach the RX rings, like on the car (before boot())
+        void setFiltered(bool filtered);
+
+        // Frames the fixture puts on comsCAN (health replies, start switch) go through feed instead
+        // of straight into comsSim, e.g. to drop or track them
+        void setComsFeed(std::function<void(const CAN_message_t&, uint64_t)> feed);
+
+        void onComsTransmit(std::function<void(const SimTxFrame&)> listener); // -> Every frame the ECU sends on comsCAN
+
+        void boot(); // -> ECU on the sim buses themselves
+
+        void boot(CanBus& coms, CanBus& motor); // -> ECU on wrappers around them (taps)
+
+        void setStartSwitch(uint64_t atUs, bool on = true);
+
+        void runUntil(uint64_t endUs); // -> One run() per LOOP_PERIOD_US
+
+        void finish(); // -> Drains the binary log
+};
+
+// SYNTHETIC WHEEL-SPIN TRACES FOR TractionControl
+// Open loop: the traces set the rear overspeed directly, they don't react to the torque cap
+constexpr uint64_t SPIN_TRACE_US = 2500000;
+constexpr int32_t SPIN_TARGET = 614; // Full beans target slip, 15 % (Q12)
+constexpr int32_t SPIN_TORQUE = 3100;
+constexpr uint64_t SPIN_STALE_US = 50000; // WHEEL_DATA_STALE_US in TractionControl.cpp
+constexpr uint64_t SPIN_RX_DELAY_US = 60000; // The "queued" trace: frames processed this long after arrival
+
+enum class SpinTrace : uint8_t {
+    Grip, // 5 % slip throughout, never above target
+    Launch, // Ramps to 40 % over 0.2 s, holds 0.5 s, then grips again
+    Oscillate, // 0-30 % at 5 Hz for 1.5 s
+    Dropout, // Launch, but the wheel frames stop at the peak
+    Queued, // Launch, processed SPIN_RX_DELAY_US after arrival
+};
+
+struct TractionResult {
+    uint32_t interventions = 0;
+    int32_t minCap = SLIP_ONE;
+    uint64_t firstOverUs = 0; // Arrival of the first wheel frame above target (0 = never)
+    uint64_t firstCutUs = 0; // First step with the cap below full (0 = never)
+    uint64_t recoveredUs = 0; // Cap back at full after the last cut (0 = never)
+    uint64_t lastFrameUs = 0;
+    int32_t maxLimited = 0; // Largest torque limit() let through for a SPIN_TORQUE request
+    double cutShare = 0; // Of the torque requested over the trace
+};
+
+double traceSlip(SpinTrace trace, uint64_t t); // -> Slip ratio at time t (0.15 = 15 %)
+
+// Wheel frames at 100 Hz (front at 300 rpm), controller steps and torque commands as the ECU runs them
+TractionResult runSpinTrace(SpinTrace trace);
+
+// SYNTHETIC IMU DRIVE WITH KNOWN TRUTH
+// 50 s at 100 Hz: parked on a slope (0-5 s), accelerating then straight at 12 m/s (5-15 s), the skidpad
+// at 10 m/s (15-45 s), straight again with a 6 deg slide (45-50 s). Sensor frames are quantised and
+// noisy like the real ones (the wheel noise also dithers the 1 rpm steps, which are 1 deg/s of yaw
+// rate across the axle) and the gyro reads GYRO_Z_BIAS high.
+constexpr double IMU_DRIVE_DEG = 57.29578;
+constexpr double IMU_DRIVE_TRACK_M = 1.22; // FRONT_TRACK_M in ImuFusion.cpp
+constexpr double IMU_DRIVE_RPM_PER_MPS = 60.0 / (2.0 * 3.14159265 * 0.203); // WHEEL_RADIUS_M in ImuFusion.cpp
+constexpr double IMU_DRIVE_SLIDE_DEG = 6.0;
+
+// Truth at one gyro frame
+struct ImuTruth {
+    double seconds;
+    double roll; // rad
+    double pitch;
+    double yawRate; // rad/s
+    double heading; // rad, unwrapped
+    double slipAngle; // rad
+};
+
+void makeImuDrive(std::vector<TraceRecord>& records, std::vector<ImuTruth>& truth);
+
+// Feeds the IMU and front wheel frames to the fusion the way ECU::route() does; fn(gyro frame index) after each step
+template<typename Fn>
+void fuseImuFrames(const std::vector<TraceRecord>& records, ImuFusion& fusion, Fn fn) {
+    uint32_t updates = 0;
+    for(const TraceRecord& record : records) {
+        if(record.bus != TRACE_BUS_COMS || (record.flags & TRACE_FLAG_TX) != 0) {
+            continue;
+        }
+        if(record.id == EcuIDs::FrontWheelSpeedId) {
+            const WheelSpeedMsg speeds = WheelSpeedMsg::decode(record.data);
+            fusion.setFrontWheels(speeds.left, speeds.right);
+        } else if(record.id == EcuIDs::ImuAccelId) {
+            const ImuAxesMsg accel = ImuAxesMsg::decode(record.data);
+            fusion.setAccel(accel.x * IMU_ACCEL_SCALE, accel.y * IMU_ACCEL_SCALE, accel.z * IMU_ACCEL_SCALE);
+        } else if(record.id == EcuIDs::ImuGyroId) {
+            const ImuAxesMsg rates = ImuAxesMsg::decode(record.data);
+            fusion.updateGyro(rates.x * IMU_GYRO_SCALE, rates.y * IMU_GYRO_SCALE, rates.z * IMU_GYRO_SCALE, record.timestampUs);
+            fn(updates++);
+        }
+    }
+}
+
+#endif
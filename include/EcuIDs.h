@@ -0,0 +1,48 @@
+#ifndef ECU_IDS_H
+#define ECU_IDS_H
+
+// CAN IDs the ECU owns that are not part of the shared Reserved.h in Utils.
+// Inverter IDs follow the RMS CAN protocol. Diagnostic IDs sit at the bottom of the
+// arbitration order so they never delay control traffic.
+
+enum EcuIDs {
+    //Inverter (motorCAN)
+    InverterMotorPositionId = 0x0A5, // Broadcast: angle, motor speed (int16 rpm, bytes 2-3), ...
+    InverterCommandId = 0x0C0, // Command message (also used as the keep-alive ping)
+    InverterParameterId = 0x0C1, // Read/write parameter command
+
+    //Wheel speed from the data collectors (comsCAN): left rpm bytes 0-1, right rpm bytes 2-3 (int16)
+    FrontWheelSpeedId = 0x0B0,
+    RearWheelSpeedId = 0x0B1,
+
+    //IMU (comsCAN): x/y/z int16 in bytes 0-5, scaling in ImuFusion.h
+    ImuAccelId = 0x0B2,
+    ImuGyroId = 0x0B3,
+
+    //Batched sensor samples (CAN FD on CAN3, optional): see SensorBatchMsg
+    SensorBatchId = 0x008,
+
+    //Diagnostics (comsCAN)
+    SchedulerStatsId = 0x7E0,
+    ProfileRequestId = 0x7E1, // Any payload -> dump profiler stats (ECU_PROFILING builds)
+    ProfileDataId = 0x7E2, // Multi-frame profiler dump, see Profiler::encodeDumpFrame
+    FaultSummaryId = 0x7E3, // Periodic active/latched fault masks, see FaultSummaryMsg
+    LivenessId = 0x7E4, // Watched node bitmap, see LivenessMsg
+    BlackBoxRequestId = 0x7E5, // Byte 0: 0 = dump (freezes first if still recording), 1 = rearm
+    BlackBoxDataId = 0x7E6, // Multi-frame snapshot dump, see BlackBox::encodeDumpFrame
+    BusStatsRequestId = 0x7E7, // Byte 0: 0 = dump, 1 = reset
+    BusStatsDataId = 0x7E8, // Multi-frame per-ID timing and bus load dump, see BusAnalyzer::encodeDumpFrame
+    EcuFaultId = 0x7E9, // FaultMsg layout, carries the EcuFaultIDs codes the dash can't decode
+};
+
+// Fault codes the ECU raises on top of the shared FaultSourcesIDs. Numbered from 16 so the shared
+// list can grow without a clash. The dash firmware only decodes the shared list, so these go out
+// in the EcuFaultId frame instead of FaultId until the dash learns them.
+enum EcuFaultIDs {
+    EcuFaultCodeBase = 16,
+    ThrottleStaleFaultId = EcuFaultCodeBase, // A throttle channel went quiet while driving
+    ThrottleZeroFaultId = 17, // Throttle::checkError() code 2
+    NodeLostFaultId = 18, // A watched CAN ID went silent (see Heartbeat.h)
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef FAULT_MANAGER_H
+#define FAULT_MANAGER_H
+
+#include <stdint.h>
+
+// ACTIVE FAULT BOOKKEEPING
+// Every fault source has a bit in the active mask plus first/last-seen times and a count.
+// raise() only asks for a fault frame on the rising edge (and at most once per the fault's
+// rate limit), so a condition that persists for seconds costs one frame instead of one per
+// sensor update; ongoing state goes out in the periodic summary frame instead.
+// Latching faults stay active until reset(); the others clear as soon as clear() is called.
+
+enum FaultIndex : uint8_t {
+    FaultThrottleMismatch = 0,
+    FaultThrottleZero = 1,
+    FaultThrottleStale = 2,
+    FaultBrakeZero = 3,
+    FaultStartRefused = 4, // Latching: cleared by switching the start switch off
+    FaultNodeLost = 5, // A watched CAN ID went silent (see Heartbeat.h)
+    FAULT_COUNT
+};
+
+static_assert(FAULT_COUNT <= 16, "Fault masks are 16 bits on the wire");
+
+struct FaultRecord {
+    uint32_t firstSeenMs = 0; // First raise since boot
+    uint32_t lastSeenMs = 0;
+    uint32_t lastReportMs = 0; // Last edge frame
+    uint16_t count = 0; // Raises since boot (saturates)
+    bool reported = false;
+};
+
+class FaultManager {
+    private:
+        uint16_t activeMask = 0;
+        uint16_t latchedMask = 0;
+        uint16_t occurrences = 0; // All raises since boot (saturates)
+        uint8_t lastFault = FAULT_COUNT; // == FAULT_COUNT until the first raise
+        FaultRecord records[FAULT_COUNT];
+        uint32_t rateLimitMs[FAULT_COUNT];
+
+    public:
+        FaultManager();
+
+        bool raise(FaultIndex fault, uint32_t nowMs); // -> True when an edge frame should go out now
+
+        void clear(FaultIndex fault); // -> No effect on a latched fault
+
+        void reset(FaultIndex fault); // -> Clears latched faults too
+
+        void setRateLimit(FaultIndex fault, uint32_t minIntervalMs); // -> Min time between edge frames
+
+        bool isActive(FaultIndex fault) const;
+
+        uint16_t getActiveMask() const;
+
+        uint16_t getLatchedMask() const;
+
+        uint16_t getOccurrences() const;
+
+        uint8_t getLastCode() const; // -> Wire code of the most recent raise (0 if none)
+
+        const FaultRecord& getRecord(FaultIndex fault) const;
+
+        static uint8_t code(FaultIndex fault); // -> Code sent in the FaultId or EcuFaultId frame
+
+        static bool dashDecodes(FaultIndex fault); // -> False for EcuFaultIDs codes, which go out on EcuFaultId
+};
+
+#endif
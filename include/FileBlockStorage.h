@@ -0,0 +1,43 @@
+#ifndef FILE_BLOCK_STORAGE_H
+#define FILE_BLOCK_STORAGE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "Hal.h"
+#include "SimHal.h"
+
+// HOST STAND-IN FOR THE SD CARD ([env:native] only)
+// Sectors go to a regular file sized up front. With a SimClock attached, every sector keeps the
+// "card" busy for a fixed time and every stallEvery-th sector adds a long stall (SD cards pause
+// for wear levelling), so BlockLogger's buffering can be checked against a pessimistic card in
+// virtual time while the real file writes measure host throughput.
+
+class FileBlockStorage : public BlockStorage {
+    private:
+        FILE* file = nullptr;
+        uint32_t sectors = 0;
+
+        SimClock* clock = nullptr;
+        uint32_t sectorUs = 0;
+        uint32_t stallUs = 0;
+        uint32_t stallEvery = 0;
+        uint64_t busyUntil = 0;
+        uint32_t written = 0;
+
+    public:
+        ~FileBlockStorage();
+
+        bool open(const char* path, uint32_t sectorCount); // -> Creates path at its full size
+
+        void close();
+
+        void setTiming(SimClock& clockIn, uint32_t perSectorUs, uint32_t stallLengthUs, uint32_t stallEverySectors);
+
+        bool busy() override;
+
+        bool writeSector(uint32_t sector, const uint8_t* data) override;
+
+        uint32_t sectorCount() const override;
+};
+
+#endif
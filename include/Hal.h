@@ -0,0 +1,107 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+
+// HARDWARE ABSTRACTION
+// ECU, Throttle and Brake only talk to the outside world through these interfaces so the same
+// control code runs on the Teensy (TeensyHal.h) and on the host (SimHal.h, [env:native]).
+
+#ifdef ARDUINO
+#include "FlexCAN_T4.h"
+#else
+// Host stand-in with the FlexCAN_T4 fields the ECU uses
+struct CAN_message_t {
+    uint32_t id = 0;
+    uint16_t timestamp = 0;
+    struct {
+        bool extended = false;
+        bool remote = false;
+        bool overrun = false;
+        bool reserved = false;
+    } flags;
+    uint8_t len = 8;
+    uint8_t buf[8] = {0};
+    int8_t mb = 0;
+    uint8_t bus = 0;
+    bool seq = false;
+};
+
+// Host stand-in for the FlexCAN_T4 CAN FD frame (CAN3)
+struct CANFD_message_t {
+    uint32_t id = 0;
+    uint16_t timestamp = 0;
+    bool brs = true; // Data phase at the FD bitrate
+    bool esi = false;
+    bool edl = true; // FD frame (false = classic frame on the FD controller)
+    struct {
+        bool extended = false;
+        bool overrun = false;
+    } flags;
+    uint8_t len = 8;
+    uint8_t buf[64] = {0};
+    int8_t mb = 0;
+    uint8_t bus = 0;
+    bool seq = false;
+};
+#endif
+
+constexpr uint8_t GPIO_LOW = 0;
+constexpr uint8_t GPIO_HIGH = 1;
+constexpr uint8_t GPIO_INPUT = 0;
+constexpr uint8_t GPIO_OUTPUT = 1;
+
+// One CAN controller. read() never blocks: it returns false when nothing is queued
+class CanBus {
+    public:
+        virtual ~CanBus() {}
+
+        virtual bool read(CAN_message_t& msg) = 0;
+
+        virtual bool write(const CAN_message_t& msg) = 0; // -> False if the TX queue is full
+};
+
+// One CAN FD controller (up to 64 data bytes per frame). Same non-blocking contract as CanBus
+class CanFdBus {
+    public:
+        virtual ~CanFdBus() {}
+
+        virtual bool read(CANFD_message_t& msg) = 0;
+
+        virtual bool write(const CANFD_message_t& msg) = 0;
+};
+
+// Monotonic time source (both counters wrap like the Arduino ones)
+class Clock {
+    public:
+        virtual ~Clock() {}
+
+        virtual uint32_t millis() = 0;
+
+        virtual uint32_t micros() = 0;
+};
+
+// Digital pins
+class Gpio {
+    public:
+        virtual ~Gpio() {}
+
+        virtual void pinMode(uint8_t pin, uint8_t mode) = 0;
+
+        virtual void digitalWrite(uint8_t pin, uint8_t value) = 0;
+};
+
+// Preallocated contiguous block storage (512-byte sectors numbered from the start of the area).
+// writeSector() only starts a write; busy() says whether the device can take the next one yet
+class BlockStorage {
+    public:
+        virtual ~BlockStorage() {}
+
+        virtual bool busy() = 0;
+
+        virtual bool writeSector(uint32_t sector, const uint8_t* data) = 0;
+
+        virtual uint32_t sectorCount() const = 0;
+};
+
+#endif
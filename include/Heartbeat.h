@@ -0,0 +1,161 @@
+#ifndef HEARTBEAT_H
+#define HEARTBEAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// NODE / SENSOR LIVENESS
+// Every watched CAN ID has a policy {id, timeout, action}. The RX path stamps the ID's slot
+// (looked up in a compile-time dense table, so one subtract and one load per frame) and a
+// scheduled check() compares each slot against its timeout. The alive bitmap is in policy table
+// order; what the ECU does about a dead slot (report, limp, shut down) is up to the caller.
+
+enum class StaleAction : uint8_t {
+    Report = 0, // Liveness bit + fault only
+    Degrade = 1, // Limp torque until the node is back
+    Shutdown = 2, // Drops the tractive system if driving
+};
+
+struct HeartbeatPolicy {
+    uint32_t id;
+    uint32_t timeoutUs;
+    StaleAction action;
+};
+
+constexpr uint8_t HEARTBEAT_MAX_NODES = 16; // Bits in the liveness bitmap
+constexpr uint8_t HEARTBEAT_UNWATCHED = 0xFF;
+
+// Smallest / largest watched ID
+template<size_t N>
+constexpr uint32_t MinPolicyId(const HeartbeatPolicy (&policies)[N]) {
+    uint32_t lowest = policies[0].id;
+    for(size_t i = 1; i < N; i++) {
+        lowest = (policies[i].id < lowest) ? policies[i].id : lowest;
+    }
+    return lowest;
+}
+
+template<size_t N>
+constexpr uint32_t MaxPolicyId(const HeartbeatPolicy (&policies)[N]) {
+    uint32_t highest = policies[0].id;
+    for(size_t i = 1; i < N; i++) {
+        highest = (policies[i].id > highest) ? policies[i].id : highest;
+    }
+    return highest;
+}
+
+// True if no ID is watched twice and every timeout is set
+template<size_t N>
+constexpr bool PoliciesAreValid(const HeartbeatPolicy (&policies)[N]) {
+    for(size_t i = 0; i < N; i++) {
+        if(policies[i].timeoutUs == 0) {
+            return false;
+        }
+        for(size_t j = i + 1; j < N; j++) {
+            if(policies[i].id == policies[j].id) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Dense ID -> slot table (unwatched IDs hold HEARTBEAT_UNWATCHED)
+template<uint32_t Span>
+struct HeartbeatSlotTable {
+    uint32_t base;
+    uint8_t slots[Span];
+
+    template<size_t N>
+    constexpr HeartbeatSlotTable(const HeartbeatPolicy (&policies)[N], uint32_t baseId) : base(baseId), slots{} {
+        for(uint32_t i = 0; i < Span; i++) {
+            slots[i] = HEARTBEAT_UNWATCHED;
+        }
+        for(size_t i = 0; i < N; i++) {
+            slots[policies[i].id - baseId] = static_cast<uint8_t>(i);
+        }
+    }
+
+    constexpr uint8_t lookup(uint32_t id) const {
+        return ((id - base) < Span) ? slots[id - base] : HEARTBEAT_UNWATCHED;
+    }
+};
+
+template<size_t N>
+class HeartbeatMonitor {
+    static_assert(N > 0 && N <= HEARTBEAT_MAX_NODES, "Liveness bitmap is 16 bits");
+
+    private:
+        static constexpr uint16_t ALL_ALIVE = static_cast<uint16_t>((1u << N) - 1);
+
+        const HeartbeatPolicy* policies;
+        uint32_t lastSeen[N];
+        uint16_t aliveMask = ALL_ALIVE;
+        uint16_t lostMask = 0; // Slots that have gone silent at least once since start()
+
+    public:
+        explicit HeartbeatMonitor(const HeartbeatPolicy (&table)[N]) : policies(table), lastSeen{} {}
+
+        // Every node gets one timeout of grace from now
+        void start(uint32_t nowUs) {
+            for(size_t i = 0; i < N; i++) {
+                lastSeen[i] = nowUs;
+            }
+            aliveMask = ALL_ALIVE;
+        }
+
+        // RX path (slot from HeartbeatSlotTable::lookup)
+        void seen(uint8_t slot, uint32_t rxMicros) {
+            lastSeen[slot] = rxMicros;
+        }
+
+        // Recomputes the alive bitmap, returns it
+        uint16_t check(uint32_t nowUs) {
+            uint16_t alive = 0;
+            for(size_t i = 0; i < N; i++) {
+                // Signed so a frame stamped after nowUs (ISR between the two reads) counts as fresh
+                if(static_cast<int32_t>(nowUs - lastSeen[i]) <= static_cast<int32_t>(policies[i].timeoutUs)) {
+                    alive |= static_cast<uint16_t>(1u << i);
+                }
+            }
+            lostMask |= static_cast<uint16_t>(~alive & ALL_ALIVE);
+            aliveMask = alive;
+            return alive;
+        }
+
+        // True if any dead slot asks for at least this action
+        bool anyDead(StaleAction action) const {
+            for(size_t i = 0; i < N; i++) {
+                if(!(aliveMask & (1u << i)) && policies[i].action >= action) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool isAlive(uint8_t slot) const {
+            return (aliveMask & (1u << slot)) != 0;
+        }
+
+        uint16_t getAliveMask() const {
+            return aliveMask;
+        }
+
+        uint16_t getLostMask() const {
+            return lostMask;
+        }
+
+        uint32_t getLastSeen(uint8_t slot) const {
+            return lastSeen[slot];
+        }
+
+        const HeartbeatPolicy& getPolicy(uint8_t slot) const {
+            return policies[slot];
+        }
+
+        static constexpr size_t size() {
+            return N;
+        }
+};
+
+#endif
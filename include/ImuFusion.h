@@ -0,0 +1,50 @@
+#ifndef IMU_FUSION_H
+#define IMU_FUSION_H
+
+#include <stdint.h>
+
+// IMU + WHEEL SPEED FUSION (COMPLEMENTARY FILTER, SINGLE PRECISION FOR THE M7 FPU)
+// Runs once per gyro frame with a fixed amount of work (three atan2f, one sqrtf, no loops):
+//   roll/pitch -> gyro integration pulled toward the accelerometer tilt
+//   yaw rate   -> gyro minus a bias learned against the undriven front axle's yaw rate
+//   slip angle -> lateral velocity from a_y - r * v_x, leaked toward zero so it cannot drift
+// Accelerometer and wheel frames only store their latest values.
+
+// Frame scaling (int16 per axis, x/y/z in bytes 0-5)
+constexpr float IMU_ACCEL_SCALE = 0.00980665f; // 1 mg/LSB -> m/s^2
+constexpr float IMU_GYRO_SCALE = 0.000174533f; // 0.01 deg/s/LSB -> rad/s
+
+struct ImuEstimate {
+    float roll = 0.0f; // rad
+    float pitch = 0.0f; // rad
+    float heading = 0.0f; // rad, -pi..pi, relative to power-up
+    float yawRate = 0.0f; // rad/s, bias corrected
+    float slipAngle = 0.0f; // rad, body slip (positive = sliding left)
+    float speed = 0.0f; // m/s, from the front wheels
+};
+
+class ImuFusion {
+    private:
+        float accelX = 0.0f; // m/s^2
+        float accelY = 0.0f;
+        float accelZ = 0.0f;
+        float wheelYawRate = 0.0f; // rad/s
+        float gyroBias = 0.0f; // rad/s
+        float lateralVelocity = 0.0f; // m/s
+
+        uint32_t lastGyroMicros = 0;
+        bool gyroSeen = false;
+
+        ImuEstimate estimate;
+
+    public:
+        void setAccel(float x, float y, float z);
+
+        void setFrontWheels(int16_t leftRpm, int16_t rightRpm);
+
+        void updateGyro(float x, float y, float z, uint32_t rxMicros); // -> One filter step
+
+        const ImuEstimate& getEstimate() const;
+};
+
+#endif
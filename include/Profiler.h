@@ -0,0 +1,81 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// SCOPED LOOP PROFILING
+// PROFILE_SCOPE(probe) times the rest of the enclosing block and folds it into that probe's
+// min/max/mean and log2 histogram. Ticks are CPU cycles from the DWT cycle counter on the
+// Teensy 4.1 (600 MHz -> 1.67 ns) and nanoseconds from std::chrono on the host.
+// Probes only exist when built with -D ECU_PROFILING; otherwise PROFILE_SCOPE is empty and no
+// profiler code or data is linked in.
+
+enum ProbeId : uint8_t {
+    ProbeRun = 0, // One full ECU::run() pass
+    ProbeRoute = 1,
+    ProbeUpdateThrottle = 2,
+    ProbeSendMotorCommand = 3,
+    ProbeTractionControl = 4,
+    ProbeImuFusion = 5,
+    PROBE_COUNT
+};
+
+constexpr uint8_t PROBE_HISTOGRAM_BINS = 24; // Bin n holds samples in [2^(n-1), 2^n) ticks
+
+// Profile dump frames per probe: count, min, max, mean, then 3 histogram bins per frame
+constexpr uint8_t PROBE_SUMMARY_FRAMES = 4;
+constexpr uint8_t PROBE_BINS_PER_FRAME = 3;
+constexpr uint8_t PROBE_FRAMES = PROBE_SUMMARY_FRAMES
+    + (PROBE_HISTOGRAM_BINS + PROBE_BINS_PER_FRAME - 1) / PROBE_BINS_PER_FRAME;
+constexpr uint16_t PROFILE_DUMP_FRAMES = PROBE_FRAMES * PROBE_COUNT;
+
+struct ProbeStats {
+    uint32_t count = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t total = 0;
+    uint32_t histogram[PROBE_HISTOGRAM_BINS] = {};
+};
+
+#ifdef ECU_PROFILING
+
+class Profiler {
+    public:
+        static void begin(); // -> Enables the cycle counter
+
+        static uint32_t now();
+
+        static void record(ProbeId probe, uint32_t ticks);
+
+        static const ProbeStats& getStats(ProbeId probe);
+
+        static void reset();
+
+        // Fills one 8-byte dump payload: [probe, frame, data...]. False once index is past the end
+        static bool encodeDumpFrame(uint16_t index, uint8_t* buf);
+};
+
+class ScopedProbe {
+    private:
+        ProbeId probe;
+        uint32_t start;
+
+    public:
+        explicit ScopedProbe(ProbeId id) : probe(id), start(Profiler::now()) {}
+
+        ~ScopedProbe() {
+            Profiler::record(probe, Profiler::now() - start);
+        }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(probe) ScopedProbe PROFILE_CONCAT(scopedProbe_, __LINE__)(probe)
+
+#else
+
+#define PROFILE_SCOPE(probe) do {} while(0)
+
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <vector>
+#include "CanTrace.h"
+
+// TRACE REPLAY ([env:native] only)
+// Feeds the received frames of a trace into a fresh ECU on simulated buses and a virtual clock,
+// either paced to wall time (1x) or as fast as the host allows. Everything the ECU moves on the
+// buses is collected so it can be recorded and diffed against a golden run.
+
+struct ReplayOptions {
+    bool realTime = false;
+    uint64_t loopPeriodUs = 50; // Virtual time per run() pass
+    uint64_t tailUs = 100000; // Keeps running after the last input so periodic output settles
+    uint64_t timeToleranceUs = 1000; // Allowed timestamp drift against the golden output
+};
+
+struct ReplayReport {
+    uint64_t framesIn = 0;
+    uint64_t framesOut = 0; // Frames the ECU transmitted
+    uint64_t passes = 0;
+    uint32_t rxDropped = 0;
+    double simSeconds = 0.0;
+    double wallSeconds = 0.0;
+
+    //Golden diff (torque commands + faults only)
+    bool compared = false;
+    uint32_t checked = 0;
+    uint32_t mismatches = 0;
+    int64_t firstMismatch = -1; // Index into the compared frames, -1 if none
+};
+
+// Torque commands to the inverter and faults to the dash are what a firmware change must not alter
+bool IsGoldenFrame(const TraceRecord& record);
+
+class ReplayEngine {
+    private:
+        ReplayOptions options;
+
+    public:
+        explicit ReplayEngine(const ReplayOptions& replayOptions);
+
+        // Runs input through a new ECU. Every frame moved on either bus is appended to output and
+        // passed to tap (if given)
+        ReplayReport run(const std::vector<TraceRecord>& input, std::vector<TraceRecord>& output,
+                         FrameTap* tap = nullptr);
+
+        // Diffs the golden frames of output against those of golden
+        void compare(const std::vector<TraceRecord>& output, const std::vector<TraceRecord>& golden,
+                     ReplayReport& report) const;
+};
+
+#endif
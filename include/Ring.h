@@ -0,0 +1,66 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+// FIXED-SIZE FIFO RING FOR ONE CONTEXT
+// Pushed and popped from the same thread (no ISR on either side), so plain indices do: none of
+// SpscRing's atomics or cache-line padding. Indices run free and are masked on access, so
+// Capacity must be a power of two.
+
+template<typename T, uint32_t Capacity>
+class Ring {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Ring capacity must be a power of two");
+
+    private:
+        static constexpr uint32_t MASK = Capacity - 1;
+
+        uint32_t head = 0; // Next slot to write
+        uint32_t tail = 0; // Next slot to read
+
+        T slots[Capacity];
+
+    public:
+        // Copies item in, returns false if the ring is full
+        bool push(const T& item) {
+            if(head - tail >= Capacity) {
+                return false;
+            }
+            slots[head & MASK] = item;
+            head++;
+            return true;
+        }
+
+        // Copies the oldest item out, returns false if the ring is empty
+        bool pop(T& item) {
+            if(!peek(item)) {
+                return false;
+            }
+            tail++;
+            return true;
+        }
+
+        // Copies the oldest item out without removing it
+        bool peek(T& item) const {
+            if(tail == head) {
+                return false;
+            }
+            item = slots[tail & MASK];
+            return true;
+        }
+
+        // Removes the oldest item (after a successful peek)
+        void discard() {
+            tail++;
+        }
+
+        uint32_t size() const {
+            return head - tail;
+        }
+
+        bool empty() const {
+            return head == tail;
+        }
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Hal.h"
+
+// FIXED-RATE COOPERATIVE SCHEDULER
+// Tasks come from a compile-time table of {member function, period, offset, priority}. poll() is
+// called every loop and runs every due task in table order, which must be priority order (checked
+// with TasksArePrioritySorted). Releases stay on a fixed grid (offset + k * period) so a late run
+// does not push later releases back. Times are in microseconds and wrap-safe.
+
+template<typename Context>
+struct TaskSpec {
+    void (Context::*run)();
+    uint32_t periodUs;
+    uint32_t offsetUs; // First release relative to start(), spreads tasks apart
+    uint8_t priority; // 0 = most important
+};
+
+// Runtime accounting for one task
+struct TaskStats {
+    uint32_t runs = 0;
+    uint32_t overruns = 0; // Releases skipped because the task was a whole period (or more) late
+    uint32_t lastJitterUs = 0; // Actual start - scheduled release
+    uint32_t maxJitterUs = 0;
+    uint32_t wcetUs = 0; // Worst-case execution time
+};
+
+// True if the task table is listed from most to least important
+template<typename Context, size_t N>
+constexpr bool TasksArePrioritySorted(const TaskSpec<Context> (&tasks)[N]) {
+    for(size_t i = 1; i < N; i++) {
+        if(tasks[i].priority < tasks[i - 1].priority) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// True if every task has a handler and a non-zero period
+template<typename Context, size_t N>
+constexpr bool TasksAreValid(const TaskSpec<Context> (&tasks)[N]) {
+    for(size_t i = 0; i < N; i++) {
+        if(tasks[i].run == nullptr || tasks[i].periodUs == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Context, size_t N>
+class Scheduler {
+    private:
+        const TaskSpec<Context>* tasks;
+        Clock& clock;
+        uint32_t nextRelease[N];
+        TaskStats stats[N];
+
+    public:
+        Scheduler(const TaskSpec<Context> (&table)[N], Clock& clockIn)
+            : tasks(table), clock(clockIn), nextRelease{} {}
+
+        // Puts every task on its grid relative to now
+        void start() {
+            const uint32_t now = clock.micros();
+            for(size_t i = 0; i < N; i++) {
+                nextRelease[i] = now + tasks[i].offsetUs;
+            }
+        }
+
+        // Runs every task that is due, most important first
+        void poll(Context& context) {
+            for(size_t i = 0; i < N; i++) {
+                const uint32_t begin = clock.micros();
+                if(static_cast<int32_t>(begin - nextRelease[i]) < 0) {
+                    continue;
+                }
+
+                (context.*(tasks[i].run))();
+                const uint32_t end = clock.micros();
+
+                TaskStats& s = stats[i];
+                s.runs++;
+                s.lastJitterUs = begin - nextRelease[i];
+                if(s.lastJitterUs > s.maxJitterUs) {
+                    s.maxJitterUs = s.lastJitterUs;
+                }
+                if((end - begin) > s.wcetUs) {
+                    s.wcetUs = end - begin;
+                }
+
+                // Next slot on the grid; any slots already in the past are counted and skipped
+                nextRelease[i] += tasks[i].periodUs;
+                if(static_cast<int32_t>(end - nextRelease[i]) >= 0) {
+                    const uint32_t missed = (end - nextRelease[i]) / tasks[i].periodUs + 1;
+                    s.overruns += missed;
+                    nextRelease[i] += missed * tasks[i].periodUs;
+                }
+            }
+        }
+
+        const TaskStats& getStats(size_t index) const {
+            return stats[index];
+        }
+
+        static constexpr size_t size() {
+            return N;
+        }
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SD_BLOCK_STORAGE_H
+#define SD_BLOCK_STORAGE_H
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include "Hal.h"
+
+// TEENSY 4.1 BUILT-IN SD SLOT AS BLOCK STORAGE
+// begin() creates the next free LOGnnn.BIN (earlier runs are kept) as one contiguous file of the
+// requested size up front, so logging is raw sector writes into a known range: no FAT updates and no
+// allocation while driving. The SDIO FIFO mode streams consecutive sectors as one multi-block write;
+// busy() is true while the card can't take the next sector yet, so BlockLogger never waits inside
+// writeSector().
+
+class SdBlockStorage : public BlockStorage {
+    private:
+        SdFat32 sd;
+        File32 file;
+        uint32_t firstSector = 0;
+        uint32_t sectors = 0;
+        char path[12] = "LOG000.BIN";
+
+    public:
+        // Creates a sectorCount * 512 byte log file. False if there is no card, no free name or no space
+        bool begin(uint32_t sectorCount) {
+            if(!sd.begin(SdioConfig(FIFO_SDIO))) {
+                return false;
+            }
+            uint16_t index = 0;
+            for(; index < 1000; index++) {
+                path[3] = '0' + index / 100;
+                path[4] = '0' + (index / 10) % 10;
+                path[5] = '0' + index % 10;
+                if(!sd.exists(path)) {
+                    break;
+                }
+            }
+            if(index == 1000 || !file.createContiguous(path, sectorCount * 512UL)) {
+                return false;
+            }
+            uint32_t lastSector = 0;
+            if(!file.contiguousRange(&firstSector, &lastSector)) {
+                return false;
+            }
+            sectors = lastSector - firstSector + 1;
+            return true;
+        }
+
+        bool busy() override {
+            return sectors == 0 || sd.card()->isBusy();
+        }
+
+        bool writeSector(uint32_t sector, const uint8_t* data) override {
+            if(sector >= sectors) {
+                return false;
+            }
+            return sd.card()->writeSector(firstSector + sector, data);
+        }
+
+        uint32_t sectorCount() const override {
+            return sectors;
+        }
+
+        const char* fileName() const {
+            return path;
+        }
+};
+
+#endif
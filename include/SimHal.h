@@ -0,0 +1,165 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <vector>
+#include "CanFilter.h"
+#include "Hal.h"
+
+// HOST SIMULATION OF THE HAL ([env:native] only)
+// Time only moves when the harness advances SimClock, so a run is deterministic and goes as fast
+// as the host allows. SimCanBus models one controller: frames injected with a delivery time show
+// up in read() once the clock gets there, and everything the ECU writes is handed to a listener.
+// By default writes go out instantly; setTxQueue() models a finite controller TX queue that
+// drains one frame per frame time, so write() can fail like a full FlexCAN TX ring.
+// SimCanFdBus is the receive side of a CAN FD controller in the same way.
+
+class SimClock : public Clock {
+    private:
+        uint64_t nowUs = 0;
+
+    public:
+        uint32_t millis() override;
+
+        uint32_t micros() override;
+
+        void advance(uint64_t us);
+
+        void set(uint64_t us);
+
+        uint64_t now() const; // -> Full 64-bit virtual time in us
+};
+
+class SimGpio : public Gpio {
+    private:
+        static constexpr uint8_t PIN_COUNT = 64;
+        uint8_t modes[PIN_COUNT] = {};
+        uint8_t levels[PIN_COUNT] = {};
+
+    public:
+        void pinMode(uint8_t pin, uint8_t mode) override;
+
+        void digitalWrite(uint8_t pin, uint8_t value) override;
+
+        uint8_t level(uint8_t pin) const;
+};
+
+// A frame the ECU transmitted, stamped with virtual time
+struct SimTxFrame {
+    uint64_t timeUs;
+    CAN_message_t msg;
+};
+
+class SimCanBus : public CanBus {
+    private:
+        struct Pending {
+            uint64_t deliverUs;
+            uint64_t order; // Keeps injection order for frames due at the same time
+            CAN_message_t msg;
+
+            bool operator>(const Pending& other) const {
+                return (deliverUs != other.deliverUs) ? deliverUs > other.deliverUs
+                                                      : order > other.order;
+            }
+        };
+
+        SimClock& clock;
+        size_t rxCapacity;
+        uint64_t injected = 0;
+        uint32_t rxDrops = 0;
+
+        std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> inFlight;
+        std::deque<CAN_message_t> rxQueue; // Delivered and waiting for read() (the RX ring)
+        std::vector<SimTxFrame> txLog;
+        std::function<void(const SimTxFrame&)> txListener;
+
+        const AcceptanceFilter* filters = nullptr; // nullptr = every ID reaches the RX ring
+        uint8_t filterCount = 0;
+        uint32_t rejected = 0;
+
+        size_t txCapacity = 0; // 0 = unlimited, frames leave on write()
+        uint32_t txFrameUs = 0;
+        uint64_t txFreeUs = 0; // When the last queued frame finishes
+        std::deque<SimTxFrame> txQueue; // Stamped with the time each frame completes
+
+        void deliverDue(); // -> Moves frames whose time has come into the RX ring
+
+        bool accepted(const CAN_message_t& msg) const;
+
+        void transmitDue(); // -> Finishes queued TX frames whose time has come
+
+        void transmit(const SimTxFrame& frame);
+
+    public:
+        // Default RX ring matches RX_SIZE_256
+        explicit SimCanBus(SimClock& clockIn, size_t rxSize = 256);
+
+        bool read(CAN_message_t& msg) override;
+
+        bool write(const CAN_message_t& msg) override;
+
+        void inject(const CAN_message_t& msg); // -> Arrives now
+
+        void inject(const CAN_message_t& msg, uint64_t atUs);
+
+        void onTransmit(std::function<void(const SimTxFrame&)> listener);
+
+        // Like the FlexCAN Rx FIFO filters: other IDs are dropped on arrival and never take a ring slot
+        void setAcceptance(const AcceptanceFilter* filterTable, uint8_t count);
+
+        void deliver(); // -> Moves due frames into the RX ring now (keeps it out of timed sections)
+
+        void setTxQueue(size_t depth, uint32_t frameUs); // -> Finite TX queue, one frame per frameUs
+
+        const std::vector<SimTxFrame>& transmitted() const;
+
+        void clearTransmitted();
+
+        size_t pending() const; // -> Frames injected but not yet read
+
+        uint32_t rxDropped() const; // -> Frames lost because the RX ring was full
+
+        uint32_t filtered() const; // -> Frames the acceptance filters rejected
+};
+
+class SimCanFdBus : public CanFdBus {
+    private:
+        struct Pending {
+            uint64_t deliverUs;
+            uint64_t order;
+            CANFD_message_t msg;
+
+            bool operator>(const Pending& other) const {
+                return (deliverUs != other.deliverUs) ? deliverUs > other.deliverUs
+                                                      : order > other.order;
+            }
+        };
+
+        SimClock& clock;
+        size_t rxCapacity;
+        uint64_t injected = 0;
+        uint32_t rxDrops = 0;
+        uint32_t writes = 0;
+
+        std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> inFlight;
+        std::deque<CANFD_message_t> rxQueue;
+
+    public:
+        explicit SimCanFdBus(SimClock& clockIn, size_t rxSize = 256);
+
+        bool read(CANFD_message_t& msg) override;
+
+        bool write(const CANFD_message_t& msg) override; // -> Counted only, nothing listens on CAN3
+
+        void inject(const CANFD_message_t& msg, uint64_t atUs);
+
+        uint32_t rxDropped() const;
+
+        uint32_t written() const;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// WAIT-FREE SINGLE-PRODUCER / SINGLE-CONSUMER RING
+// One context pushes (e.g. a CAN ISR) and one context pops (e.g. loop()). Neither side ever
+// waits on the other: push fails when full and pop fails when empty. Indices run free and are
+// masked on access, so Capacity must be a power of two. No Arduino dependencies so the same
+// template builds on the host.
+
+template<typename T, uint32_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+    private:
+        static constexpr uint32_t MASK = Capacity - 1;
+
+        // Producer and consumer indices on separate cache lines so they don't false-share
+        alignas(64) std::atomic<uint32_t> head{0}; // Next slot to write (producer owned)
+        alignas(64) std::atomic<uint32_t> tail{0}; // Next slot to read (consumer owned)
+        alignas(64) std::atomic<uint32_t> dropCount{0}; // Failed pushes (producer owned)
+
+        T slots[Capacity];
+
+    public:
+        // Producer side: copies item in, returns false (and counts a drop) if the ring is full
+        bool push(const T& item) {
+            const uint32_t h = head.load(std::memory_order_relaxed);
+            if(h - tail.load(std::memory_order_acquire) >= Capacity) {
+                dropCount.store(dropCount.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+                return false;
+            }
+            slots[h & MASK] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: copies the oldest item out, returns false if the ring is empty
+        bool pop(T& item) {
+            const uint32_t t = tail.load(std::memory_order_relaxed);
+            if(t == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = slots[t & MASK];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: copies the oldest item out without removing it
+        bool peek(T& item) const {
+            const uint32_t t = tail.load(std::memory_order_relaxed);
+            if(t == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = slots[t & MASK];
+            return true;
+        }
+
+        // Consumer side: removes the oldest item (after a successful peek)
+        void discard() {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Items currently queued (a snapshot; either side may move it immediately)
+        uint32_t size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        bool empty() const {
+            return size() == 0;
+        }
+
+        // Pushes rejected because the ring was full
+        uint32_t dropped() const {
+            return dropCount.load(std::memory_order_relaxed);
+        }
+
+        static constexpr uint32_t capacity() {
+            return Capacity;
+        }
+};
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef STREAM_FILTER_H
+#define STREAM_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// STREAMING SAMPLE FILTER (THROTTLE, BRAKE AND OTHER ANALOG CHANNELS)
+// Keeps the last Capacity samples in a ring so the window and mode can change at runtime
+// without a restart: reconfiguring rebuilds the running state from the stored history.
+//   MovingAverage -> running int32 sum, shifted by log2(window): O(1) per sample, no division
+//   Ema           -> Q8 state with alpha = 1 / window, also a shift: O(1) per sample
+//   Median        -> sorts a copy of the window (O(window^2), meant for small odd windows)
+// Average and EMA windows are rounded down to a power of two. The first sample after a reset
+// fills the whole history, so a window is always full and never divided by a partial count.
+// replace() revises the newest sample (a later reading of the same period) without aging the window.
+// Samples must stay within +-2^23 (Q8 EMA state in 32 bits); ADC counts and Q12 positions do.
+
+enum class FilterMode : uint8_t {
+    MovingAverage,
+    Ema,
+    Median,
+};
+
+struct FilterConfig {
+    FilterMode mode;
+    uint8_t window; // Samples; clamped to 1..Capacity (power of two unless Median)
+};
+
+template<typename T, size_t Capacity>
+class StreamFilter {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(sizeof(T) <= sizeof(int32_t), "Running state is 32-bit");
+
+    private:
+        static constexpr size_t MASK = Capacity - 1;
+        static constexpr int EMA_SHIFT = 8;
+
+        T samples[Capacity] = {};
+        size_t head = 0; // Next slot to write
+        bool primed = false; // False until the first sample has filled the history
+
+        FilterMode mode = FilterMode::MovingAverage;
+        size_t window = 1;
+        uint8_t windowShift = 0; // log2(window) for the average and EMA
+
+        int32_t sum = 0; // Of the newest window samples
+        int32_t emaState = 0; // Q8
+        int32_t emaBefore = 0; // Q8 state before the newest sample, for replace()
+        T output = 0;
+
+        T at(size_t age) const { // age 0 = newest
+            return samples[(head - 1 - age) & MASK];
+        }
+
+        T median() const {
+            T sorted[Capacity];
+            for(size_t i = 0; i < window; i++) {
+                const T value = at(i);
+                size_t j = i;
+                for(; j > 0 && sorted[j - 1] > value; j--) {
+                    sorted[j] = sorted[j - 1];
+                }
+                sorted[j] = value;
+            }
+            return sorted[window / 2];
+        }
+
+        T filter(T newest) { // -> Output once newest is in the ring and the sum
+            switch(mode) {
+                case FilterMode::MovingAverage:
+                    output = static_cast<T>(sum >> windowShift);
+                    break;
+                case FilterMode::Ema:
+                    emaState += ((static_cast<int32_t>(newest) << EMA_SHIFT) - emaState) >> windowShift;
+                    output = static_cast<T>(emaState >> EMA_SHIFT);
+                    break;
+                case FilterMode::Median:
+                    output = median();
+                    break;
+            }
+            return output;
+        }
+
+        void rebuild() {
+            sum = 0;
+            emaState = 0;
+            emaBefore = 0;
+            output = 0;
+            if(!primed) {
+                return;
+            }
+            for(size_t i = 0; i < window; i++) {
+                sum += at(i);
+            }
+            // EMA restarts from the window average so switching modes does not step the output
+            emaState = (sum << EMA_SHIFT) >> windowShift;
+            emaBefore = emaState;
+            output = (mode == FilterMode::Median) ? median() : static_cast<T>(sum >> windowShift);
+        }
+
+    public:
+        StreamFilter() {}
+
+        explicit StreamFilter(const FilterConfig& config) {
+            configure(config);
+        }
+
+        void configure(const FilterConfig& config) {
+            mode = config.mode;
+            window = (config.window < 1) ? 1 : ((config.window > Capacity) ? Capacity : config.window);
+            windowShift = 0;
+            while((static_cast<size_t>(2) << windowShift) <= window) {
+                windowShift++;
+            }
+            if(mode != FilterMode::Median) {
+                window = static_cast<size_t>(1) << windowShift;
+            }
+            rebuild();
+        }
+
+        T update(T sample) {
+            if(!primed) {
+                for(size_t i = 0; i < Capacity; i++) {
+                    samples[i] = sample;
+                }
+                primed = true;
+                rebuild();
+                return output;
+            }
+            sum += static_cast<int32_t>(sample) - at(window - 1); // Oldest leaves the window (still in the ring)
+            samples[head] = sample;
+            head = (head + 1) & MASK;
+            emaBefore = emaState;
+            return filter(sample);
+        }
+
+        T replace(T sample) {
+            if(!primed) {
+                return update(sample);
+            }
+            sum += static_cast<int32_t>(sample) - at(0);
+            samples[(head - 1) & MASK] = sample;
+            emaState = emaBefore;
+            return filter(sample);
+        }
+
+        T value() const {
+            return output;
+        }
+
+        size_t getWindow() const { // -> Window in use after rounding
+            return window;
+        }
+
+        void reset() {
+            head = 0;
+            primed = false;
+            rebuild();
+        }
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef TEENSY_HAL_H
+#define TEENSY_HAL_H
+
+#include <Arduino.h>
+#include "CanFilter.h"
+#include "FlexCAN_T4.h"
+#include "Hal.h"
+
+// TEENSY 4.1 IMPLEMENTATIONS OF THE HAL INTERFACES
+
+// Wraps (does not copy) a FlexCAN_T4 controller owned by main.cpp
+template<CAN_DEV_TABLE Bus, RXQUEUE_TABLE RxSize = RX_SIZE_256, TXQUEUE_TABLE TxSize = TX_SIZE_16>
+class FlexCanBus : public CanBus {
+    private:
+        FlexCAN_T4<Bus, RxSize, TxSize>& can;
+
+    public:
+        explicit FlexCanBus(FlexCAN_T4<Bus, RxSize, TxSize>& controller) : can(controller) {}
+
+        bool read(CAN_message_t& msg) override {
+            return can.read(msg);
+        }
+
+        bool write(const CAN_message_t& msg) override {
+            return can.write(msg) > 0;
+        }
+};
+
+// Wraps a FlexCAN_T4FD controller (CAN3 is the only FD capable one on the Teensy 4.1)
+template<CAN_DEV_TABLE Bus, RXQUEUE_TABLE RxSize = RX_SIZE_256, TXQUEUE_TABLE TxSize = TX_SIZE_16>
+class FlexCanFdBus : public CanFdBus {
+    private:
+        FlexCAN_T4FD<Bus, RxSize, TxSize>& can;
+
+    public:
+        explicit FlexCanFdBus(FlexCAN_T4FD<Bus, RxSize, TxSize>& controller) : can(controller) {}
+
+        bool read(CANFD_message_t& msg) override {
+            return can.read(msg);
+        }
+
+        bool write(const CANFD_message_t& msg) override {
+            return can.write(msg) > 0;
+        }
+};
+
+// Loads an acceptance plan into a controller's Rx FIFO (call after enableFIFO()). Everything else
+// is rejected in hardware, so unrouted frames never raise an interrupt or take a FIFO slot.
+// False if the driver refused a filter: the caller should fall back to accepting everything.
+template<CAN_DEV_TABLE Bus, RXQUEUE_TABLE RxSize, TXQUEUE_TABLE TxSize, size_t N>
+bool SetAcceptanceFilters(FlexCAN_T4<Bus, RxSize, TxSize>& can, const AcceptancePlan<N>& plan) {
+    static_assert(N <= 16, "Only the first 16 Rx FIFO filters have individual masks here");
+    can.setRFFN(RFFN_16);
+    can.setFIFOFilter(REJECT_ALL);
+    for(uint8_t i = 0; i < plan.count; i++) {
+        if(!can.setFIFOUserFilter(i, plan.filters[i].id, plan.filters[i].mask, STD)) {
+            can.setFIFOFilter(ACCEPT_ALL);
+            return false;
+        }
+    }
+    return true;
+}
+
+class TeensyClock : public Clock {
+    public:
+        uint32_t millis() override {
+            return ::millis();
+        }
+
+        uint32_t micros() override {
+            return ::micros();
+        }
+};
+
+class TeensyGpio : public Gpio {
+    public:
+        void pinMode(uint8_t pin, uint8_t mode) override {
+            ::pinMode(pin, (mode == GPIO_OUTPUT) ? OUTPUT : INPUT);
+        }
+
+        void digitalWrite(uint8_t pin, uint8_t value) override {
+            ::digitalWrite(pin, (value == GPIO_HIGH) ? HIGH : LOW);
+        }
+};
+
+#endif
@@ -1,39 +1,57 @@
 #ifndef THROTTLE_H
 #define THROTTLE_H
-#include <Arduino.h>
+#include <stdint.h>
+#include "StreamFilter.h"
+
+// Throttle output is a pedal position: 0 (released) to PEDAL_FULL_SCALE (floored), Q12.
+// Torque comes from the drive mode's TorqueMap
+constexpr int PEDAL_FULL_SCALE = 4096;
+
 class Throttle {
     private:
         int throttle1 = 0;
         int throttle2 = 0;
 
-        int maxTorque = 2200;
+        int maxTorque = PEDAL_FULL_SCALE; // Output at full pedal travel
 
         int torque = 0;
-        int rollingTorque = 0;
 
         int countMisMatch = 0;
 
-        bool throttleError;
-        bool throttleActive;
+        bool throttleError = false;
+        bool throttleActive = false;
 
-        bool throttle1UPDATE;
-        bool throttle2UPDATE;
+        bool throttle1UPDATE = false;
+        bool throttle2UPDATE = false;
 
         int readIn1 = 0;
         int readIn2 = 0;
-        int magiMemory[4];
+        StreamFilter<int, 8> pedalFilter{FilterConfig{FilterMode::MovingAverage, 4}};
 
         int minT1 = 8;
         int maxT1 = 1023;
         int minT2 = 8;
         int maxT2 = 1023;
 
+        //Pedal map as multiply-shift: position = ((adc - pedalOffset) * pedalGain) >> PEDAL_GAIN_SHIFT
+        uint32_t pedalGain = 0; // Q16 output per ADC count, rounded up
+        uint32_t pedalInSpan = 0; // map()'s exact ratio, to take back the rounding
+        uint32_t pedalOutSpan = 0;
+        uint32_t pedalDeltaLimit = 0; // Largest |adc - pedalOffset| whose products fit 32 bits
+        int32_t pedalOffset = 0;
+
+        void updatePedalScale(); // -> Only when calibration or output scale changes
+
+        int liftOff(int filtered, int average); // -> Sets torque: 0 once the pedal is released
+
     public:
         Throttle();
 
         int checkError();
 
-        int calculateTorque();
+        int calculateTorque(); // -> One new filter sample per complete pair of channel readings
+
+        int refreshTorque(); // -> Revises the newest sample with one channel's later reading
 
 
         int getTorque();
@@ -45,14 +63,16 @@ class Throttle {
         void setThrottle1(int input);
         void setThrottle2(int input);
 
-        int consultMAGI(int input);
-
         bool getActive();
 
         void setCalibrationValueMin(int min1, int min2);
         void setCalibrationValueMax(int max1, int max2);
         
         void setMaxTorque(int torqueVal);
+
+        void setFilter(const FilterConfig& config); // -> Takes effect on the next sample
+
+        int32_t mapPedal(int input) const; // -> Calibrated position for one ADC reading (same as map())
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+#ifndef TORQUE_MAP_H
+#define TORQUE_MAP_H
+
+#include <stdint.h>
+
+// PER-DRIVE-MODE TORQUE MAPS (PEDAL POSITION x MOTOR SPEED -> TORQUE)
+// Each map is generated at compile time from a TorqueMapSpec and stored as a 17 x 9 grid of
+// int16 torque values (Nm * 10, 306 bytes, row per pedal point). Both axes have power-of-two
+// spacing, so bilinear interpolation is shifts, masks and three multiplies: no division. The ECU
+// keeps the active map's column for the current motor speed as a TorqueCurve, so a pedal sample
+// costs one interpolation. Maps are read-only constants; switching drive mode swaps a pointer and
+// rebuilds the 17-point curve.
+
+constexpr int32_t TORQUE_MAP_PEDAL_SHIFT = 8; // 256 pedal counts per cell
+constexpr int32_t TORQUE_MAP_PEDAL_CELLS = 16;
+constexpr int32_t TORQUE_MAP_PEDAL_FULL_SCALE = TORQUE_MAP_PEDAL_CELLS << TORQUE_MAP_PEDAL_SHIFT; // Q12
+
+constexpr int32_t TORQUE_MAP_SPEED_SHIFT = 10; // 1024 rpm per cell
+constexpr int32_t TORQUE_MAP_SPEED_CELLS = 8;
+constexpr int32_t TORQUE_MAP_SPEED_MAX = TORQUE_MAP_SPEED_CELLS << TORQUE_MAP_SPEED_SHIFT; // rpm
+
+constexpr int32_t TORQUE_MAP_PEDAL_POINTS = TORQUE_MAP_PEDAL_CELLS + 1;
+constexpr int32_t TORQUE_MAP_SPEED_POINTS = TORQUE_MAP_SPEED_CELLS + 1;
+
+// Source description of one map
+struct TorqueMapSpec {
+    int32_t maxTorque; // Nm * 10 at full pedal below the power knee
+    int32_t powerLimitW; // Mechanical power cap: above the knee torque follows P / omega
+    int32_t progression; // 0 = linear pedal, 100 = fully quadratic (softer tip-in)
+};
+
+// Cell and fraction of a Q12 pedal position (clamped; full scale is the last cell, full fraction)
+inline void TorqueMapPedalCell(int32_t pedal, int32_t& cell, int32_t& frac) {
+    if(pedal < 0) {
+        pedal = 0;
+    } else if(pedal > TORQUE_MAP_PEDAL_FULL_SCALE) {
+        pedal = TORQUE_MAP_PEDAL_FULL_SCALE;
+    }
+    cell = pedal >> TORQUE_MAP_PEDAL_SHIFT;
+    frac = pedal & ((1 << TORQUE_MAP_PEDAL_SHIFT) - 1);
+    if(cell == TORQUE_MAP_PEDAL_CELLS) {
+        cell--;
+        frac = 1 << TORQUE_MAP_PEDAL_SHIFT;
+    }
+}
+
+// Cell and fraction of a motor speed in rpm (either direction, clamped like the pedal)
+inline void TorqueMapSpeedCell(int32_t rpm, int32_t& cell, int32_t& frac) {
+    if(rpm < 0) {
+        rpm = -rpm;
+    }
+    if(rpm > TORQUE_MAP_SPEED_MAX) {
+        rpm = TORQUE_MAP_SPEED_MAX;
+    }
+    cell = rpm >> TORQUE_MAP_SPEED_SHIFT;
+    frac = rpm & ((1 << TORQUE_MAP_SPEED_SHIFT) - 1);
+    if(cell == TORQUE_MAP_SPEED_CELLS) {
+        cell--;
+        frac = 1 << TORQUE_MAP_SPEED_SHIFT;
+    }
+}
+
+struct TorqueMap {
+    int16_t torque[TORQUE_MAP_PEDAL_POINTS][TORQUE_MAP_SPEED_POINTS];
+
+    // One pedal point interpolated along the speed axis
+    int32_t atSpeed(int32_t pedalPoint, int32_t cell, int32_t frac) const {
+        const int16_t* row = torque[pedalPoint];
+        return row[cell] + (((row[cell + 1] - row[cell]) * frac) >> TORQUE_MAP_SPEED_SHIFT);
+    }
+
+    // Torque (Nm * 10) for a Q12 pedal position and a motor speed in rpm (either direction)
+    int32_t lookup(int32_t pedal, int32_t rpm) const {
+        int32_t p;
+        int32_t pFrac;
+        int32_t s;
+        int32_t sFrac;
+        TorqueMapPedalCell(pedal, p, pFrac);
+        TorqueMapSpeedCell(rpm, s, sFrac);
+        const int32_t lowRow = atSpeed(p, s, sFrac);
+        const int32_t highRow = atSpeed(p + 1, s, sFrac);
+        return lowRow + (((highRow - lowRow) * pFrac) >> TORQUE_MAP_PEDAL_SHIFT);
+    }
+};
+
+// One map at one motor speed: the speed half of the bilinear lookup done once when the speed (or
+// the map) changes, so the per-sample pedal lookup is a single interpolation. Full scale is the
+// first point of a flat extra cell instead of a special case. Gives exactly what
+// TorqueMap::lookup() gives for that speed.
+struct TorqueCurve {
+    int16_t torque[TORQUE_MAP_PEDAL_POINTS + 1] = {}; // Between two int16 grid values, so int16 too
+
+    void build(const TorqueMap& map, int32_t rpm) {
+        int32_t s;
+        int32_t sFrac;
+        TorqueMapSpeedCell(rpm, s, sFrac);
+        for(int32_t p = 0; p < TORQUE_MAP_PEDAL_POINTS; p++) {
+            torque[p] = static_cast<int16_t>(map.atSpeed(p, s, sFrac));
+        }
+        torque[TORQUE_MAP_PEDAL_POINTS] = torque[TORQUE_MAP_PEDAL_CELLS];
+    }
+
+    // Torque (Nm * 10) for a Q12 pedal position
+    int32_t lookup(int32_t pedal) const {
+        pedal = (pedal < 0) ? 0 : ((pedal > TORQUE_MAP_PEDAL_FULL_SCALE) ? TORQUE_MAP_PEDAL_FULL_SCALE : pedal);
+        const int32_t p = pedal >> TORQUE_MAP_PEDAL_SHIFT;
+        const int32_t frac = pedal & ((1 << TORQUE_MAP_PEDAL_SHIFT) - 1);
+        return torque[p] + (((torque[p + 1] - torque[p]) * frac) >> TORQUE_MAP_PEDAL_SHIFT);
+    }
+};
+
+// Grid value for one pedal/speed point of a spec (rounded to the nearest Nm * 10)
+constexpr int16_t TorqueMapPoint(const TorqueMapSpec& spec, int32_t pedalPoint, int32_t speedPoint) {
+    const double pedal = static_cast<double>(pedalPoint) / TORQUE_MAP_PEDAL_CELLS;
+    const double curve = pedal + (pedal * pedal - pedal) * spec.progression / 100.0;
+    const double rpm = static_cast<double>(speedPoint << TORQUE_MAP_SPEED_SHIFT);
+    const double omega = rpm * 2.0 * 3.14159265358979 / 60.0;
+
+    double ceiling = spec.maxTorque;
+    if(omega > 0.0 && spec.powerLimitW * 10.0 / omega < ceiling) {
+        ceiling = spec.powerLimitW * 10.0 / omega; // W / (rad/s) = Nm, * 10 for Nm * 10
+    }
+    return static_cast<int16_t>(ceiling * curve + 0.5);
+}
+
+constexpr TorqueMap MakeTorqueMap(const TorqueMapSpec& spec) {
+    TorqueMap map = {};
+    for(int32_t p = 0; p < TORQUE_MAP_PEDAL_POINTS; p++) {
+        for(int32_t s = 0; s < TORQUE_MAP_SPEED_POINTS; s++) {
+            map.torque[p][s] = TorqueMapPoint(spec, p, s);
+        }
+    }
+    return map;
+}
+
+#endif
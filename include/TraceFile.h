@@ -0,0 +1,36 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "CanTrace.h"
+
+// HOST-SIDE TRACE FILES ([env:native] only)
+
+// Records every tapped frame to a binary ECUTRACE file
+class TraceWriter : public FrameTap {
+    private:
+        FILE* file = nullptr;
+        uint32_t count = 0;
+
+    public:
+        ~TraceWriter();
+
+        bool open(const char* path);
+
+        void close();
+
+        void onFrame(const TraceRecord& record) override;
+
+        uint32_t records() const;
+};
+
+// Loads a whole trace. Binary ECUTRACE files and SD card logs (BlockLogger.h sectors) are detected by
+// their headers; anything else is read as candump ASCII ("candump -l" or "candump -ta" output) with
+// the named interfaces mapped to the two buses. Timestamps are rebased so the first frame is at 0.
+// Returns false if the file can't be read.
+bool LoadTrace(const char* path, std::vector<TraceRecord>& records,
+               const char* comsInterface = "can0", const char* motorInterface = "can1");
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TRACTION_CONTROL_H
+#define TRACTION_CONTROL_H
+
+#include <stdint.h>
+#include "Hal.h"
+
+// SLIP-RATIO TRACTION CONTROL
+// Wheel-speed frames update the slip ratio (driven rear vs. undriven front, Q12) as they
+// arrive, stamped with their receive time. update() steps the torque cap from its own scheduler
+// task, so the controller runs at a fixed rate whether or not pedal frames arrive, and limit()
+// on the torque path is a multiply and a shift: no loops, no division. While slip is above
+// target the cap is cut in proportion to the excess; below target it recovers at a fixed rate.
+// Stale or missing wheel data passes torque through.
+
+constexpr int32_t SLIP_SHIFT = 12; // Slip ratio and torque cap are Q12 (4096 = 1.0)
+constexpr int32_t SLIP_ONE = 1 << SLIP_SHIFT;
+constexpr uint32_t TRACTION_UPDATE_PERIOD_US = 5000; // 200 Hz: the rate the gains were tuned at (once per throttle frame)
+
+struct TractionStats {
+    uint32_t interventions = 0; // Times the limiter started cutting torque
+    uint32_t totalInterventionUs = 0; // Time spent cutting torque
+    uint32_t lastInterventionUs = 0; // Length of the most recent finished intervention
+    int32_t peakSlip = 0; // Q12
+};
+
+class TractionControl {
+    private:
+        Clock& clock;
+
+        int32_t frontLeft = 0; // Wheel rpm
+        int32_t frontRight = 0;
+        int32_t rearLeft = 0;
+        int32_t rearRight = 0;
+        uint32_t frontMicros = 0;
+        uint32_t rearMicros = 0;
+        bool frontSeen = false;
+        bool rearSeen = false;
+
+        int32_t slip = 0; // Q12, (rear - front) / front
+        int32_t targetSlip = 0; // Q12, 0 = disabled
+        int32_t torqueCap = SLIP_ONE; // Q12 share of the request let through
+
+        bool intervening = false;
+        uint32_t interventionStart = 0;
+        TractionStats stats;
+
+        void updateSlip();
+
+    public:
+        explicit TractionControl(Clock& clockIn);
+
+        void setFrontWheels(int16_t leftRpm, int16_t rightRpm, uint32_t rxMicros);
+        void setRearWheels(int16_t leftRpm, int16_t rightRpm, uint32_t rxMicros);
+
+        void setTargetSlip(int32_t target); // -> Q12, 0 turns the limiter off
+
+        void update(); // -> One controller step, runs every TRACTION_UPDATE_PERIOD_US
+        int32_t limit(int32_t torque) const; // -> Runs on every torque command
+
+        int32_t getSlip() const;
+        int32_t getTorqueCap() const;
+        bool isIntervening() const;
+        const TractionStats& getStats() const;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+#include <stdint.h>
+#include "Hal.h"
+#include "Ring.h"
+
+// PRIORITY TX LAYER (ONE PER BUS)
+// Frames wait here, per priority class, instead of in the controller's FIFO TX ring, so a burst
+// of low-priority frames can never sit in front of a torque command. service() hands frames to
+// the bus highest class first, but only while fewer than TX_IN_FLIGHT_LIMIT frames are estimated
+// to be still in the controller. The control class is a single latest-value slot: a newer torque
+// command replaces one still waiting.
+//
+// The in-flight count is an estimate, not the controller's state: CanBus (and FlexCAN_T4 behind
+// it) reports nothing about the TX mailboxes beyond write() refusing a frame. Each frame handed
+// over is assumed done TX_FRAME_TIME_US after the previous one. Frames from other nodes winning
+// arbitration make the real backlog longer than the estimate; then the controller's own ring
+// fills up and write() refusing is what holds frames back here.
+
+enum TxClass : uint8_t {
+    TxControl = 0, // Torque command (latest value wins)
+    TxSafety = 1, // Faults, drive state changes
+    TxStatus = 2, // Inverter ping/parameters, dash status, health check
+    TxDiagnostic = 3, // Scheduler stats, profiler dump
+    TX_CLASS_COUNT
+};
+
+constexpr uint32_t TX_CLASS_DEPTH = 8; // Frames per queued class
+constexpr uint8_t TX_IN_FLIGHT_LIMIT = 2; // Frames the estimate lets into the controller at once
+constexpr uint32_t TX_FRAME_TIME_US = 540; // Worst-case 8-byte standard frame at 250 kbit/s
+
+struct TxClassStats {
+    uint32_t sent = 0;
+    uint32_t dropped = 0; // Class queue full
+    uint32_t coalesced = 0; // Replaced while waiting (control class)
+    uint32_t maxDelayUs = 0; // Queued -> accepted by the bus
+    uint32_t totalDelayUs = 0; // Wraps; divide deltas by sent deltas for a mean
+};
+
+class TxScheduler {
+    private:
+        struct TxEntry {
+            CAN_message_t msg;
+            uint32_t queuedMicros;
+        };
+
+        Clock& clock;
+        CanBus* bus = nullptr;
+
+        CAN_message_t latest;
+        uint32_t latestMicros = 0;
+        bool latestPending = false;
+
+        Ring<TxEntry, TX_CLASS_DEPTH> queues[TX_CLASS_COUNT - 1]; // TxSafety and below (same thread as service())
+
+        uint8_t estimatedInFlight = 0; // Frames handed to the bus that may still be waiting
+        uint32_t estimateSince = 0; // When the oldest of them started on the wire, by the estimate
+
+        TxClassStats stats[TX_CLASS_COUNT];
+
+        void updateInFlightEstimate(uint32_t now);
+
+        void recordSent(TxClass txClass, uint32_t queuedMicros, uint32_t now);
+
+    public:
+        explicit TxScheduler(Clock& clockIn);
+
+        void attach(CanBus& busIn);
+
+        bool send(const CAN_message_t& msg, TxClass txClass); // -> False (counted) if the class queue is full
+
+        void sendLatest(const CAN_message_t& msg); // -> Control slot
+
+        void service(); // -> Moves waiting frames to the bus (call every loop pass)
+
+        uint32_t backlog() const;
+
+        const TxClassStats& getStats(TxClass txClass) const;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdio.h>
+#include <string.h>
+#endif
+#include "BinaryLog.h"
+#include "SpscRing.h"
+
+constexpr uint8_t LOG_FRAME_SIZE = sizeof(LogRecord) + 2; // Sync bytes + record
+
+static const char* const LOG_EVENT_NAMES[] = {
+    "T1",
+    "T2",
+    "MOTOR_COMMAND",
+    "MOTOR_START",
+    "INITIAL_START",
+    "START_ABORTED",
+    "START_FAULT",
+    "SHUTDOWN",
+    "BTO_SET",
+    "BTO_RELEASED",
+    "TC_START",
+    "TC_END",
+    "FAULT",
+    "NODE_LOST",
+    "NODE_BACK",
+};
+
+static_assert(sizeof(LOG_EVENT_NAMES) / sizeof(LOG_EVENT_NAMES[0]) == LOG_EVENT_COUNT,
+              "Every LogEvent needs a name");
+
+// Producer is the main loop (never an ISR), consumer is the flush task
+static SpscRing<LogRecord, LOG_RING_SIZE> logRing;
+static uint16_t logSequence = 0;
+static Clock* logClock = nullptr;
+
+void BinaryLog::begin(Clock& clock) {
+    logClock = &clock;
+}
+
+void BinaryLog::record(uint8_t level, LogEvent event, int32_t a, int32_t b) {
+    const uint32_t now = (logClock != nullptr) ? logClock->micros() : 0;
+    const LogRecord entry = {now, event, level, logSequence++, a, b};
+    logRing.push(entry);
+}
+
+uint16_t BinaryLog::flush(uint16_t maxRecords) {
+    uint16_t written = 0;
+    LogRecord entry;
+
+#ifdef ARDUINO
+    // Only pop once the port can take a whole record so flushing never blocks
+    while(written < maxRecords && !logRing.empty() && Serial.availableForWrite() >= 64) {
+        logRing.pop(entry);
+#ifdef ECU_LOG_BINARY
+        uint8_t frame[LOG_FRAME_SIZE] = {LOG_SYNC_0, LOG_SYNC_1};
+        memcpy(&frame[2], &entry, sizeof(entry));
+        Serial.write(frame, LOG_FRAME_SIZE);
+#else
+        Serial.print(entry.timestampUs);
+        Serial.print(" ");
+        Serial.print(eventName(entry.event));
+        Serial.print(" ");
+        Serial.print(entry.a);
+        Serial.print(" ");
+        Serial.println(entry.b);
+#endif
+        written++;
+    }
+#else
+    while(written < maxRecords && logRing.pop(entry)) {
+#ifdef ECU_LOG_BINARY
+        uint8_t frame[LOG_FRAME_SIZE] = {LOG_SYNC_0, LOG_SYNC_1};
+        memcpy(&frame[2], &entry, sizeof(entry));
+        fwrite(frame, 1, LOG_FRAME_SIZE, stdout);
+#else
+        printf("%u %s %d %d\n", (unsigned)entry.timestampUs, eventName(entry.event),
+               (int)entry.a, (int)entry.b);
+#endif
+        written++;
+    }
+#endif
+    return written;
+}
+
+uint32_t BinaryLog::dropped() {
+    return logRing.dropped();
+}
+
+const char* BinaryLog::eventName(uint8_t event) {
+    return (event < LOG_EVENT_COUNT) ? LOG_EVENT_NAMES[event] : "UNKNOWN";
+}
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "BlackBox.h"
+
+BlackBox::BlackBox(TraceRecord* storage, uint32_t capacity, uint32_t postTriggerUs)
+    : records(storage), mask(capacity - 1), tailUs(postTriggerUs) {}
+
+void BlackBox::onFrame(const TraceRecord& record) {
+    if(state == BlackBoxState::Frozen) {
+        return;
+    }
+    records[head & mask] = record;
+    head++;
+
+    // Tail ends on time, or at half the ring so the pre-trigger history survives a frame burst
+    if(state == BlackBoxState::Triggered
+       && (static_cast<int32_t>(record.timestampUs - triggerUs) >= static_cast<int32_t>(tailUs)
+           || (head - triggerHead) > (mask >> 1))) {
+        state = BlackBoxState::Frozen;
+    }
+}
+
+void BlackBox::trigger(uint8_t why, uint32_t nowUs) {
+    if(state != BlackBoxState::Recording) {
+        return;
+    }
+    reason = why;
+    triggerHead = head;
+    triggerUs = nowUs;
+    state = (tailUs == 0) ? BlackBoxState::Frozen : BlackBoxState::Triggered;
+}
+
+void BlackBox::rearm() {
+    head = 0;
+    state = BlackBoxState::Recording;
+}
+
+BlackBoxState BlackBox::getState() const {
+    return state;
+}
+
+uint8_t BlackBox::getReason() const {
+    return reason;
+}
+
+uint32_t BlackBox::size() const {
+    return (head > mask) ? mask + 1 : head;
+}
+
+const TraceRecord& BlackBox::at(uint32_t index) const {
+    return records[(head - size() + index) & mask];
+}
+
+uint32_t BlackBox::triggerIndex() const {
+    return triggerHead - (head - size());
+}
+
+uint32_t BlackBox::dumpFrames() const {
+    return 1 + (size() * sizeof(TraceRecord) + BLACK_BOX_DUMP_BYTES - 1) / BLACK_BOX_DUMP_BYTES;
+}
+
+bool BlackBox::encodeDumpFrame(uint16_t index, uint8_t* buf) const {
+    if(index >= dumpFrames()) {
+        return false;
+    }
+    memset(buf, 0, 8);
+    buf[0] = index & 0xFF;
+    buf[1] = index >> 8;
+
+    if(index == 0) {
+        const uint32_t count = size();
+        const uint32_t triggered = (state == BlackBoxState::Recording) ? count : triggerIndex();
+        buf[2] = count & 0xFF;
+        buf[3] = count >> 8;
+        buf[4] = triggered & 0xFF;
+        buf[5] = triggered >> 8;
+        buf[6] = reason;
+        buf[7] = static_cast<uint8_t>(state);
+        return true;
+    }
+
+    const uint32_t total = size() * sizeof(TraceRecord);
+    const uint32_t offset = (index - 1) * BLACK_BOX_DUMP_BYTES;
+    for(uint8_t i = 0; i < BLACK_BOX_DUMP_BYTES && (offset + i) < total; i++) {
+        const uint32_t byte = offset + i;
+        const uint8_t* record = reinterpret_cast<const uint8_t*>(&at(byte / sizeof(TraceRecord)));
+        buf[2 + i] = record[byte % sizeof(TraceRecord)];
+    }
+    return true;
+}
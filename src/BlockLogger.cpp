@@ -0,0 +1,110 @@
+#include <string.h>
+#include "BlockLogger.h"
+
+void BlockLogger::attach(BlockStorage& storageIn) {
+    storage = &storageIn;
+}
+
+void BlockLogger::drop() {
+    stats.dropped++;
+    if(droppedSinceSector < UINT16_MAX) {
+        droppedSinceSector++;
+    }
+}
+
+void BlockLogger::onFrame(const TraceRecord& record) {
+    if(storage == nullptr || stats.full || pending[fillBuffer]) {
+        drop(); // The other buffer is still on its way to the card
+        return;
+    }
+    buffers[fillBuffer][fillSector].records[fillRecord++] = record;
+    stats.frames++;
+    if(fillRecord == LOG_RECORDS_PER_SECTOR) {
+        closeSector();
+    }
+}
+
+//STAMPS THE HEADER AND MOVES ON (A FULL BUFFER IS HANDED TO service())
+void BlockLogger::closeSector() {
+    LogSector& sector = buffers[fillBuffer][fillSector];
+    if(fillRecord < LOG_RECORDS_PER_SECTOR) {
+        memset(&sector.records[fillRecord], 0, (LOG_RECORDS_PER_SECTOR - fillRecord) * sizeof(TraceRecord));
+    }
+    sector.header = {LOG_SECTOR_MAGIC, sequence++, static_cast<uint16_t>(fillRecord), droppedSinceSector};
+    droppedSinceSector = 0;
+    fillRecord = 0;
+    fillSector++;
+    if(fillSector == LOG_BUFFER_SECTORS) {
+        closeBuffer();
+    }
+}
+
+void BlockLogger::closeBuffer() {
+    pendingSectors[fillBuffer] = fillSector;
+    pending[fillBuffer] = true;
+    fillBuffer ^= 1;
+    fillSector = 0;
+}
+
+bool BlockLogger::service() {
+    if(storage == nullptr || !pending[writeBuffer] || storage->busy()) {
+        return false;
+    }
+    if(nextSector >= storage->sectorCount()) {
+        // Out of preallocated space: everything still buffered is lost
+        stats.full = true;
+        for(uint8_t b = 0; b < 2; b++) {
+            if(pending[b]) {
+                for(uint32_t s = 0; s < pendingSectors[b]; s++) {
+                    stats.dropped += buffers[b][s].header.records;
+                }
+                pending[b] = false;
+            }
+        }
+        return false;
+    }
+
+    if(storage->writeSector(nextSector, reinterpret_cast<const uint8_t*>(&buffers[writeBuffer][writeIndex]))) {
+        stats.sectorsWritten++;
+    } else {
+        stats.writeErrors++;
+    }
+    nextSector++;
+    writeIndex++;
+    if(writeIndex == pendingSectors[writeBuffer]) {
+        pending[writeBuffer] = false;
+        writeBuffer ^= 1;
+        writeIndex = 0;
+    }
+    return true;
+}
+
+void BlockLogger::flush() {
+    if(pending[fillBuffer]) {
+        return; // Still waiting on the other buffer: nothing new can be closed
+    }
+    if(fillRecord > 0) {
+        closeSector(); // May close the buffer too if this was its last sector
+    }
+    if(fillSector > 0) {
+        closeBuffer();
+    }
+}
+
+bool BlockLogger::idle() const {
+    return !pending[0] && !pending[1];
+}
+
+uint32_t BlockLogger::pendingSectorCount() const {
+    uint32_t waiting = 0;
+    for(uint8_t b = 0; b < 2; b++) {
+        if(pending[b]) {
+            waiting += pendingSectors[b] - ((b == writeBuffer) ? writeIndex : 0);
+        }
+    }
+    return waiting;
+}
+
+const BlockLogStats& BlockLogger::getStats() const {
+    return stats;
+}
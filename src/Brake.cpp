@@ -7,8 +7,13 @@ constexpr int BL_PIN = 13; //PLACEHOLDER
 
 // Strong error handling should help? driving dynamics might be worse without it tho
 
-Brake::Brake() {
+Brake::Brake(Clock& clockIn, Gpio& gpioIn) : clock(clockIn), gpio(gpioIn) {
     brakeVal = 0;
+    rawVal = 0;
+    timeErrorStart = 0;
+    brakeActive = false;
+    errorState = 0;
+    brakePin = BL_PIN;
 }
 
 bool Brake::getBrakeActive() {
@@ -22,7 +27,8 @@ int Brake::getBrakeVal() {
 
 void Brake::updateValue(int data) {
 
-    brakeVal = data;
+    rawVal = data;
+    brakeVal = filter.update(data);
     updateLight(); // call before updating brakeActive
     brakeActive = getBrakeActive();
     checkError();
@@ -30,22 +36,22 @@ void Brake::updateValue(int data) {
 
 void Brake::updateLight() {
     if(brakeActive && !getBrakeActive()) {
-        digitalWrite(BL_PIN, LOW);
+        gpio.digitalWrite(BL_PIN, GPIO_LOW);
     } else if(!brakeActive && getBrakeActive()) {
-        digitalWrite(BL_PIN, HIGH);
+        gpio.digitalWrite(BL_PIN, GPIO_HIGH);
     }
 }
 
 bool Brake::checkError() {
     //Check if the pull-down resistor is active on the brake
-    if(brakeVal <= 1) {
+    if(rawVal <= 1) {
         
-        if(errorState == 1 && (millis() - timeErrorStart) > 100) {
+        if(errorState == 1 && (clock.millis() - timeErrorStart) > 100) {
             errorState = 2; //Set critical error
             return true;
         } else if(errorState == 0) { //not in error currently
             errorState = 1; //Set in initial error
-            timeErrorStart = millis();
+            timeErrorStart = clock.millis();
             return false;
         }
         //Returns false if we are in an error but not critical
@@ -63,8 +69,13 @@ bool Brake::checkError() {
         timeErrorStart = 0;
         return false;
     }
+    return false; // Healthy and was healthy
 }
 
 int Brake::getBrakeErrorState() {
     return errorState;
-}
\ No newline at end of file
+}
+
+void Brake::setFilter(const FilterConfig& config) {
+    filter.configure(config);
+}
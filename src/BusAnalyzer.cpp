@@ -0,0 +1,355 @@
+#include <math.h>
+#include <string.h>
+#include "BusAnalyzer.h"
+#include "CanSchema.h"
+
+constexpr uint16_t CAN_CRC15_POLY = 0x4599;
+constexpr uint32_t CAN_FIXED_TAIL_BITS = 13; // CRC delimiter, ACK slot + delimiter, EOF, intermission
+constexpr uint32_t GAP_SQUARE_LIMIT_US = 1u << 24; // Longer gaps are clipped in the jitter sum
+
+//DUMP LAYOUT (after [slot, part])
+using DumpSlot = CanField<uint8_t, 0>;
+using DumpPart = CanField<uint8_t, 1>;
+using DumpWord = CanField<uint32_t, 2>;
+using DumpHalf = CanField<uint16_t, 6>;
+using DumpByte = CanField<uint8_t, 6>;
+using DumpHalfA = CanField<uint16_t, 2>;
+using DumpHalfB = CanField<uint16_t, 4>;
+using DumpFlags = CanField<uint8_t, 2>;
+
+constexpr uint8_t DUMP_FLAG_FILTERED = 0x01;
+
+// Stuffing state between bits: level of the last bit and how many of it in a row (1..4)
+constexpr uint8_t StuffState(uint8_t level, uint8_t run) {
+    return level * 4 + run - 1;
+}
+
+// Data bytes go through 256-entry tables instead of bit by bit: the CRC register after a byte and,
+// per stuffing state, the stuff bits the byte adds and the state it leaves behind
+struct FrameBitTables {
+    uint16_t crc[256] = {};
+    uint8_t stuff[8][256] = {}; // Next state in the low nibble, stuff bits in the high nibble
+};
+
+constexpr FrameBitTables MakeFrameBitTables() {
+    FrameBitTables tables;
+    for(uint16_t byte = 0; byte < 256; byte++) {
+        uint16_t crc = byte << 7;
+        for(uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x4000) ? ((crc << 1) ^ CAN_CRC15_POLY) & 0x7FFF : (crc << 1) & 0x7FFF;
+        }
+        tables.crc[byte] = crc;
+
+        for(uint8_t state = 0; state < 8; state++) {
+            uint8_t last = state / 4;
+            uint8_t run = state % 4 + 1;
+            uint8_t stuffed = 0;
+            for(int8_t i = 7; i >= 0; i--) {
+                const uint8_t bit = (byte >> i) & 1;
+                run = (bit == last) ? run + 1 : 1;
+                last = bit;
+                if(run == 5) {
+                    stuffed++;
+                    last = !bit;
+                    run = 1;
+                }
+            }
+            tables.stuff[state][byte] = StuffState(last, run) | (stuffed << 4);
+        }
+    }
+    return tables;
+}
+
+constexpr FrameBitTables FRAME_BIT_TABLES = MakeFrameBitTables();
+
+// Feeds a frame through the CRC (until the CRC itself) and the stuffing rule, MSB first
+struct StuffCounter {
+    uint16_t crc = 0;
+    uint8_t last = 2; // Neither level: the first bit starts a run
+    uint8_t run = 0;
+    uint32_t bits = 0;
+    uint32_t stuffed = 0;
+
+    void push(uint32_t value, uint8_t count, bool updateCrc) {
+        for(int8_t i = count - 1; i >= 0; i--) {
+            const uint8_t bit = (value >> i) & 1;
+            if(updateCrc) {
+                const bool feedback = bit ^ ((crc >> 14) & 1);
+                crc = (crc << 1) & 0x7FFF;
+                if(feedback) {
+                    crc ^= CAN_CRC15_POLY;
+                }
+            }
+            bits++;
+            if(bit == last) {
+                run++;
+            } else {
+                last = bit;
+                run = 1;
+            }
+            if(run == 5) { // Stuff bit of the opposite level starts the next run
+                stuffed++;
+                last = !bit;
+                run = 1;
+            }
+        }
+    }
+
+    void pushByte(uint8_t byte) { // -> Only after SOF (the run state is always valid by then)
+        crc = ((crc << 8) ^ FRAME_BIT_TABLES.crc[((crc >> 7) ^ byte) & 0xFF]) & 0x7FFF;
+        const uint8_t entry = FRAME_BIT_TABLES.stuff[StuffState(last, run)][byte];
+        last = (entry & 0x0F) / 4;
+        run = (entry & 0x0F) % 4 + 1;
+        stuffed += entry >> 4;
+        bits += 8;
+    }
+};
+
+uint32_t StuffedFrameBits(const CAN_message_t& msg) {
+    const uint8_t len = (msg.len > CAN_FRAME_LEN) ? CAN_FRAME_LEN : msg.len;
+    StuffCounter frame;
+    frame.push(0, 1, true); // SOF
+    if(msg.flags.extended) {
+        frame.push(msg.id >> 18, 11, true);
+        frame.push(0b11, 2, true); // SRR, IDE
+        frame.push(msg.id & 0x3FFFF, 18, true);
+        frame.push(msg.flags.remote ? 0b100 : 0b000, 3, true); // RTR, r1, r0
+    } else {
+        frame.push(msg.id & 0x7FF, 11, true);
+        frame.push(msg.flags.remote ? 0b100 : 0b000, 3, true); // RTR, IDE, r0
+    }
+    frame.push(len, 4, true);
+    if(!msg.flags.remote) {
+        for(uint8_t i = 0; i < len; i++) {
+            frame.pushByte(msg.buf[i]);
+        }
+    }
+    frame.push(frame.crc, 15, false);
+    return frame.bits + frame.stuffed + CAN_FIXED_TAIL_BITS;
+}
+
+BusAnalyzer::BusAnalyzer() {
+    reset(0);
+}
+
+uint16_t BusAnalyzer::home(uint32_t key) {
+    return (key * 2654435761u) >> 25; // Top 7 bits (Knuth multiplicative hash) for 128 slots
+}
+
+static_assert(BUS_ANALYZER_SLOTS == 128, "home() takes the top log2(BUS_ANALYZER_SLOTS) bits");
+
+void BusAnalyzer::rollWindow(BusLoadStats& load, uint32_t nowUs) {
+    const uint32_t elapsed = nowUs - load.windowStartUs;
+    if(elapsed < BUS_LOAD_WINDOW_US) {
+        return;
+    }
+    const uint64_t bp = static_cast<uint64_t>(load.windowBits) * 10000 * 1000000 / (static_cast<uint64_t>(load.bitrate) * elapsed);
+    load.loadBp = (bp > 10000) ? 10000 : static_cast<uint16_t>(bp);
+    if(load.loadBp > load.peakLoadBp) {
+        load.peakLoadBp = load.loadBp;
+    }
+    load.windowStartUs = nowUs;
+    load.windowBits = 0;
+}
+
+void BusAnalyzer::record(uint8_t bus, const CAN_message_t& msg, uint32_t nowUs) {
+    if(bus >= BUS_ANALYZER_BUSES) {
+        return;
+    }
+    const uint32_t bits = StuffedFrameBits(msg);
+    BusLoadStats& load = buses[bus];
+    rollWindow(load, nowUs);
+    load.frames++;
+    load.bits += bits;
+    load.windowBits += bits;
+
+    const uint32_t key = (msg.id & 0x1FFFFFFF) | (static_cast<uint32_t>(msg.flags.extended) << 29)
+        | (static_cast<uint32_t>(bus) << 30);
+    uint16_t slot = home(key);
+    while(slots[slot].key != key) {
+        if(slots[slot].key == BUS_ANALYZER_EMPTY) {
+            if(entries >= BUS_ANALYZER_MAX_ENTRIES) {
+                load.untracked++;
+                return;
+            }
+            entries++;
+            slots[slot].key = key;
+            break;
+        }
+        slot = (slot + 1) & (BUS_ANALYZER_SLOTS - 1);
+    }
+
+    BusIdStats& entry = slots[slot];
+    if(entry.count > 0) {
+        const uint32_t gap = nowUs - entry.lastUs;
+        const uint64_t clipped = (gap < GAP_SQUARE_LIMIT_US) ? gap : GAP_SQUARE_LIMIT_US;
+        entry.gapSumUs += gap;
+        entry.gapSquareSum += clipped * clipped;
+        if(gap < entry.minGapUs) {
+            entry.minGapUs = gap;
+        }
+        if(gap > entry.maxGapUs) {
+            entry.maxGapUs = gap;
+        }
+    }
+    entry.count++;
+    entry.lastUs = nowUs;
+    entry.len = msg.len;
+    entry.bits += bits;
+}
+
+void BusAnalyzer::roll(uint32_t nowUs) {
+    for(uint8_t bus = 0; bus < BUS_ANALYZER_BUSES; bus++) {
+        rollWindow(buses[bus], nowUs);
+    }
+}
+
+void BusAnalyzer::reset(uint32_t nowUs) {
+    for(BusIdStats& entry : slots) {
+        entry = BusIdStats();
+        entry.key = BUS_ANALYZER_EMPTY;
+    }
+    for(BusLoadStats& load : buses) {
+        const uint32_t bitrate = load.bitrate;
+        const bool filtered = load.filtered;
+        load = BusLoadStats();
+        load.bitrate = bitrate;
+        load.filtered = filtered;
+        load.windowStartUs = nowUs;
+    }
+    entries = 0;
+    resetUs = nowUs;
+}
+
+void BusAnalyzer::setBitrate(uint8_t bus, uint32_t bitrate) {
+    if(bus < BUS_ANALYZER_BUSES && bitrate > 0) {
+        buses[bus].bitrate = bitrate;
+    }
+}
+
+void BusAnalyzer::setFiltered(uint8_t bus, bool filtered) {
+    if(bus < BUS_ANALYZER_BUSES) {
+        buses[bus].filtered = filtered;
+    }
+}
+
+const BusIdStats* BusAnalyzer::find(uint8_t bus, uint32_t id, bool extended) const {
+    const uint32_t key = (id & 0x1FFFFFFF) | (static_cast<uint32_t>(extended) << 29) | (static_cast<uint32_t>(bus) << 30);
+    for(uint16_t slot = home(key), probes = 0; probes < BUS_ANALYZER_SLOTS; probes++) {
+        if(slots[slot].key == key) {
+            return &slots[slot];
+        }
+        if(slots[slot].key == BUS_ANALYZER_EMPTY) {
+            return nullptr;
+        }
+        slot = (slot + 1) & (BUS_ANALYZER_SLOTS - 1);
+    }
+    return nullptr;
+}
+
+const BusLoadStats& BusAnalyzer::getLoad(uint8_t bus) const {
+    return buses[bus];
+}
+
+uint16_t BusAnalyzer::averageLoadBp(uint8_t bus, uint32_t nowUs) const {
+    const uint32_t elapsed = nowUs - resetUs;
+    if(elapsed == 0) {
+        return 0;
+    }
+    const uint64_t bp = buses[bus].bits * 10000 * 1000000 / (static_cast<uint64_t>(buses[bus].bitrate) * elapsed);
+    return (bp > 10000) ? 10000 : static_cast<uint16_t>(bp);
+}
+
+uint16_t BusAnalyzer::size() const {
+    return entries;
+}
+
+bool BusAnalyzer::encodeDumpFrame(uint16_t index, uint8_t* buf, uint32_t nowUs) const {
+    if(index >= BUS_ANALYZER_DUMP_FRAMES) {
+        return false;
+    }
+    memset(buf, 0, 8);
+
+    constexpr uint16_t SUMMARY_FRAMES = BUS_ANALYZER_BUSES * BUS_ANALYZER_BUS_PARTS;
+    if(index < SUMMARY_FRAMES) {
+        const uint8_t bus = index / BUS_ANALYZER_BUS_PARTS;
+        const BusLoadStats& load = buses[bus];
+        DumpSlot::put(buf, BUS_ANALYZER_SUMMARY_SLOT);
+        DumpPart::put(buf, index);
+        const uint8_t part = index % BUS_ANALYZER_BUS_PARTS;
+        if(part == 0) {
+            DumpWord::put(buf, load.frames);
+            DumpHalf::put(buf, load.loadBp);
+        } else if(part == 1) {
+            DumpHalfA::put(buf, load.peakLoadBp);
+            DumpHalfB::put(buf, averageLoadBp(bus, nowUs));
+            DumpHalf::put(buf, (load.untracked > UINT16_MAX) ? UINT16_MAX : load.untracked);
+        } else {
+            DumpFlags::put(buf, load.filtered ? DUMP_FLAG_FILTERED : 0);
+        }
+        return true;
+    }
+
+    const uint16_t slot = (index - SUMMARY_FRAMES) / BUS_ANALYZER_ID_PARTS;
+    const uint8_t part = (index - SUMMARY_FRAMES) % BUS_ANALYZER_ID_PARTS;
+    const BusIdStats& entry = slots[slot];
+    if(entry.key == BUS_ANALYZER_EMPTY) {
+        return false;
+    }
+    DumpSlot::put(buf, slot);
+    DumpPart::put(buf, part);
+    const uint32_t gaps = (entry.count > 1) ? entry.count - 1 : 0;
+    const uint32_t meanGap = (gaps > 0) ? static_cast<uint32_t>(entry.gapSumUs / gaps) : 0;
+    switch(part) {
+        case 0: {
+            const uint8_t bus = entry.key >> 30;
+            const uint32_t elapsed = nowUs - resetUs;
+            const uint64_t bp = (elapsed > 0)
+                ? entry.bits * 10000 * 1000000 / (static_cast<uint64_t>(buses[bus].bitrate) * elapsed) : 0;
+            DumpWord::put(buf, entry.key);
+            DumpHalf::put(buf, (bp > 10000) ? 10000 : static_cast<uint16_t>(bp));
+            break;
+        }
+        case 1:
+            DumpWord::put(buf, entry.count);
+            DumpByte::put(buf, entry.len);
+            break;
+        case 2: {
+            double jitter = 0.0;
+            if(gaps > 0) {
+                const double mean = static_cast<double>(entry.gapSumUs) / gaps;
+                const double variance = static_cast<double>(entry.gapSquareSum) / gaps - mean * mean;
+                jitter = (variance > 0.0) ? sqrt(variance) : 0.0;
+            }
+            DumpWord::put(buf, meanGap);
+            DumpHalf::put(buf, (jitter > UINT16_MAX) ? UINT16_MAX : static_cast<uint16_t>(jitter + 0.5));
+            break;
+        }
+        case 3:
+            DumpWord::put(buf, (gaps > 0) ? entry.minGapUs : 0);
+            break;
+        default:
+            DumpWord::put(buf, entry.maxGapUs);
+            break;
+    }
+    return true;
+}
+
+MeteredCanBus::MeteredCanBus(BusAnalyzer& analyzerIn, uint8_t bus, Clock& clockIn)
+    : analyzer(analyzerIn), clock(clockIn), busId(bus) {}
+
+void MeteredCanBus::attach(CanBus& innerBus) {
+    inner = &innerBus;
+}
+
+bool MeteredCanBus::read(CAN_message_t& msg) {
+    return inner->read(msg);
+}
+
+bool MeteredCanBus::write(const CAN_message_t& msg) {
+    if(!inner->write(msg)) {
+        return false;
+    }
+    analyzer.record(busId, msg, clock.micros());
+    return true;
+}
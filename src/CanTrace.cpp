@@ -0,0 +1,70 @@
+#include <string.h>
+#include "CanTrace.h"
+
+static const char TRACE_MAGIC[8] = {'E', 'C', 'U', 'T', 'R', 'A', 'C', 'E'};
+
+TraceHeader MakeTraceHeader() {
+    TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.reserved = 0;
+    return header;
+}
+
+bool IsTraceHeader(const TraceHeader& header) {
+    return memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0
+        && header.version == TRACE_VERSION && header.recordSize == sizeof(TraceRecord);
+}
+
+TraceRecord MakeTraceRecord(uint8_t bus, bool transmitted, uint32_t timestampUs, const CAN_message_t& msg) {
+    TraceRecord record;
+    record.timestampUs = timestampUs;
+    record.id = msg.id;
+    record.bus = bus;
+    record.flags = (msg.flags.extended ? TRACE_FLAG_EXTENDED : 0) | (transmitted ? TRACE_FLAG_TX : 0);
+    record.len = (msg.len > 8) ? 8 : msg.len;
+    record.reserved = 0;
+    memcpy(record.data, msg.buf, sizeof(record.data));
+    return record;
+}
+
+CAN_message_t TraceRecordToMessage(const TraceRecord& record) {
+    CAN_message_t msg;
+    msg.id = record.id;
+    msg.flags.extended = (record.flags & TRACE_FLAG_EXTENDED) != 0;
+    msg.len = record.len;
+    memcpy(msg.buf, record.data, sizeof(msg.buf));
+    return msg;
+}
+
+FrameTapPair::FrameTapPair(FrameTap* firstTap, FrameTap* secondTap) : first(firstTap), second(secondTap) {}
+
+void FrameTapPair::onFrame(const TraceRecord& record) {
+    if(first != nullptr) {
+        first->onFrame(record);
+    }
+    if(second != nullptr) {
+        second->onFrame(record);
+    }
+}
+
+TappedCanBus::TappedCanBus(CanBus& innerBus, uint8_t bus, Clock& clockIn, FrameTap& frameTap)
+    : inner(innerBus), clock(clockIn), tap(frameTap), busId(bus) {}
+
+bool TappedCanBus::read(CAN_message_t& msg) {
+    if(!inner.read(msg)) {
+        return false;
+    }
+    tap.onFrame(MakeTraceRecord(busId, false, clock.micros(), msg));
+    return true;
+}
+
+bool TappedCanBus::write(const CAN_message_t& msg) {
+    // Only frames the controller accepted are part of the trace
+    if(!inner.write(msg)) {
+        return false;
+    }
+    tap.onFrame(MakeTraceRecord(busId, true, clock.micros(), msg));
+    return true;
+}
@@ -1,174 +1,914 @@
+#include "BinaryLog.h"
 #include "ECU.h"
 
+// CODE PLACEMENT (Teensy 4.1)
+// Nothing here is marked FASTRUN or FLASHMEM: all code takes the Teensy default (ITCM). No car
+// measurement shows a split helps; mark functions only with profile dumps from the car
+// (tools/profile_dump.py --compare) that show it, and check ITCM use with tools/section_sizes.py.
+
 constexpr int HORN_PIN = 19; 
+constexpr uint32_t HORN_DURATION_MS = 2000; // Ready-to-drive sound length per rules
+constexpr uint32_t BOOT_SETTLE_MS = 150; // Makes sure ECU is last to be online so others can respond
+constexpr uint32_t DIAGNOSTIC_WINDOW_MS = 150; // How long DCs get to answer the health check
 constexpr int BL_PIN = 13; //PLACEHOLDER
 //
 constexpr int BTO_OFF_THRESHOLD = 120;
 constexpr int BTO_ON_THRESHOLD = 300;
 
-constexpr int INVERTER_PING_FREQUENCY = 100;
-
-// Brake override patch
-bool BTOveride = true;
-
-ECU::ECU() {
+constexpr uint32_t INVERTER_PING_PERIOD_US = 100000;
+constexpr uint32_t TORQUE_REFRESH_PERIOD_US = 10000;
+constexpr uint32_t DASH_STATUS_PERIOD_US = 100000;
+constexpr uint32_t SCHEDULER_STATS_PERIOD_US = 250000;
+constexpr uint32_t FAULT_SUMMARY_PERIOD_US = 500000;
+constexpr uint32_t HEARTBEAT_CHECK_PERIOD_US = 50000;
+constexpr uint8_t LIVENESS_REPORT_EVERY = 10; // Checks between unchanged liveness frames (500 ms)
+constexpr uint8_t HEALTH_POLL_EVERY = 20; // Checks between DC health requests (1 s)
+constexpr int LIMP_TORQUE_PERCENT = 50;
+constexpr uint32_t BLACK_BOX_DUMP_PERIOD_US = 2000;
+constexpr uint8_t BLACK_BOX_DUMP_FRAMES_PER_RUN = 4;
+constexpr uint32_t BUS_STATS_DUMP_PERIOD_US = 2000;
+constexpr uint8_t BUS_STATS_DUMP_FRAMES_PER_RUN = 4;
+constexpr uint16_t BUS_STATS_DUMP_SCAN_PER_RUN = 40; // Free slots skipped per run (bounds the task's WCET)
+// Every fault but a refused start (driver error, nothing to investigate); a key-off shutdown is routine
+constexpr uint16_t DEFAULT_BLACK_BOX_FAULTS = ((1u << FAULT_COUNT) - 1) & ~(1u << FaultStartRefused);
+constexpr uint32_t LOG_FLUSH_PERIOD_US = 5000;
+constexpr uint16_t LOG_FLUSH_MAX_RECORDS = 8; // Bounds the time one flush can take
+constexpr uint32_t PROFILE_DUMP_PERIOD_US = 2000;
+constexpr uint8_t PROFILE_DUMP_FRAMES_PER_RUN = 4; // Leaves room in the 16-deep TX queue
+constexpr uint32_t TORQUE_HOLD_MS = 50; // Refresh sends 0 once the pedal data is older than this
+constexpr uint32_t DEFAULT_THROTTLE_PAIR_WINDOW_US = 15000; // One 100 Hz sensor period + jitter
+constexpr uint32_t THROTTLE_STALE_FAULT_US = 50000; // A channel this old raises a fault
+
+constexpr uint16_t DEFAULT_DRAIN_FRAME_BUDGET = 64;
+constexpr uint32_t DEFAULT_DRAIN_TIME_BUDGET_US = 500;
+
+//DRIVE MODE PROFILES: TORQUE MAP {max torque (Nm * 10), power cap (W), pedal progression (%)},
+//THE THROTTLE / BRAKE FILTERS AND THE TRACTION CONTROL TARGET SLIP
+struct DriveModeProfile {
+    TorqueMap torqueMap;
+    FilterConfig throttleFilter;
+    FilterConfig brakeFilter;
+    int32_t targetSlip; // Q12 (410 = 10%), 0 = traction control off
+};
+
+// Until the dash picks a mode
+constexpr DriveModeProfile DEFAULT_DRIVE_MODE = {
+    MakeTorqueMap({2200, 80000, 0}), {FilterMode::MovingAverage, 4}, {FilterMode::Median, 3}, 614};
+
+constexpr DriveModeProfile DRIVE_MODES[] = {
+    {MakeTorqueMap({3100, 80000, 0}), {FilterMode::MovingAverage, 2}, {FilterMode::Median, 3}, 614}, // 0 = Full beans
+    {MakeTorqueMap({1550, 40000, 25}), {FilterMode::MovingAverage, 4}, {FilterMode::Median, 3}, 410}, // 1 = Endurance
+    {MakeTorqueMap({620, 20000, 50}), {FilterMode::Ema, 4}, {FilterMode::Median, 5}, 328}, // 2 = SkidPad
+};
+
+constexpr uint8_t DRIVE_MODE_COUNT = sizeof(DRIVE_MODES) / sizeof(DRIVE_MODES[0]);
+
+static_assert(TORQUE_MAP_PEDAL_FULL_SCALE == PEDAL_FULL_SCALE, "Torque map pedal axis must match Throttle output");
+
+ECU* ECU::rxOwner = nullptr;
+
+// Diagnostic IDs sit at the bottom of the arbitration order, far from the control IDs
+constexpr uint32_t DIAGNOSTIC_ID_BASE = EcuIDs::SchedulerStatsId;
+
+//STATIC TASK TABLE (MOST IMPORTANT FIRST, OFFSETS SPREAD THE RELEASES)
+struct EcuTasks {
+    static constexpr TaskSpec<ECU> TASKS[] = {
+        {&ECU::sendPeriodicTorque, TORQUE_REFRESH_PERIOD_US, 0, 0},
+        {&ECU::updateTractionControl, TRACTION_UPDATE_PERIOD_US, 2500, 1},
+        {&ECU::checkHeartbeats, HEARTBEAT_CHECK_PERIOD_US, 3000, 2},
+        {&ECU::pingInverter, INVERTER_PING_PERIOD_US, 2000, 3},
+        {&ECU::sendDashStatus, DASH_STATUS_PERIOD_US, 5000, 4},
+        {&ECU::sendFaultSummary, FAULT_SUMMARY_PERIOD_US, 9000, 5},
+        {&ECU::sendSchedulerStats, SCHEDULER_STATS_PERIOD_US, 7000, 6},
+        {&ECU::sendBlackBoxDump, BLACK_BOX_DUMP_PERIOD_US, 1700, 7},
+        {&ECU::sendBusStatsDump, BUS_STATS_DUMP_PERIOD_US, 1300, 8},
+#ifdef ECU_PROFILING
+        {&ECU::sendProfileDump, PROFILE_DUMP_PERIOD_US, 1500, 9},
+#endif
+        {&ECU::flushLog, LOG_FLUSH_PERIOD_US, 1000, 10},
+    };
+
+    static_assert(sizeof(TASKS) / sizeof(TASKS[0]) == ECU_TASK_COUNT, "ECU_TASK_COUNT out of date");
+    static_assert(TasksArePrioritySorted(TASKS), "Task table must be in priority order");
+    static_assert(TasksAreValid(TASKS), "Task without a handler or period");
+};
+
+//HEARTBEAT POLICIES {id, timeout, action} (bit order of the liveness bitmap)
+struct EcuHeartbeats {
+    static constexpr HeartbeatPolicy POLICIES[] = {
+        {ReservedIDs::Throttle1PositionId, 200000, StaleAction::Shutdown},
+        {ReservedIDs::Throttle2PositionId, 200000, StaleAction::Shutdown},
+        {ReservedIDs::BrakePressureId, 200000, StaleAction::Shutdown},
+        {EcuIDs::InverterMotorPositionId, 200000, StaleAction::Degrade}, // Speed for the power cap
+        {EcuIDs::FrontWheelSpeedId, 200000, StaleAction::Degrade}, // Traction control reference
+        {EcuIDs::RearWheelSpeedId, 200000, StaleAction::Degrade},
+        {EcuIDs::ImuAccelId, 200000, StaleAction::Report},
+        {EcuIDs::ImuGyroId, 200000, StaleAction::Report},
+        {ReservedIDs::DCFId, 2500000, StaleAction::Report}, // Health replies to the 1 s poll
+        {ReservedIDs::DCRId, 2500000, StaleAction::Report},
+        {ReservedIDs::DCTId, 2500000, StaleAction::Report},
+    };
+
+    static_assert(sizeof(POLICIES) / sizeof(POLICIES[0]) == ECU_HEARTBEAT_COUNT, "ECU_HEARTBEAT_COUNT out of date");
+    static_assert(PoliciesAreValid(POLICIES), "Heartbeat ID watched twice or without a timeout");
+
+    static constexpr uint32_t BASE = MinPolicyId(POLICIES);
+    static constexpr uint32_t SPAN = MaxPolicyId(POLICIES) - BASE + 1;
+    static constexpr HeartbeatSlotTable<SPAN> SLOTS{POLICIES, BASE};
+};
+
+ECU::ECU(Clock& clockIn, Gpio& gpioIn)
+    : clock(clockIn), gpio(gpioIn), comsTx(clockIn), motorTx(clockIn),
+      comsMeter(busAnalyzer, TRACE_BUS_COMS, clockIn), motorMeter(busAnalyzer, TRACE_BUS_MOTOR, clockIn),
+      heartbeat(EcuHeartbeats::POLICIES),
+      scheduler(EcuTasks::TASKS, clockIn),
+      brake(clockIn, gpioIn),
+      traction(clockIn) {
     throttle = Throttle();
-    brake = Brake();
+    control.torqueMap = &DEFAULT_DRIVE_MODE.torqueMap;
+    torqueCurve.build(*control.torqueMap, control.motorSpeed);
+    traction.setTargetSlip(DEFAULT_DRIVE_MODE.targetSlip);
 
     tractiveActive = true; //For testing until we come up with a good way to read tractive
+
+    drainFrameBudget = DEFAULT_DRAIN_FRAME_BUDGET;
+    drainTimeBudgetUs = DEFAULT_DRAIN_TIME_BUDGET_US;
+    control.throttlePairWindowUs = DEFAULT_THROTTLE_PAIR_WINDOW_US;
+    blackBoxFaults = DEFAULT_BLACK_BOX_FAULTS;
 }
 
-void ECU::setCAN(FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> comsCANin, FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> motorCANin) {
-    comsCAN = comsCANin;
-    motorCAN = motorCANin;
-    
+void ECU::setCAN(CanBus& comsCANin, CanBus& motorCANin) {
+    comsCAN = &comsCANin;
+    motorCAN = &motorCANin;
+    comsMeter.attach(comsCANin);
+    motorMeter.attach(motorCANin);
+    comsTx.attach(comsMeter); // TX goes through the meters, RX is counted where it is read
+    motorTx.attach(motorMeter);
 }
 
-//Initial Diagnostics
+//Initial Diagnostics (collected in the background by serviceBoot())
 void ECU::boot() {
-    delay(150); //Makes sure ECU is last to be online so others can respond
-    carIsGood = runDiagnostics();
-    pinMode(BL_PIN, OUTPUT);
+    gpio.pinMode(BL_PIN, GPIO_OUTPUT);
+    gpio.pinMode(HORN_PIN, GPIO_OUTPUT);
+    timer = clock.millis();
+    control.bootState = BootState::Settling;
+    scheduler.start();
+    heartbeat.start(clock.micros());
+#ifdef ECU_PROFILING
+    Profiler::begin();
+#endif
 }
 
-bool ECU::runDiagnostics() {
-    askForDiagnostics(); //Starts Diagnostic Process
-
-    return (reportDiagnostics()); // Reads Diagnostics
+void ECU::serviceBoot() {
+    if(control.bootState == BootState::Settling && (clock.millis() - timer) >= BOOT_SETTLE_MS) {
+        askForDiagnostics(); //Starts Diagnostic Process
+        timer = clock.millis();
+        control.bootState = BootState::Collecting;
+    } else if(control.bootState == BootState::Collecting && (clock.millis() - timer) >= DIAGNOSTIC_WINDOW_MS) {
+        control.carIsGood = reportDiagnostics(); // Replies were stored by route() while we waited
+        control.bootState = BootState::Done;
+    }
 }
 
 void ECU::askForDiagnostics() {
     //Just send the CAN message out for diagnositcs
-    rmsg.id = ReservedIDs::HealthCheckId; // DIAGNOSTIC ID
-
-    rmsg.len = 8;
-
-    rmsg.buf[0] = 0;
-    rmsg.buf[1] = 0;
-    rmsg.buf[2] = 0;
-    rmsg.buf[3] = 0;
-    rmsg.buf[4] = 0;
-    rmsg.buf[5] = 0;
-    rmsg.buf[6] = 0;
-    rmsg.buf[7] = 0;
-
-    // Write on the comsCAN
-    comsCAN.write(rmsg);
+    comsTx.send(healthCheckFrame.pack(EmptyMsg{}), TxStatus);
 }
 
 bool ECU::reportDiagnostics() {
     //TODO: This should get tweaked once DCs are solidified
-    timer = millis();
-    while(millis() - timer <= 150) {
-        if(comsCAN.read(rmsg)) {
-            if(rmsg.id == ReservedIDs::DCFId) {
-                data1Health = rmsg.buf[0];
-            }
-            if(rmsg.id == ReservedIDs::DCRId) {
-                data2Health = rmsg.buf[0];
-            }
-            if(rmsg.id == ReservedIDs::DCTId) {
-                data3Health = rmsg.buf[0];
-            }
-        }
-    }
-
     return (data1Health >= 2 && data2Health >= 2 && data3Health >= 2);
 }
 
-//START + HORN
+//START + HORN (the horn is switched off by serviceHorn() once the deadline passes)
 void ECU::InitialStart() {
-    Serial.println("INITIAL START ACHIEVED");
-    digitalWrite(HORN_PIN, HIGH);
-    delay(2000); // Delay for 2 seconds per rules
-    digitalWrite(HORN_PIN,LOW);
+    LOG_INFO(LogInitialStart, 0, 0);
+    gpio.digitalWrite(HORN_PIN, GPIO_HIGH);
+    hornStart = clock.millis();
+    control.hornActive = true;
+}
+
+void ECU::serviceHorn() {
+    if(!control.hornActive || (clock.millis() - hornStart) < HORN_DURATION_MS) {
+        return;
+    }
+    gpio.digitalWrite(HORN_PIN, GPIO_LOW);
+    control.hornActive = false;
 
     //Send the driveState command for the dash
-    rmsg.id=ReservedIDs::DriveStateId;
-    rmsg.buf[0]=1;
-    rmsg.buf[1]=0;
-    rmsg.buf[2]=0;
-    rmsg.buf[3]=0;
-    rmsg.buf[4]=0;
-    rmsg.buf[5]=0;
-    rmsg.buf[6]=0;
-    rmsg.buf[7]=0;
-
-    comsCAN.write(rmsg);
+    comsTx.send(driveStateFrame.pack(DriveStateMsg{1, 0, 0, 0, 0}), TxSafety);
     //Start the motor
-    driveState = true;
+    control.driveState = true;
 
     sendMotorStartCommand();
 }
 
+void ECU::abortStart() {
+    gpio.digitalWrite(HORN_PIN, GPIO_LOW);
+    control.hornActive = false;
+    LOG_INFO(LogStartAborted, 0, 0);
+}
+
 
 //INGESTS MESSAGES AND ROUTES THEM (LOOP FUNCTION)
 void ECU::run() {
-    if(!driveState) {
+    PROFILE_SCOPE(ProbeRun);
+    if(control.bootState != BootState::Done) {
+        serviceBoot();
+    }
+    if(control.hornActive) {
+        serviceHorn();
+    } else if(!control.driveState) {
         //TODO: SHOULD THIS SEND A START FAULT NOTICE TO THE DRIVER???
         attemptStart();
 
     }
-    // read coms CAN line 
-    if(comsCAN.read(rmsg)) {
-        route();
-    }
-    // read motor CAN line 
-    if(motorCAN.read(rmsg)) {
-        route();
+    if(control.rxMode == RxMode::Interrupt) {
+        drainRings();
+    } else if(control.rxMode == RxMode::Drain) {
+        drainBuses();
+    } else {
+        // read coms CAN line 
+        if(comsCAN->read(rmsg)) {
+            const uint32_t now = clock.micros();
+            busAnalyzer.record(TRACE_BUS_COMS, rmsg, now);
+            route(rmsg, now);
+        }
+        // read motor CAN line 
+        if(motorCAN->read(rmsg)) {
+            const uint32_t now = clock.micros();
+            busAnalyzer.record(TRACE_BUS_MOTOR, rmsg, now);
+            route(rmsg, now);
+        }
     }
 
-    if (millis() - INVERTER_PING_FREQUENCY >= lastInverterPing || lastInverterPing == 0) {
-        pingInverter();
+    if(sensorCAN != nullptr) {
+        drainSensorBatches();
     }
 
-    if(!carIsGood) { // If something bad happened when running healthChecks
+    scheduler.poll(*this);
+
+    // Frames held back while the controllers were busy
+    comsTx.service();
+    motorTx.service();
+
+    if(!control.carIsGood) { // If something bad happened when running healthChecks
         shutdown();
     }
 }
 
-void ECU::pingInverter() {
-    rmsg.len=8;
-    rmsg.buf[0]=0;
-    rmsg.buf[1]=0;
-    rmsg.buf[2]=0;
-    rmsg.buf[3]=0;
-    rmsg.buf[4]=0;
-    rmsg.buf[5]=0;
-    rmsg.buf[6]=0;
-    rmsg.buf[7]=0;
-    rmsg.id=192;
-    motorCAN.write(rmsg);
-}
-
-//ROUTES DATA (READS ID AND SENDS IT TO THE RIGHT FUNCTION)
-void ECU::route() {
-
-    switch (rmsg.id) {
-        case ReservedIDs::Throttle1PositionId:
-            updateThrottle();
-            break;
-        case ReservedIDs::Throttle2PositionId:
-            updateThrottle();
-            break;
-        case ReservedIDs::BrakePressureId:
-            updateBrake();
-            break;
-        case ReservedIDs::StartSwitchId:
-            updateSwitch();
-            break;
-        case ReservedIDs::ThrottleMinId:
-            calibrateThrottleMin();
-            break;
-        case ReservedIDs::ThrottleMaxId:
-            calibrateThrottleMax();
-            break;
-        case ReservedIDs::DriveModeId:
-            updateDriveMode();
+//EMPTIES BOTH RX QUEUES ONE FRAME AT A TIME PER BUS SO NEITHER BUS CAN STARVE THE OTHER
+void ECU::drainBuses() {
+    const uint32_t start = clock.micros();
+    uint16_t comsCount = 0;
+    uint16_t motorCount = 0;
+    bool comsPending = true; // A bus stays pending until a read comes back empty
+    bool motorPending = true;
+
+    while(comsPending || motorPending) {
+        if((comsCount + motorCount) >= drainFrameBudget || (clock.micros() - start) >= drainTimeBudgetUs) {
             break;
-        default:
+        }
+        if(comsPending) {
+            comsPending = readBus(*comsCAN, comsHeld, comsHolding);
+            if(comsPending) {
+                comsCount++;
+                const uint32_t now = clock.micros();
+                busAnalyzer.record(TRACE_BUS_COMS, rmsg, now);
+                route(rmsg, now);
+            }
+        }
+        if(motorPending && (comsCount + motorCount) < drainFrameBudget) {
+            motorPending = readBus(*motorCAN, motorHeld, motorHolding);
+            if(motorPending) {
+                motorCount++;
+                const uint32_t now = clock.micros();
+                busAnalyzer.record(TRACE_BUS_MOTOR, rmsg, now);
+                route(rmsg, now);
+            }
+        }
+    }
+
+    comsRxStats.framesRead += comsCount;
+    motorRxStats.framesRead += motorCount;
+    if(comsCount > comsRxStats.highWater) {
+        comsRxStats.highWater = comsCount;
+    }
+    if(motorCount > motorRxStats.highWater) {
+        motorRxStats.highWater = motorCount;
+    }
+    // Still pending only means the last read found a frame. The queue can't be peeked, so one more
+    // read tells whether the budget really left one behind; it is held and routed first next pass.
+    if(comsPending && !comsHolding) {
+        comsHolding = comsCAN->read(comsHeld);
+    }
+    if(motorPending && !motorHolding) {
+        motorHolding = motorCAN->read(motorHeld);
+    }
+    if(comsHolding) {
+        comsRxStats.budgetExhausted++;
+    }
+    if(motorHolding) {
+        motorRxStats.budgetExhausted++;
+    }
+}
+
+bool ECU::readBus(CanBus& bus, CAN_message_t& held, bool& holding) {
+    if(holding) {
+        rmsg = held;
+        holding = false;
+        return true;
+    }
+    return bus.read(rmsg);
+}
+
+//CONSUMES THE ISR RINGS: SAFETY-CRITICAL FRAMES FIRST, THEN COMS/MOTOR ROUND-ROBIN
+void ECU::drainRings() {
+    const uint32_t start = clock.micros();
+    RxFrame frame;
+    uint16_t criticalCount = 0;
+    uint16_t comsCount = 0;
+    uint16_t motorCount = 0;
+
+    // Occupancy seen on entry is the real backlog for each ring
+    const uint32_t criticalDepth = criticalRing.size();
+    const uint32_t comsDepth = comsRing.size();
+    const uint32_t motorDepth = motorRing.size();
+
+    // The critical ring is small and always emptied regardless of budget
+    while(criticalRing.pop(frame)) {
+        criticalCount++;
+        tapRx(TRACE_BUS_COMS, frame); // Throttle, brake and start switch are all on comsCAN
+        busAnalyzer.record(TRACE_BUS_COMS, frame.msg, frame.rxMicros);
+        route(frame.msg, frame.rxMicros);
+    }
+
+    bool comsPending = true;
+    bool motorPending = true;
+    while(comsPending || motorPending) {
+        if((comsCount + motorCount) >= drainFrameBudget || (clock.micros() - start) >= drainTimeBudgetUs) {
             break;
+        }
+        if(comsPending) {
+            comsPending = comsRing.pop(frame);
+            if(comsPending) {
+                comsCount++;
+                tapRx(TRACE_BUS_COMS, frame);
+                busAnalyzer.record(TRACE_BUS_COMS, frame.msg, frame.rxMicros);
+                route(frame.msg, frame.rxMicros);
+            }
+        }
+        if(motorPending && (comsCount + motorCount) < drainFrameBudget) {
+            motorPending = motorRing.pop(frame);
+            if(motorPending) {
+                motorCount++;
+                tapRx(TRACE_BUS_MOTOR, frame);
+                busAnalyzer.record(TRACE_BUS_MOTOR, frame.msg, frame.rxMicros);
+                route(frame.msg, frame.rxMicros);
+            }
+        }
+    }
+
+    criticalRxStats.framesRead += criticalCount;
+    comsRxStats.framesRead += comsCount;
+    motorRxStats.framesRead += motorCount;
+    if(criticalDepth > criticalRxStats.highWater) {
+        criticalRxStats.highWater = criticalDepth;
+    }
+    if(comsDepth > comsRxStats.highWater) {
+        comsRxStats.highWater = comsDepth;
+    }
+    if(motorDepth > motorRxStats.highWater) {
+        motorRxStats.highWater = motorDepth;
+    }
+    if(comsPending && comsRing.size() > 0) {
+        comsRxStats.budgetExhausted++;
+    }
+    if(motorPending && motorRing.size() > 0) {
+        motorRxStats.budgetExhausted++;
+    }
+    criticalRxStats.ringDrops = criticalRing.dropped();
+    comsRxStats.ringDrops = comsRing.dropped();
+    motorRxStats.ringDrops = motorRing.dropped();
+}
+
+void ECU::setLogTap(FrameTap* tap) {
+    logTap = tap;
+}
+
+void ECU::setBlackBox(BlackBox* box) {
+    blackBox = box;
+}
+
+void ECU::setBlackBoxTriggers(uint16_t faultMask, bool onShutdown) {
+    blackBoxFaults = faultMask;
+    blackBoxOnShutdown = onShutdown;
+}
+
+void ECU::tapRx(uint8_t bus, const RxFrame& frame) {
+    if(logTap != nullptr) {
+        logTap->onFrame(MakeTraceRecord(bus, false, frame.rxMicros, frame.msg));
+    }
+}
+
+//READS CAN FD SENSOR BATCHES (THE SAME FRAME BUDGET AS THE CLASSIC BUSES, BATCHES ARE SMALL IN NUMBER)
+void ECU::drainSensorBatches() {
+    uint16_t count = 0;
+    while(count < drainFrameBudget && (sensorHolding || sensorCAN->read(fdMsg))) {
+        sensorHolding = false;
+        count++;
+        routeSensorBatch(fdMsg, clock.micros());
+    }
+    sensorRxStats.framesRead += count;
+    if(count > sensorRxStats.highWater) {
+        sensorRxStats.highWater = count;
+    }
+    // Out of budget: a batch read now is held in fdMsg and routed first next pass
+    if(count == drainFrameBudget && !sensorHolding) {
+        sensorHolding = sensorCAN->read(fdMsg);
+    }
+    if(sensorHolding) {
+        sensorRxStats.budgetExhausted++;
+    }
+}
+
+//UNPACKS ONE BATCH: EACH SAMPLE IS ROUTED AS ITS CLASSIC FRAME, STAMPED WITH THE TIME IT WAS TAKEN
+void ECU::routeSensorBatch(const CANFD_message_t& msg, uint32_t rxMicros) {
+    if(msg.id != EcuIDs::SensorBatchId || msg.len < SensorBatchMsg::LEN) {
+        batchStats.rejected++;
+        return;
+    }
+    const SensorBatchMsg batch = SensorBatchMsg::decode(msg.buf);
+    if(batchSeen && batch.sequence != nextBatchSequence) {
+        batchStats.lost += static_cast<uint8_t>(batch.sequence - nextBatchSequence);
+    }
+    batchSeen = true;
+    nextBatchSequence = batch.sequence + 1;
+    batchStats.batches++;
+
+    // A count past the frame end only loses the samples that aren't there
+    const uint8_t fit = (msg.len - SensorBatchMsg::LEN) / SensorSampleMsg::LEN;
+    const uint8_t count = (batch.count < fit) ? batch.count : fit;
+    batchStats.rejected += batch.count - count;
+
+    batchSample.msg.len = CAN_FRAME_LEN;
+    for(uint8_t i = 0; i < count; i++) {
+        const SensorSampleMsg sample =
+            SensorSampleMsg::decode(msg.buf + SensorBatchMsg::LEN + i * SensorSampleMsg::LEN);
+        if(!isBatchedId(sample.id)) {
+            batchStats.rejected++;
+            continue;
+        }
+        batchSample.msg.id = sample.id;
+        SensorValueMsg{sample.value}.encode(batchSample.msg.buf);
+        batchSample.rxMicros = rxMicros - sample.ageUs;
+        tapRx(TRACE_BUS_COMS, batchSample); // Logged as the classic frame, so logs replay without CAN3
+        route(batchSample.msg, batchSample.rxMicros);
+        batchStats.samples++;
+    }
+}
+
+bool ECU::isBatchedId(uint32_t id) {
+    return id == ReservedIDs::Throttle1PositionId || id == ReservedIDs::Throttle2PositionId
+        || id == ReservedIDs::BrakePressureId;
+}
+
+void ECU::setSensorCAN(CanFdBus& sensorCANin) {
+    sensorCAN = &sensorCANin;
+}
+
+void ECU::setRxMode(RxMode mode) {
+    if(mode == RxMode::Interrupt) {
+        rxOwner = this;
+    }
+    control.rxMode = mode;
+}
+
+void ECU::setDrainBudget(uint16_t maxFrames, uint32_t maxMicros) {
+    drainFrameBudget = maxFrames;
+    drainTimeBudgetUs = maxMicros;
+}
+
+void ECU::setThrottlePairWindow(uint32_t maxMicros) {
+    control.throttlePairWindowUs = maxMicros;
+}
+
+const BusRxStats& ECU::getComsRxStats() const {
+    return comsRxStats;
+}
+
+const BusRxStats& ECU::getMotorRxStats() const {
+    return motorRxStats;
+}
+
+const BusRxStats& ECU::getCriticalRxStats() const {
+    return criticalRxStats;
+}
+
+BusAnalyzer& ECU::getBusAnalyzer() {
+    return busAnalyzer;
+}
+
+const BusRxStats& ECU::getSensorRxStats() const {
+    return sensorRxStats;
+}
+
+const SensorBatchStats& ECU::getSensorBatchStats() const {
+    return batchStats;
+}
+
+//IDS THAT SKIP THE NORMAL QUEUE IN INTERRUPT MODE
+bool ECU::isCriticalId(uint32_t id) {
+    return id == ReservedIDs::Throttle1PositionId || id == ReservedIDs::Throttle2PositionId
+        || id == ReservedIDs::BrakePressureId || id == ReservedIDs::StartSwitchId;
+}
+
+//COMSCAN RECEIVE INTERRUPT -> TIMESTAMP AND QUEUE (ONLY PRODUCER FOR criticalRing/comsRing)
+void ECU::onComsReceive(const CAN_message_t& msg) {
+    if(rxOwner == nullptr) {
+        return;
+    }
+    const RxFrame frame = {msg, rxOwner->clock.micros()};
+    if(isCriticalId(msg.id)) {
+        rxOwner->criticalRing.push(frame);
+    } else {
+        rxOwner->comsRing.push(frame);
+    }
+}
+
+//MOTORCAN RECEIVE INTERRUPT -> TIMESTAMP AND QUEUE (ONLY PRODUCER FOR motorRing)
+void ECU::onMotorReceive(const CAN_message_t& msg) {
+    if(rxOwner == nullptr) {
+        return;
+    }
+    const RxFrame frame = {msg, rxOwner->clock.micros()};
+    rxOwner->motorRing.push(frame);
+}
+
+void ECU::pingInverter() {
+    motorTx.send(inverterPingFrame.pack(InverterCommandMsg{0, 0, 0, 0, 0}), TxStatus);
+}
+
+void ECU::sendPeriodicTorque() {
+    // Event-driven commands go out from updateThrottle(); this only keeps the inverter fed
+    checkThrottleFreshness();
+    if((clock.millis() - control.lastTorqueUpdate) <= TORQUE_HOLD_MS) {
+        sendMotorCommand(control.torqueRequested);
+    } else {
+        sendMotorCommand(0);
+    }
+    logState();
+}
+
+// The cap moves at its own rate, so a held request (no new pedal frame) still follows it
+void ECU::updateTractionControl() {
+    PROFILE_SCOPE(ProbeTractionControl);
+    traction.update();
+    control.torqueRequested = traction.limit(control.torqueDemand);
+}
+
+void ECU::logState() {
+    if(logTap == nullptr) {
+        return;
+    }
+    const uint8_t flags = (control.driveState ? 1 : 0) | (control.BTOveride ? 2 : 0) | (control.limpMode ? 4 : 0) | (control.throttleOK ? 8 : 0)
+                        | (control.brakeOK ? 16 : 0);
+    const EcuStateMsg state = {static_cast<int16_t>(control.torqueRequested), static_cast<uint16_t>(control.pedalPosition),
+                               faults.getActiveMask(), flags, static_cast<uint8_t>(driveMode)};
+    logTap->onFrame(MakeTraceRecord(TRACE_BUS_ECU, false, clock.micros(), stateFrame.pack(state)));
+}
+
+void ECU::sendDashStatus() {
+    const DriveStateMsg status = {control.driveState, control.BTOveride, static_cast<uint8_t>(driveMode), control.startFault, control.carIsGood};
+    comsTx.send(driveStateFrame.pack(status), TxStatus);
+}
+
+//SCHEDULER DIAGNOSTICS: [task, overruns, maxJitterUs(2), wcetUs(2), runs(2)] (saturating)
+void ECU::sendSchedulerStats() {
+    const TaskStats& stats = scheduler.getStats(statsTaskIndex);
+    const uint32_t overruns = (stats.overruns > UINT8_MAX) ? UINT8_MAX : stats.overruns;
+    const uint32_t jitter = (stats.maxJitterUs > UINT16_MAX) ? UINT16_MAX : stats.maxJitterUs;
+    const uint32_t wcet = (stats.wcetUs > UINT16_MAX) ? UINT16_MAX : stats.wcetUs;
+
+    const SchedulerStatsMsg report = {statsTaskIndex, static_cast<uint8_t>(overruns), static_cast<uint16_t>(jitter),
+                                      static_cast<uint16_t>(wcet), static_cast<uint16_t>(stats.runs)};
+    comsTx.send(schedulerStatsFrame.pack(report), TxDiagnostic);
+
+    statsTaskIndex = (statsTaskIndex + 1) % ECU_TASK_COUNT;
+}
+
+//LIVENESS: FLAGS NODES THAT WENT SILENT, LIMPS OR SHUTS DOWN PER THE POLICY TABLE, TELLS THE DASH
+void ECU::checkHeartbeats() {
+    const uint16_t before = heartbeat.getAliveMask();
+    const uint16_t alive = heartbeat.check(clock.micros());
+    const uint16_t changed = before ^ alive;
+
+    for(uint8_t i = 0; i < ECU_HEARTBEAT_COUNT; i++) {
+        if(!(changed & (1u << i))) {
+            continue;
+        }
+        const HeartbeatPolicy& policy = heartbeat.getPolicy(i);
+        if(alive & (1u << i)) {
+            LOG_INFO(LogNodeBack, policy.id, 0);
+        } else {
+            LOG_WARN(LogNodeLost, policy.id, static_cast<int32_t>(policy.action));
+        }
+    }
+    if(before & ~alive) {
+        raiseFault(FaultNodeLost);
+    } else if(!heartbeat.anyDead(StaleAction::Report)) {
+        faults.clear(FaultNodeLost);
+    }
+
+    control.limpMode = heartbeat.anyDead(StaleAction::Degrade);
+    control.criticalNodeLost = heartbeat.anyDead(StaleAction::Shutdown);
+    if(control.criticalNodeLost && control.driveState) {
+        shutdown();
+    }
+
+    // A silent collector is as bad as one reporting no health
+    constexpr uint8_t FRONT = EcuHeartbeats::SLOTS.lookup(EcuIDs::FrontWheelSpeedId);
+    constexpr uint8_t REAR = EcuHeartbeats::SLOTS.lookup(EcuIDs::RearWheelSpeedId);
+    wheelSpeed1Health = wheelSpeed2Health = heartbeat.isAlive(FRONT) ? 2 : 0;
+    wheelSpeed3Health = wheelSpeed4Health = heartbeat.isAlive(REAR) ? 2 : 0;
+    if(!heartbeat.isAlive(EcuHeartbeats::SLOTS.lookup(ReservedIDs::DCFId))) {
+        data1Health = 0;
+    }
+    if(!heartbeat.isAlive(EcuHeartbeats::SLOTS.lookup(ReservedIDs::DCRId))) {
+        data2Health = 0;
+    }
+    if(!heartbeat.isAlive(EcuHeartbeats::SLOTS.lookup(ReservedIDs::DCTId))) {
+        data3Health = 0;
+    }
+
+    heartbeatChecks++;
+    if(changed || (heartbeatChecks % LIVENESS_REPORT_EVERY) == 0) {
+        const uint8_t flags = (control.limpMode ? 1 : 0) | (control.criticalNodeLost ? 2 : 0);
+        comsTx.send(livenessFrame.pack(LivenessMsg{alive, heartbeat.getLostMask(), flags}), TxStatus);
+    }
+    // DCs only answer when asked, so keep asking once boot diagnostics are done
+    if(control.bootState == BootState::Done && (heartbeatChecks % HEALTH_POLL_EVERY) == 0) {
+        askForDiagnostics();
+    }
+}
+
+void ECU::sendFaultSummary() {
+    const FaultSummaryMsg summary = {faults.getActiveMask(), faults.getLatchedMask(), faults.getOccurrences(),
+                                     faults.getLastCode()};
+    comsTx.send(faultSummaryFrame.pack(summary), TxStatus);
+}
+
+//LOWEST PRIORITY TASK: MOVES LOG RECORDS FROM RAM TO USB SERIAL
+void ECU::flushLog() {
+    BinaryLog::flush(LOG_FLUSH_MAX_RECORDS);
+}
+
+//BLACK BOX OVER CAN: 0 = DUMP (A STILL-RECORDING BOX IS TRIGGERED FIRST), 1 = REARM
+void ECU::handleBlackBoxRequest(uint8_t command) {
+    if(blackBox == nullptr) {
+        return;
+    }
+    if(command == 1) {
+        blackBoxDumpPending = false;
+        blackBoxDumping = false;
+        blackBox->rearm();
+        return;
+    }
+    blackBox->trigger(BLACK_BOX_REASON_MANUAL, clock.micros()); // No-op once triggered
+    blackBoxDumpPending = true;
+}
+
+void ECU::sendBlackBoxDump() {
+    if(blackBox == nullptr) {
+        return;
+    }
+    if(blackBoxDumpPending && blackBox->getState() == BlackBoxState::Frozen) {
+        blackBoxDumpPending = false;
+        blackBoxDumping = true;
+        blackBoxDumpCursor = 0;
+    }
+    if(!blackBoxDumping) {
+        return;
+    }
+    CAN_message_t dumpFrame;
+    dumpFrame.id = EcuIDs::BlackBoxDataId;
+    dumpFrame.len = 8;
+    for(uint8_t i = 0; i < BLACK_BOX_DUMP_FRAMES_PER_RUN; i++) {
+        if(!blackBox->encodeDumpFrame(blackBoxDumpCursor, dumpFrame.buf)) {
+            blackBoxDumping = false;
+            return;
+        }
+        if(!comsTx.send(dumpFrame, TxDiagnostic)) {
+            return; // Class queue full, retry this frame next run
+        }
+        blackBoxDumpCursor++;
+    }
+}
+
+//BUS STATS OVER CAN: 0 = DUMP (WINDOWS ON QUIET BUSES ARE CLOSED FIRST), 1 = RESET
+void ECU::handleBusStatsRequest(uint8_t command) {
+    if(command == 1) {
+        busAnalyzer.reset(clock.micros());
+        busStatsDumpCursor = BUS_ANALYZER_DUMP_FRAMES;
+        return;
+    }
+    busAnalyzer.roll(clock.micros());
+    busStatsDumpCursor = 0;
+}
+
+void ECU::sendBusStatsDump() {
+    CAN_message_t dumpFrame;
+    dumpFrame.id = EcuIDs::BusStatsDataId;
+    dumpFrame.len = 8;
+    uint8_t sent = 0;
+    uint16_t scanned = 0;
+    while(busStatsDumpCursor < BUS_ANALYZER_DUMP_FRAMES && sent < BUS_STATS_DUMP_FRAMES_PER_RUN
+          && scanned < BUS_STATS_DUMP_SCAN_PER_RUN) {
+        scanned++;
+        if(!busAnalyzer.encodeDumpFrame(busStatsDumpCursor, dumpFrame.buf, clock.micros())) {
+            busStatsDumpCursor++; // Free slot, nothing to send
+            continue;
+        }
+        if(!comsTx.send(dumpFrame, TxDiagnostic)) {
+            return; // Class queue full, retry this frame next run
+        }
+        busStatsDumpCursor++;
+        sent++;
+    }
+}
+
+#ifdef ECU_PROFILING
+void ECU::requestProfileDump() {
+    profileDumpCursor = 0;
+}
+
+void ECU::sendProfileDump() {
+    CAN_message_t dumpFrame;
+    dumpFrame.id = EcuIDs::ProfileDataId;
+    dumpFrame.len = 8;
+    for(uint8_t i = 0; i < PROFILE_DUMP_FRAMES_PER_RUN; i++) {
+        if(!Profiler::encodeDumpFrame(profileDumpCursor, dumpFrame.buf)) {
+            return; // Nothing pending
+        }
+        if(!comsTx.send(dumpFrame, TxDiagnostic)) {
+            return; // Class queue full, retry this frame next run
+        }
+        profileDumpCursor++;
+    }
+}
+#endif
+
+const TaskStats& ECU::getTaskStats(size_t index) const {
+    return scheduler.getStats(index);
+}
+
+const TractionControl& ECU::getTractionControl() const {
+    return traction;
+}
+
+const TxClassStats& ECU::getComsTxStats(TxClass txClass) const {
+    return comsTx.getStats(txClass);
+}
+
+const TxClassStats& ECU::getMotorTxStats(TxClass txClass) const {
+    return motorTx.getStats(txClass);
+}
+
+const ImuEstimate& ECU::getImuEstimate() const {
+    return imu.getEstimate();
+}
+
+const FaultManager& ECU::getFaultManager() const {
+    return faults;
+}
+
+const HeartbeatMonitor<ECU_HEARTBEAT_COUNT>& ECU::getHeartbeat() const {
+    return heartbeat;
+}
+
+bool ECU::isDriving() const {
+    return control.driveState;
+}
+
+bool ECU::isLimping() const {
+    return control.limpMode;
+}
 
+int ECU::getDriveMode() const {
+    return driveMode;
+}
+
+//COMPILE-TIME ROUTE TABLE (ID -> DECODER -> HANDLER)
+using RouteHandler = void (*)(ECU&, const CAN_message_t&);
+
+struct EcuRoutes {
+    // Decodes one schema field and hands it straight to the handler (short frames are dropped)
+    template<typename Field, void (ECU::*Handler)(typename Field::Type)>
+    static void Value(ECU& ecu, const CAN_message_t& msg) {
+        if(msg.len < Field::END) {
+            return;
+        }
+        (ecu.*Handler)(Field::get(msg.buf));
+    }
+
+    // Decodes a whole schema message for handlers that need several fields
+    template<typename Message, void (ECU::*Handler)(const Message&)>
+    static void Decode(ECU& ecu, const CAN_message_t& msg) {
+        if(msg.len < Message::LEN) {
+            return;
+        }
+        (ecu.*Handler)(Message::decode(msg.buf));
+    }
+
+    // Payload-less command frames
+    template<void (ECU::*Handler)()>
+    static void Event(ECU& ecu, const CAN_message_t&) {
+        (ecu.*Handler)();
+    }
+
+    static constexpr CanRoute<RouteHandler> ROUTES[] = {
+        {ReservedIDs::Throttle1PositionId, &Value<SensorValueMsg::Value, &ECU::updateThrottle1>},
+        {ReservedIDs::Throttle2PositionId, &Value<SensorValueMsg::Value, &ECU::updateThrottle2>},
+        {ReservedIDs::BrakePressureId, &Value<SensorValueMsg::Value, &ECU::updateBrake>},
+        {ReservedIDs::StartSwitchId, &Value<StateByteMsg::Value, &ECU::updateSwitch>},
+        {ReservedIDs::ThrottleMinId, &Event<&ECU::calibrateThrottleMin>},
+        {ReservedIDs::ThrottleMaxId, &Event<&ECU::calibrateThrottleMax>},
+        {ReservedIDs::DriveModeId, &Value<StateByteMsg::Value, &ECU::updateDriveMode>},
+        {ReservedIDs::DCFId, &Value<StateByteMsg::Value, &ECU::updateDCFHealth>},
+        {ReservedIDs::DCRId, &Value<StateByteMsg::Value, &ECU::updateDCRHealth>},
+        {ReservedIDs::DCTId, &Value<StateByteMsg::Value, &ECU::updateDCTHealth>},
+        {EcuIDs::InverterMotorPositionId, &Value<MotorPositionMsg::Speed, &ECU::updateMotorSpeed>},
+        {EcuIDs::FrontWheelSpeedId, &Decode<WheelSpeedMsg, &ECU::updateFrontWheelSpeeds>},
+        {EcuIDs::RearWheelSpeedId, &Decode<WheelSpeedMsg, &ECU::updateRearWheelSpeeds>},
+        {EcuIDs::ImuAccelId, &Decode<ImuAxesMsg, &ECU::updateAccelerometer>},
+        {EcuIDs::ImuGyroId, &Decode<ImuAxesMsg, &ECU::updateGyro>},
+        {EcuIDs::BlackBoxRequestId, &Value<StateByteMsg::Value, &ECU::handleBlackBoxRequest>},
+        {EcuIDs::BusStatsRequestId, &Value<StateByteMsg::Value, &ECU::handleBusStatsRequest>},
+#ifdef ECU_PROFILING
+        {EcuIDs::ProfileRequestId, &Event<&ECU::requestProfileDump>},
+#endif
+    };
+
+    static_assert(RoutesAreUnique(ROUTES), "CAN ID routed twice");
+    static_assert(RoutesAreComplete(ROUTES), "CAN route without a handler");
+    static_assert(RoutesContain(ROUTES, ReservedIDs::Throttle1PositionId)
+                  && RoutesContain(ROUTES, ReservedIDs::Throttle2PositionId)
+                  && RoutesContain(ROUTES, ReservedIDs::BrakePressureId)
+                  && RoutesContain(ROUTES, ReservedIDs::StartSwitchId),
+                  "Safety-critical CAN ID missing from route table");
+    static_assert(RoutesMatch(ROUTES, ECU_ROUTED_IDS), "Route table and ECU_ROUTED_IDS differ");
+
+    // Control IDs and the 0x7E0+ diagnostic IDs each get their own dense table (one spanning both
+    // would be ~2000 mostly empty slots)
+    static constexpr uint32_t BASE = MinRouteId(ROUTES, 0, DIAGNOSTIC_ID_BASE);
+    static constexpr uint32_t SPAN = MaxRouteId(ROUTES, 0, DIAGNOSTIC_ID_BASE) - BASE + 1;
+    static constexpr CanDispatchTable<RouteHandler, SPAN> TABLE{ROUTES, BASE};
+
+    static constexpr uint32_t DIAGNOSTIC_BASE = MinRouteId(ROUTES, DIAGNOSTIC_ID_BASE);
+    static constexpr uint32_t DIAGNOSTIC_SPAN = MaxRouteId(ROUTES, DIAGNOSTIC_ID_BASE) - DIAGNOSTIC_BASE + 1;
+    static constexpr CanDispatchTable<RouteHandler, DIAGNOSTIC_SPAN> DIAGNOSTIC_TABLE{ROUTES, DIAGNOSTIC_BASE};
+};
+
+// True if every watched heartbeat ID reaches route() (otherwise it could never be seen)
+template<size_t R, size_t N>
+constexpr bool HeartbeatsAreRouted(const CanRoute<RouteHandler> (&routes)[R], const HeartbeatPolicy (&policies)[N]) {
+    for(size_t i = 0; i < N; i++) {
+        if(!RoutesContain(routes, policies[i].id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(HeartbeatsAreRouted(EcuRoutes::ROUTES, EcuHeartbeats::POLICIES), "Heartbeat ID missing from route table");
+
+//HARDWARE ACCEPTANCE FILTERS (THE ROUTE TABLE FOLDED INTO MASKED FILTERS, PROGRAMMED BY main.cpp)
+struct EcuFilters {
+    static constexpr AcceptancePlan<CAN_ACCEPTANCE_FILTERS> PLAN
+        = MakeAcceptancePlan<CAN_ACCEPTANCE_FILTERS>(EcuRoutes::ROUTES);
+
+    static_assert(PLAN.standardOnly, "Acceptance filters only cover standard IDs");
+    static_assert(PlanAcceptsRoutes(PLAN, EcuRoutes::ROUTES), "Routed CAN ID rejected by the acceptance filters");
+};
+
+const AcceptancePlan<CAN_ACCEPTANCE_FILTERS>& ECU::getAcceptancePlan() {
+    return EcuFilters::PLAN;
+}
+
+//ROUTES DATA (LOOKS UP THE ID AND CALLS THE HANDLER WITH ITS DECODED PAYLOAD)
+void ECU::route(const CAN_message_t& msg, uint32_t rxMicros) {
+    PROFILE_SCOPE(ProbeRoute);
+    control.routeRxMicros = rxMicros;
+    const uint8_t slot = EcuHeartbeats::SLOTS.lookup(msg.id);
+    if(slot != HEARTBEAT_UNWATCHED) {
+        heartbeat.seen(slot, rxMicros);
+    }
+    RouteHandler handler = EcuRoutes::TABLE.lookup(msg.id);
+    if(handler == nullptr) {
+        handler = EcuRoutes::DIAGNOSTIC_TABLE.lookup(msg.id);
+    }
+    if(handler != nullptr) {
+        handler(*this, msg);
     }
 }
 
@@ -179,101 +919,197 @@ void ECU::route() {
 ////////////UPDATE FUNCTIONS////////////////
 ////////////////////////////////////////////
 
+void ECU::updateThrottle1(int32_t value) {
+    throttle.setThrottle1(value);
+    control.throttle1Seen = true;
+    control.throttleNew |= 1;
+    control.throttle1Micros = control.routeRxMicros;
+    updateThrottle();
+}
+
+void ECU::updateThrottle2(int32_t value) {
+    throttle.setThrottle2(value);
+    control.throttle2Seen = true;
+    control.throttleNew |= 2;
+    control.throttle2Micros = control.routeRxMicros;
+    updateThrottle();
+}
+
 void ECU::updateThrottle() {
-    unpacker.reset(rmsg.buf);
-    if(rmsg.id == ReservedIDs::Throttle1PositionId) {
-        throttle.setThrottle1(unpacker.unpack<int32_t>());
-        throttle1UPDATE = true;
-    } else {
-        throttle.setThrottle2(unpacker.unpack<int32_t>());
-        throttle2UPDATE = true;
-    }
-    if(!throttle1UPDATE || !throttle2UPDATE) { // exits if both haven't been updated
+    PROFILE_SCOPE(ProbeUpdateThrottle);
+    if(!control.throttle1Seen || !control.throttle2Seen) {
         return;
     }
+    const bool pair = control.throttleNew == 3; // Both channels since the last filter sample
+    if(control.throttlePairWindowUs == 0) {
+        if(!pair) {
+            return; // Pairing off: wait for the other channel's frame
+        }
+    } else {
+        // Signed difference so the pairing survives micros() wrapping
+        const int32_t skew = static_cast<int32_t>(control.throttle1Micros - control.throttle2Micros);
+        if(static_cast<uint32_t>((skew < 0) ? -skew : skew) > control.throttlePairWindowUs) {
+            return; // Other channel is stale: checkThrottleFreshness() faults it if it stays quiet
+        }
+    }
 
-    torqueRequested = throttle.calculateTorque();
+    // The filter takes one sample per sensor period, so the drive mode windows count periods.
+    // A single channel's frame in between only revises that sample, for the latency.
+    if(pair) {
+        control.throttleNew = 0;
+        control.pedalPosition = throttle.calculateTorque();
 
-    throttleCode = throttle.checkError();
+        control.throttleCode = static_cast<uint8_t>(throttle.checkError());
 
-    throttleOK = (throttleCode == 0);
-    
-    if(!throttleOK) {
-        throwError(throttleCode);
+        control.throttleOK = (control.throttleCode == 0);
+
+        if(control.throttleCode == 1) {
+            raiseFault(FaultThrottleMismatch);
+        } else if(control.throttleCode == 2) {
+            raiseFault(FaultThrottleZero);
+        } else {
+            faults.clear(FaultThrottleMismatch);
+            faults.clear(FaultThrottleZero);
+        }
+    } else {
+        control.pedalPosition = throttle.refreshTorque();
     }
+    updateTorqueCommand();
+}
 
-    throttle1UPDATE = false;
-    throttle2UPDATE = false;
+// Pedal position -> torque request (map, limp mode, traction control), sent to the inverter
+void ECU::updateTorqueCommand() {
+    control.torqueDemand = static_cast<int16_t>(torqueCurve.lookup(control.pedalPosition));
+    if(control.limpMode) {
+        control.torqueDemand = static_cast<int16_t>(control.torqueDemand * LIMP_TORQUE_PERCENT / 100);
+    }
+    control.torqueRequested = traction.limit(control.torqueDemand);
+    control.lastTorqueUpdate = clock.millis();
+    control.throttleStale = false;
+    faults.clear(FaultThrottleStale);
 
     //Send that command to the motor
-    sendMotorCommand(torqueRequested);
+    sendMotorCommand(control.torqueRequested);
+}
+
+//STALE CHANNEL -> ONE FAULT FRAME + NO TORQUE UNTIL BOTH CHANNELS ARE FRESH AGAIN
+void ECU::checkThrottleFreshness() {
+    if(!control.driveState || control.throttleStale) {
+        return;
+    }
+    const uint32_t now = clock.micros();
+    if(!control.throttle1Seen || !control.throttle2Seen || (now - control.throttle1Micros) > THROTTLE_STALE_FAULT_US
+       || (now - control.throttle2Micros) > THROTTLE_STALE_FAULT_US) {
+        control.throttleStale = true;
+        control.throttleOK = false;
+        raiseFault(FaultThrottleStale);
+    }
 }
 
 // brake error handling
-void ECU::updateBrake() {
-    unpacker.reset(rmsg.buf);
-    brake.updateValue(unpacker.unpack<int32_t>());
-    brakeOK = (brake.getBrakeErrorState() != 2);
+void ECU::updateBrake(int32_t value) {
+    brake.updateValue(value);
+    control.brakeOK = (brake.getBrakeErrorState() != 2);
 
     // brake override patch
-    if (!BTOveride) {
-        if (!brakeOK){
-            throwError(FaultSourcesIDs::BrakeZeroId);
+    if (!control.BTOveride) {
+        if (!control.brakeOK){
+            raiseFault(FaultBrakeZero);
         }
     }
+    if(control.brakeOK) {
+        faults.clear(FaultBrakeZero);
+    }
 }
 
-void ECU::updateSwitch() {
-    prevStartSwitchState = startSwitchState;
-
-    startSwitchState = (rmsg.buf[0] == 1);
+void ECU::updateSwitch(uint8_t state) {
+    // prevStartSwitchState belongs to attemptStart(), so repeated switch frames can't hide an edge
+    startSwitchState = (state == 1);
 
-    if(!startSwitchState && driveState) {
+    if(!startSwitchState && control.driveState) {
         //SHUTDOWN THE CAR!!!
         shutdown();
+    } else if(!startSwitchState && control.hornActive) {
+        abortStart();
     }
 }
 
+void ECU::updateDCFHealth(uint8_t health) {
+    data1Health = health;
+}
 
-//TODO: check that this function works for ECU mapping on the car 
-void ECU::updateDriveMode() {
-    // to change the driveMode variable must be manually changed in ECU.h
-    if(rmsg.buf[0] == 0 && driveMode == 0) {
-        //RESET MAX RPM
-        rmsg.id = 0x0C1;
-        rmsg.buf[0] = 128;
-        rmsg.buf[2] = 1; // 1 to write value
+void ECU::updateDCRHealth(uint8_t health) {
+    data2Health = health;
+}
 
-        rmsg.buf[4] = 255; // Write values for max RPM
-        rmsg.buf[5] = 255;
+void ECU::updateDCTHealth(uint8_t health) {
+    data3Health = health;
+}
 
-        motorCAN.write(rmsg);
-        throttle.setMaxTorque(3100);
-    }
-    else if(rmsg.buf[0] == 1 && driveMode == 1) {
-        //RESET MAX RPM
-        rmsg.id = 0x0C1;
-        rmsg.buf[0] = 128;
-        rmsg.buf[2] = 1; // 1 to write value
 
-        rmsg.buf[4] = 255; // Write values for max RPM
-        rmsg.buf[5] = 255;
+//TODO: check that this function works for ECU mapping on the car 
+void ECU::updateDriveMode(uint8_t mode) {
+    if(mode >= DRIVE_MODE_COUNT) {
+        return;
+    }
+    driveMode = mode;
+
+    //RESET MAX RPM (skidpad would call the rpm limiter here)
+    motorTx.send(inverterParameterFrame.pack(InverterParameterMsg{128, 1, 0xFFFF}), TxStatus); // Write max RPM
+
+    // Pointer swap, 17-point curve and filter reconfigure from stored history: no gap in torque commands
+    const DriveModeProfile& profile = DRIVE_MODES[mode];
+    control.torqueMap = &profile.torqueMap;
+    torqueCurve.build(profile.torqueMap, control.motorSpeed);
+    throttle.setFilter(profile.throttleFilter);
+    brake.setFilter(profile.brakeFilter);
+    traction.setTargetSlip(profile.targetSlip);
+}
 
-        motorCAN.write(rmsg);
-        throttle.setMaxTorque(1550);
+// The speed half of the torque map is done here, off the pedal-to-torque path
+void ECU::updateMotorSpeed(int16_t rpm) {
+    if(rpm != control.motorSpeed) {
+        control.motorSpeed = rpm;
+        torqueCurve.build(*control.torqueMap, rpm);
     }
-    else if(rmsg.buf[0] == 2 && driveMode == 2) {
-        // Call the rpm limiter to the motor
-        rmsg.id = 0x0C1;
-        rmsg.buf[0] = 128;
-        rmsg.buf[2] = 1; // 1 to write value
+}
 
-        rmsg.buf[4] = 255; // Write values for max RPM
-        rmsg.buf[5] = 255;
+void ECU::updateFrontWheelSpeeds(const WheelSpeedMsg& speeds) {
+    fl_wheel_rpm = speeds.left;
+    fr_wheel_rpm = speeds.right;
+    traction.setFrontWheels(speeds.left, speeds.right, control.routeRxMicros);
+    imu.setFrontWheels(speeds.left, speeds.right);
+}
 
-        motorCAN.write(rmsg); 
-        throttle.setMaxTorque(620);
+void ECU::updateRearWheelSpeeds(const WheelSpeedMsg& speeds) {
+    rl_wheel_rpm = speeds.left;
+    rr_wheel_rpm = speeds.right;
+    traction.setRearWheels(speeds.left, speeds.right, control.routeRxMicros);
+}
+
+void ECU::updateAccelerometer(const ImuAxesMsg& accel) {
+    x_accel = accel.x * IMU_ACCEL_SCALE;
+    y_accel = accel.y * IMU_ACCEL_SCALE;
+    z_accel = accel.z * IMU_ACCEL_SCALE;
+    imu.setAccel(x_accel, y_accel, z_accel);
+}
+
+//GYRO FRAMES DRIVE THE FUSION STEP (TIMED BY THE FRAME'S RECEIVE TIME)
+void ECU::updateGyro(const ImuAxesMsg& rates) {
+    {
+        PROFILE_SCOPE(ProbeImuFusion);
+        imu.updateGyro(rates.x * IMU_GYRO_SCALE, rates.y * IMU_GYRO_SCALE, rates.z * IMU_GYRO_SCALE, control.routeRxMicros);
     }
+    calculateSlipAngle();
+}
+
+void ECU::calculateSlipAngle() {
+    const ImuEstimate& estimate = imu.getEstimate();
+    x_angle = estimate.roll;
+    y_angle = estimate.pitch;
+    z_angle = estimate.heading;
+    heading = estimate.heading;
+    slipAngle = estimate.slipAngle;
 }
 
 /////////////////////////////////////////
@@ -284,64 +1120,38 @@ void ECU::updateDriveMode() {
 //STOP/START BASE FUNCTIONS
 
 void ECU::sendMotorStartCommand() {
-    Serial.println("Motor start command sent");
-    motorState = true;
+    LOG_INFO(LogMotorStart, 0, 0);
+    control.motorState = true;
     return;
 }
 
 void ECU::sendMotorStopCommand() {
     //Serial.println("Motor stop command sent");
-    motorState = false;
+    control.motorState = false;
     return;
 }
 
 void ECU::sendMotorCommand(int torque) {
+    PROFILE_SCOPE(ProbeSendMotorCommand);
     //Send the command to the motor
-    if(!motorState && brakeOK && throttleOK && slipOK && driveState) { //If the motor has been commanded off but should be on
-        motorState = true;
+    if(!control.motorState && control.brakeOK && control.throttleOK && control.slipOK && control.driveState) { //If the motor has been commanded off but should be on
+        control.motorState = true;
         //TODO: Determine if this needs to re start the inverter (it do not)
     }
-    if(driveState) {
+    if(control.driveState) {
         checkBTOverride();
     }
 
-    Serial.print("BRAKE: ");
-    Serial.print(brakeOK);
-    Serial.print(" TOK: ");
-    Serial.print(throttleOK);
-    Serial.print(" BTO: ");
-    Serial.print(BTOveride);
-    Serial.print(" DS: ");
-    Serial.println(driveState);
-
-
-    if(motorState && brakeOK && throttleOK && !BTOveride && driveState) {
-        Serial.print("COMMANDED: ");
-        Serial.println(torque);
-        motorCommand.id = ReservedIDs::ControlCommandId;
-        motorCommand.buf[0] = torque % 256;
-        motorCommand.buf[1] = torque / 256;
-        motorCommand.buf[2] = 0;
-        motorCommand.buf[3] = 0;
-        motorCommand.buf[4] = 0;
-        motorCommand.buf[5] = 1; //RE AFFIRMS THE INVERTER IS ACTIVE
-        motorCommand.buf[6] = 0;
-        motorCommand.buf[7] = 0;
-        motorCAN.write(motorCommand);
-    }
-    else if(motorState || !driveState) { //Sends a torque Message of 0
-        Serial.print("COMMANDED: ");
-        Serial.println(0);
-        motorCommand.id = ReservedIDs::ControlCommandId;
-        motorCommand.buf[0] = 0;
-        motorCommand.buf[1] = 0;
-        motorCommand.buf[2] = 0;
-        motorCommand.buf[3] = 0;
-        motorCommand.buf[4] = 0;
-        motorCommand.buf[5] = 1; //RE AFFIRMS THE INVERTER IS ACTIVE
-        motorCommand.buf[6] = 0;
-        motorCommand.buf[7] = 0;
-        motorCAN.write(motorCommand); 
+    const int32_t logFlags = control.brakeOK | (control.throttleOK << 1) | (control.BTOveride << 2) | (control.driveState << 3);
+
+    if(control.motorState && control.brakeOK && control.throttleOK && !control.BTOveride && control.driveState) {
+        LOG_DEBUG(LogMotorCommand, torque, logFlags);
+        //ENABLE = 1 RE AFFIRMS THE INVERTER IS ACTIVE
+        motorTx.sendLatest(motorCommandFrame.pack(InverterCommandMsg{static_cast<int16_t>(torque), 0, 0, 1, 0}));
+    }
+    else if(control.motorState || !control.driveState) { //Sends a torque Message of 0
+        LOG_DEBUG(LogMotorCommand, 0, logFlags);
+        motorTx.sendLatest(motorCommandFrame.pack(InverterCommandMsg{0, 0, 0, 1, 0}));
     }
 
     return;
@@ -349,20 +1159,13 @@ void ECU::sendMotorCommand(int torque) {
 
 
 void ECU::shutdown() {
-    driveState = false;
-    BTOveride = false;
-    Serial.println("SHUTDOWN");
-    rmsg.id=ReservedIDs::DriveStateId;
-    rmsg.buf[0]=0;
-    rmsg.buf[1]=0;
-    rmsg.buf[2]=0;
-    rmsg.buf[3]=0;
-    rmsg.buf[4]=0;
-    rmsg.buf[5]=0;
-    rmsg.buf[6]=0;
-    rmsg.buf[7]=0;
-
-    comsCAN.write(rmsg);
+    if(blackBox != nullptr && blackBoxOnShutdown) {
+        blackBox->trigger(BLACK_BOX_REASON_SHUTDOWN, clock.micros());
+    }
+    control.driveState = false;
+    control.BTOveride = false;
+    LOG_INFO(LogShutdown, 0, 0);
+    comsTx.send(driveStateFrame.pack(DriveStateMsg{0, 0, 0, 0, 0}), TxSafety);
     sendMotorStopCommand();
 }
 
@@ -370,23 +1173,29 @@ void ECU::shutdown() {
 bool ECU::attemptStart() {
 
     //DEBUG
-    carIsGood = true;
+    control.carIsGood = true;
     tractiveActive = true;
 
-    if(brake.getBrakeActive() && !startFault && tractiveActive && carIsGood) {
+    // Each switch edge is evaluated once: a heartbeat shutdown with the switch still on is not a new flick
+    const bool switchedOn = startSwitchState && !prevStartSwitchState;
+    const bool switchedOff = prevStartSwitchState && !startSwitchState;
+    prevStartSwitchState = startSwitchState;
+
+    if(brake.getBrakeActive() && !control.startFault && tractiveActive && control.carIsGood && !control.criticalNodeLost) {
         if(startSwitchState) {
             InitialStart();
             return true;
         }
-    } else if(prevStartSwitchState && !startSwitchState && startFault) { // If we were in the fault position but are switching the switch off.
-        startFault = false;
-        //throwError(12); //Some error that the fault got cleared
+    } else if(switchedOff && control.startFault) { // If we were in the fault position but are switching the switch off.
+        control.startFault = false;
+        faults.reset(FaultStartRefused);
     }
-    if(startSwitchState && !prevStartSwitchState) { // If we just flicked on the switch and did not satisfy the start conditions
-        startFault = true;
-        Serial.println("Start Faulted");
+    // If we just flicked on the switch and did not satisfy the start conditions
+    if(switchedOn && !control.startFault) {
+        control.startFault = true;
+        LOG_WARN(LogStartFault, 0, 0);
             //SEND MESSAGE TO DRIVER SCREEN ABOUT START FAULT!!
-        throwError(FaultSourcesIDs::StartFaultId);
+        raiseFault(FaultStartRefused);
     }
     return false;
 }
@@ -394,14 +1203,14 @@ bool ECU::attemptStart() {
 
 void ECU::checkBTOverride() {
 
-    if(BTOveride && !brake.getBrakeActive() && (torqueRequested <= BTO_OFF_THRESHOLD)) {
-        BTOveride = false;
-        Serial.println("BTO Set");
+    if(control.BTOveride && !brake.getBrakeActive() && (control.torqueRequested <= BTO_OFF_THRESHOLD)) {
+        control.BTOveride = false;
+        LOG_INFO(LogBTOSet, control.torqueRequested, 0);
     }
 
-    if(torqueRequested >= BTO_ON_THRESHOLD && !BTOveride && brake.getBrakeActive()) {
-        BTOveride = true;
-        Serial.println("BTO Released");
+    if(control.torqueRequested >= BTO_ON_THRESHOLD && !control.BTOveride && brake.getBrakeActive()) {
+        control.BTOveride = true;
+        LOG_INFO(LogBTOReleased, control.torqueRequested, 0);
     }
 }
 
@@ -417,19 +1226,21 @@ void ECU::calibrateThrottleMax() {
 }
 
 
+void ECU::raiseFault(FaultIndex fault) {
+    if(blackBox != nullptr && !faults.isActive(fault) && (blackBoxFaults & (1u << fault))) {
+        blackBox->trigger(FaultManager::code(fault), clock.micros());
+    }
+    if(faults.raise(fault, clock.millis())) {
+        LOG_WARN(LogFaultRaised, FaultManager::code(fault), faults.getRecord(fault).count);
+        if(FaultManager::dashDecodes(fault)) {
+            throwError(FaultManager::code(fault));
+        } else {
+            comsTx.send(ecuFaultFrame.pack(FaultMsg{FaultManager::code(fault)}), TxSafety);
+        }
+    }
+}
+
 void ECU::throwError(int code) {
-    rmsg.id = ReservedIDs::FaultId; // DIAGNOSTIC ID
-
-    rmsg.len = 8;
-
-    rmsg.buf[0] = code;
-    rmsg.buf[1] = 0;
-    rmsg.buf[2] = 0;
-    rmsg.buf[3] = 0;
-    rmsg.buf[4] = 0;
-    rmsg.buf[5] = 0;
-    rmsg.buf[6] = 0;
-    rmsg.buf[7] = 0;
     // Send the error code to the Dashboard
-    comsCAN.write(rmsg);
+    comsTx.send(faultFrame.pack(FaultMsg{static_cast<uint8_t>(code)}), TxSafety);
 }
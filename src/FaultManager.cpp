@@ -0,0 +1,119 @@
+#include "EcuIDs.h"
+#include "FaultManager.h"
+#include "Reserved.h"
+
+struct FaultSpec {
+    uint8_t code; // Dash-facing code: FaultSourcesIDs, or EcuFaultIDs for the ECU's own
+    bool latching;
+    uint32_t rateLimitMs;
+};
+
+// Indexed by FaultIndex
+static constexpr FaultSpec FAULT_SPECS[FAULT_COUNT] = {
+    {FaultSourcesIDs::ThrottleMismatchId, false, 1000},
+    {EcuFaultIDs::ThrottleZeroFaultId, false, 1000},
+    {EcuFaultIDs::ThrottleStaleFaultId, false, 1000},
+    {FaultSourcesIDs::BrakeZeroId, false, 1000},
+    {FaultSourcesIDs::StartFaultId, true, 250},
+    {EcuFaultIDs::NodeLostFaultId, false, 1000},
+};
+
+// The dash tells faults apart by code alone
+static constexpr bool FaultCodesAreUnique() {
+    for(uint8_t i = 0; i < FAULT_COUNT; i++) {
+        for(uint8_t j = i + 1; j < FAULT_COUNT; j++) {
+            if(FAULT_SPECS[i].code == FAULT_SPECS[j].code) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(FaultCodesAreUnique(), "Two faults share a code");
+
+FaultManager::FaultManager() {
+    for(uint8_t i = 0; i < FAULT_COUNT; i++) {
+        rateLimitMs[i] = FAULT_SPECS[i].rateLimitMs;
+    }
+}
+
+bool FaultManager::raise(FaultIndex fault, uint32_t nowMs) {
+    FaultRecord& record = records[fault];
+    const uint16_t bit = 1u << fault;
+
+    if(record.count == 0) {
+        record.firstSeenMs = nowMs;
+    }
+    if(record.count < UINT16_MAX) {
+        record.count++;
+    }
+    record.lastSeenMs = nowMs;
+    if(occurrences < UINT16_MAX) {
+        occurrences++;
+    }
+    lastFault = fault;
+
+    if(activeMask & bit) {
+        return false; // Still active: the summary frame carries it
+    }
+    activeMask |= bit;
+    if(FAULT_SPECS[fault].latching) {
+        latchedMask |= bit;
+    }
+
+    // Rising edge, but a fault flapping faster than its rate limit is only reported once per window
+    if(record.reported && (nowMs - record.lastReportMs) < rateLimitMs[fault]) {
+        return false;
+    }
+    record.reported = true;
+    record.lastReportMs = nowMs;
+    return true;
+}
+
+void FaultManager::clear(FaultIndex fault) {
+    if(!(latchedMask & (1u << fault))) {
+        activeMask &= ~(1u << fault);
+    }
+}
+
+void FaultManager::reset(FaultIndex fault) {
+    activeMask &= ~(1u << fault);
+    latchedMask &= ~(1u << fault);
+}
+
+void FaultManager::setRateLimit(FaultIndex fault, uint32_t minIntervalMs) {
+    rateLimitMs[fault] = minIntervalMs;
+}
+
+bool FaultManager::isActive(FaultIndex fault) const {
+    return (activeMask & (1u << fault)) != 0;
+}
+
+uint16_t FaultManager::getActiveMask() const {
+    return activeMask;
+}
+
+uint16_t FaultManager::getLatchedMask() const {
+    return latchedMask;
+}
+
+uint16_t FaultManager::getOccurrences() const {
+    return occurrences;
+}
+
+uint8_t FaultManager::getLastCode() const {
+    return (lastFault < FAULT_COUNT) ? FAULT_SPECS[lastFault].code : 0;
+}
+
+const FaultRecord& FaultManager::getRecord(FaultIndex fault) const {
+    return records[fault];
+}
+
+uint8_t FaultManager::code(FaultIndex fault) {
+    return FAULT_SPECS[fault].code;
+}
+
+bool FaultManager::dashDecodes(FaultIndex fault) {
+    return FAULT_SPECS[fault].code < EcuFaultIDs::EcuFaultCodeBase;
+}
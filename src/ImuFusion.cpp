@@ -0,0 +1,73 @@
+#include <math.h>
+#include "ImuFusion.h"
+
+constexpr float WHEEL_RADIUS_M = 0.203f; //PLACEHOLDER (16 in wheel)
+constexpr float FRONT_TRACK_M = 1.22f; //PLACEHOLDER
+constexpr float RPM_TO_MPS = WHEEL_RADIUS_M * 2.0f * 3.14159265f / 60.0f;
+
+constexpr float ATTITUDE_TAU_S = 0.5f; // Longer trusts the gyro more for roll/pitch
+constexpr float GYRO_BIAS_TAU_S = 5.0f; // How slowly the yaw bias follows the wheel yaw rate
+constexpr float LATERAL_LEAK_TAU_S = 2.0f; // Pulls lateral velocity back to 0 against drift
+constexpr float MIN_FUSION_SPEED_MPS = 2.0f; // Below this wheel yaw and slip angle mean nothing
+constexpr float MAX_STEP_S = 0.05f; // Longer gaps (lost frames, start-up) are not integrated
+constexpr float PI_F = 3.14159265f;
+
+void ImuFusion::setAccel(float x, float y, float z) {
+    accelX = x;
+    accelY = y;
+    accelZ = z;
+}
+
+void ImuFusion::setFrontWheels(int16_t leftRpm, int16_t rightRpm) {
+    const float left = leftRpm * RPM_TO_MPS;
+    const float right = rightRpm * RPM_TO_MPS;
+    estimate.speed = 0.5f * (left + right);
+    wheelYawRate = (right - left) / FRONT_TRACK_M;
+}
+
+void ImuFusion::updateGyro(float x, float y, float z, uint32_t rxMicros) {
+    const float dt = (rxMicros - lastGyroMicros) * 1e-6f;
+    const bool integrate = gyroSeen && dt > 0.0f && dt <= MAX_STEP_S;
+    lastGyroMicros = rxMicros;
+    gyroSeen = true;
+
+    // Accelerometer tilt is the long-term reference for roll and pitch
+    const float accelRoll = atan2f(accelY, accelZ);
+    const float accelPitch = atan2f(-accelX, sqrtf(accelY * accelY + accelZ * accelZ));
+    if(!integrate) {
+        estimate.roll = accelRoll;
+        estimate.pitch = accelPitch;
+        estimate.yawRate = z - gyroBias;
+        return;
+    }
+
+    const float attitudeAlpha = ATTITUDE_TAU_S / (ATTITUDE_TAU_S + dt);
+    estimate.roll = attitudeAlpha * (estimate.roll + x * dt) + (1.0f - attitudeAlpha) * accelRoll;
+    estimate.pitch = attitudeAlpha * (estimate.pitch + y * dt) + (1.0f - attitudeAlpha) * accelPitch;
+
+    // Yaw: learn the gyro bias against the front axle only while moving
+    const bool moving = estimate.speed > MIN_FUSION_SPEED_MPS;
+    if(moving) {
+        gyroBias += (z - wheelYawRate - gyroBias) * (dt / GYRO_BIAS_TAU_S);
+    }
+    estimate.yawRate = z - gyroBias;
+    estimate.heading += estimate.yawRate * dt;
+    if(estimate.heading > PI_F) {
+        estimate.heading -= 2.0f * PI_F;
+    } else if(estimate.heading < -PI_F) {
+        estimate.heading += 2.0f * PI_F;
+    }
+
+    // Body slip: integrate lateral velocity (v_y' = a_y - r * v_x) with a leak
+    if(moving) {
+        lateralVelocity += (accelY - estimate.yawRate * estimate.speed - lateralVelocity / LATERAL_LEAK_TAU_S) * dt;
+        estimate.slipAngle = atan2f(lateralVelocity, estimate.speed);
+    } else {
+        lateralVelocity = 0.0f;
+        estimate.slipAngle = 0.0f;
+    }
+}
+
+const ImuEstimate& ImuFusion::getEstimate() const {
+    return estimate;
+}
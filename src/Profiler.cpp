@@ -0,0 +1,108 @@
+#include "Profiler.h"
+
+#ifdef ECU_PROFILING
+
+#if defined(__IMXRT1062__)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+static ProbeStats probeStats[PROBE_COUNT];
+
+void Profiler::begin() {
+#if defined(__IMXRT1062__)
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+uint32_t Profiler::now() {
+#if defined(__IMXRT1062__)
+    return ARM_DWT_CYCCNT;
+#else
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void Profiler::record(ProbeId probe, uint32_t ticks) {
+    ProbeStats& stats = probeStats[probe];
+    stats.count++;
+    stats.total += ticks;
+    if(ticks < stats.min) {
+        stats.min = ticks;
+    }
+    if(ticks > stats.max) {
+        stats.max = ticks;
+    }
+
+    // Bin = bit length of the sample (0 ticks -> bin 0), saturating in the last bin
+    uint8_t bin = (ticks == 0) ? 0 : (32 - __builtin_clz(ticks));
+    if(bin >= PROBE_HISTOGRAM_BINS) {
+        bin = PROBE_HISTOGRAM_BINS - 1;
+    }
+    stats.histogram[bin]++;
+}
+
+const ProbeStats& Profiler::getStats(ProbeId probe) {
+    return probeStats[probe];
+}
+
+void Profiler::reset() {
+    for(uint8_t i = 0; i < PROBE_COUNT; i++) {
+        probeStats[i] = ProbeStats();
+    }
+}
+
+// Little-endian u32 into buf
+static void putU32(uint8_t* buf, uint32_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = (value >> 8) & 0xFF;
+    buf[2] = (value >> 16) & 0xFF;
+    buf[3] = (value >> 24) & 0xFF;
+}
+
+bool Profiler::encodeDumpFrame(uint16_t index, uint8_t* buf) {
+    if(index >= PROFILE_DUMP_FRAMES) {
+        return false;
+    }
+    const uint8_t probe = index / PROBE_FRAMES;
+    const uint8_t frame = index % PROBE_FRAMES;
+    const ProbeStats& stats = probeStats[probe];
+
+    for(uint8_t i = 0; i < 8; i++) {
+        buf[i] = 0;
+    }
+    buf[0] = probe;
+    buf[1] = frame;
+
+    switch(frame) {
+        case 0:
+            putU32(&buf[2], stats.count);
+            break;
+        case 1:
+            putU32(&buf[2], stats.count ? stats.min : 0);
+            break;
+        case 2:
+            putU32(&buf[2], stats.max);
+            break;
+        case 3:
+            putU32(&buf[2], stats.count ? static_cast<uint32_t>(stats.total / stats.count) : 0);
+            break;
+        default: {
+            // Three histogram bins per frame as saturating u16
+            const uint8_t firstBin = (frame - PROBE_SUMMARY_FRAMES) * PROBE_BINS_PER_FRAME;
+            for(uint8_t i = 0; i < PROBE_BINS_PER_FRAME && (firstBin + i) < PROBE_HISTOGRAM_BINS; i++) {
+                const uint32_t binCount = stats.histogram[firstBin + i];
+                const uint16_t clipped = (binCount > UINT16_MAX) ? UINT16_MAX : binCount;
+                buf[2 + i * 2] = clipped & 0xFF;
+                buf[3 + i * 2] = clipped >> 8;
+            }
+            break;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -1,23 +1,27 @@
+#include <stdlib.h>
+#include "BinaryLog.h"
 #include "Throttle.h"
 
 constexpr int MIN_THROTTLE_OUTPUT = 0;
-constexpr int MAX_THROTTLE_OUTPUT = 3100;
 
 constexpr int MIN_THROTTLE_READ_POS = 4;
 constexpr int MAX_THROTTLE_READ_POS = 1023;
 
 constexpr int MIN_THROTTLE_READ_NEG = 4;
 constexpr int MAX_THROTTLE_READ_NEG = 1023;
-constexpr int THROTTLE_ERROR_TOL = 1600;
-constexpr int THROTTLE_MAINTAIN_TOL = 20;
+constexpr int THROTTLE_ERROR_TOL = 1600 * PEDAL_FULL_SCALE / 2200; // Same share of travel as 1600 on the old 2200 torque scale
+constexpr int THROTTLE_MAINTAIN_TOL = 20; // Checks in a row (one per sensor period, ~200 ms)
 constexpr int THROTTLE_NOISE_REDUCTION_THRESHOLD = 60;
 
+// Fraction bits of the pedal gain. Rounded up, the Q16 multiply-shift is never below map() and at
+// most 1 count above it; one more multiply-compare takes that count back off, so a 10-bit reading
+// maps exactly like map() in 32-bit arithmetic
+constexpr int PEDAL_GAIN_SHIFT = 16;
+constexpr int32_t PEDAL_MAX_IN_SPAN = 1 << PEDAL_GAIN_SHIFT; // Keeps the overshoot check's products in 32 bits
+
 
 Throttle::Throttle() {
-    magiMemory[0] = 0;
-    magiMemory[1] = 0;
-    magiMemory[2] = 0;
-    magiMemory[3] = 0;
+    updatePedalScale();
 }
 
 
@@ -43,52 +47,79 @@ int Throttle::checkError() {
 void Throttle::setThrottle1(int input) {
     readIn1 = input;
 
-    Serial.print("T1: ");
-    Serial.println(input);
-    this->throttle1 = map(input, minT1, maxT1, MIN_THROTTLE_OUTPUT, maxTorque);
+    this->throttle1 = mapPedal(input);
+    LOG_DEBUG(LogThrottle1, input, throttle1);
 }
 
 void Throttle::setThrottle2(int input) {
     readIn2 = input;
-    Serial.print("T2: ");
-    Serial.println(input);
     //Removing this so I can do the same throttle for testing on flatcar
     //this->throttle2 = map(-input, -maxT2, -minT2, MIN_THROTTLE_OUTPUT, maxTorque);
-    this->throttle2 = map(input, minT1, maxT1, MIN_THROTTLE_OUTPUT, maxTorque);
+    this->throttle2 = mapPedal(input);
+    LOG_DEBUG(LogThrottle2, input, throttle2);
 }
 
-int Throttle::calculateTorque() {
-    torque = (throttle1 + throttle2) / 2;
-
-    torque = consultMAGI(torque);
-
-    if(torque < 0) {
-        torque = 0;
+//PRECOMPUTES THE PEDAL CURVE (SAME SLOPE AS THE TEENSY CORE'S map(), INCLUDING ITS +1 BRANCH)
+void Throttle::updatePedalScale() {
+    // Both channels use the T1 calibration (same throttle for testing on flatcar)
+    int32_t inSpan = maxT1 - minT1;
+    int32_t outSpan = maxTorque - MIN_THROTTLE_OUTPUT;
+    if(inSpan > outSpan) {
+        inSpan++;
+        outSpan++;
+    }
+    pedalOffset = minT1;
+    pedalGain = 0; // Inverted, empty or absurd calibration leaves the pedal dead instead of dividing by 0
+    pedalInSpan = 0;
+    pedalOutSpan = 0;
+    if(inSpan > 0 && outSpan > 0 && inSpan <= PEDAL_MAX_IN_SPAN) {
+        const int64_t gain = ((static_cast<int64_t>(outSpan) << PEDAL_GAIN_SHIFT) + inSpan - 1) / inSpan;
+        pedalGain = (gain > UINT32_MAX) ? UINT32_MAX : static_cast<uint32_t>(gain);
+        pedalInSpan = static_cast<uint32_t>(inSpan);
+        pedalOutSpan = static_cast<uint32_t>(outSpan);
+    }
+    // Readings this far past the calibration already map way beyond full scale: clamp them there
+    // rather than let a product wrap
+    pedalDeltaLimit = UINT32_MAX;
+    if(pedalGain > 0) {
+        pedalDeltaLimit = UINT32_MAX / ((pedalGain > pedalOutSpan) ? pedalGain : pedalOutSpan + 1);
     }
-
-    return torque;
 }
 
+//PER-SAMPLE PEDAL MAP: 32-BIT MULTIPLY + SHIFT, SAME RESULT AS map()
+int32_t Throttle::mapPedal(int input) const {
+    const int32_t delta = input - pedalOffset;
+    // map() truncates toward zero, so scale the magnitude and put the sign back
+    uint32_t magnitude = static_cast<uint32_t>((delta < 0) ? -delta : delta);
+    if(magnitude > pedalDeltaLimit) {
+        magnitude = pedalDeltaLimit;
+    }
+    uint32_t scaled = (magnitude * pedalGain) >> PEDAL_GAIN_SHIFT;
+    if(scaled * pedalInSpan > magnitude * pedalOutSpan) {
+        scaled--; // The rounded-up gain overshot: back to the truncated quotient
+    }
+    return ((delta < 0) ? -static_cast<int32_t>(scaled) : static_cast<int32_t>(scaled)) + MIN_THROTTLE_OUTPUT;
+}
 
-int Throttle::consultMAGI(int input) {
-
-    // Add it to the memory
-    rollingTorque = 0;
+int Throttle::calculateTorque() {
+    const int average = (throttle1 + throttle2) / 2; // Constant divisors compile to shifts
+    return liftOff(pedalFilter.update(average), average);
+}
 
-    this->magiMemory[3] = this->magiMemory[2];
-    this->magiMemory[2] = this->magiMemory[1];
-    this->magiMemory[1] = this->magiMemory[0];
-    this->magiMemory[0] = torque;
+int Throttle::refreshTorque() {
+    const int average = (throttle1 + throttle2) / 2;
+    return liftOff(pedalFilter.replace(average), average);
+}
 
+int Throttle::liftOff(int filtered, int average) {
+    torque = filtered;
 
-    for(int i = 0; i < 4; i++) {
-        if(this->magiMemory[i] == 0) {
-            return 0;
-        }
-        rollingTorque += this->magiMemory[i];
+    // Lift-off bypasses the filter: a released pedal drops the request at once
+    if(torque < 0 || average <= 0) {
+        torque = 0;
     }
 
-    return rollingTorque / 4;
+    return torque;
 }
 
 bool Throttle::getActive() {
@@ -98,14 +129,21 @@ bool Throttle::getActive() {
 void Throttle::setCalibrationValueMin(int min1, int min2) {
     maxT2 = min2;
     minT1 = min1;
+    updatePedalScale();
 }
 
 
 void Throttle::setCalibrationValueMax(int max1, int max2) {
     minT2 = max2;
     maxT1 = max1;
+    updatePedalScale();
 }
 
 void Throttle::setMaxTorque(int torqueVal) {
     maxTorque = torqueVal;
-}
\ No newline at end of file
+    updatePedalScale();
+}
+
+void Throttle::setFilter(const FilterConfig& config) {
+    pedalFilter.configure(config);
+}
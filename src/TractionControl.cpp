@@ -0,0 +1,103 @@
+#include "BinaryLog.h"
+#include "TractionControl.h"
+
+constexpr int32_t MIN_REFERENCE_RPM = 60; // Front speed floor so launch slip stays finite
+constexpr uint32_t WHEEL_DATA_STALE_US = 50000; // Older wheel data turns the limiter off
+constexpr int32_t TC_CUT_GAIN = 2; // Cap cut per step = excess slip * gain (Q12)
+constexpr int32_t TC_RECOVERY_STEP = 41; // Cap regained per step below target (~1%)
+
+TractionControl::TractionControl(Clock& clockIn) : clock(clockIn) {}
+
+void TractionControl::setFrontWheels(int16_t leftRpm, int16_t rightRpm, uint32_t rxMicros) {
+    frontLeft = leftRpm;
+    frontRight = rightRpm;
+    frontMicros = rxMicros;
+    frontSeen = true;
+    updateSlip();
+}
+
+void TractionControl::setRearWheels(int16_t leftRpm, int16_t rightRpm, uint32_t rxMicros) {
+    rearLeft = leftRpm;
+    rearRight = rightRpm;
+    rearMicros = rxMicros;
+    rearSeen = true;
+    updateSlip();
+}
+
+//SLIP RATIO OF THE DRIVEN AXLE, ONE DIVISION PER WHEEL FRAME (NOT PER TORQUE COMMAND)
+void TractionControl::updateSlip() {
+    int32_t front = (frontLeft + frontRight) / 2;
+    int32_t rear = (rearLeft + rearRight) / 2;
+    front = (front < 0) ? -front : front;
+    rear = (rear < 0) ? -rear : rear;
+    if(front < MIN_REFERENCE_RPM) {
+        front = MIN_REFERENCE_RPM;
+    }
+
+    slip = ((rear - front) << SLIP_SHIFT) / front;
+    if(slip < 0) {
+        slip = 0; // Braking slip is not ours to fix
+    }
+    if(intervening && slip > stats.peakSlip) {
+        stats.peakSlip = slip;
+    }
+}
+
+void TractionControl::setTargetSlip(int32_t target) {
+    targetSlip = target;
+}
+
+//TORQUE CAP CONTROLLER STEP (FIXED RATE, INDEPENDENT OF THE PEDAL FRAMES)
+void TractionControl::update() {
+    const uint32_t now = clock.micros();
+    const bool fresh = frontSeen && rearSeen && (now - frontMicros) <= WHEEL_DATA_STALE_US
+                       && (now - rearMicros) <= WHEEL_DATA_STALE_US;
+
+    if(targetSlip == 0 || !fresh) {
+        torqueCap = SLIP_ONE;
+    } else if(slip > targetSlip) {
+        torqueCap -= (slip - targetSlip) * TC_CUT_GAIN;
+        if(torqueCap < 0) {
+            torqueCap = 0;
+        }
+    } else if(torqueCap < SLIP_ONE) {
+        torqueCap += TC_RECOVERY_STEP;
+        if(torqueCap > SLIP_ONE) {
+            torqueCap = SLIP_ONE;
+        }
+    }
+
+    // Intervention runs from the first cut until the cap has fully recovered
+    if(!intervening && torqueCap < SLIP_ONE) {
+        intervening = true;
+        interventionStart = now;
+        stats.interventions++;
+        stats.peakSlip = slip;
+        LOG_INFO(LogTractionStart, slip, torqueCap);
+    } else if(intervening && torqueCap == SLIP_ONE) {
+        intervening = false;
+        stats.lastInterventionUs = now - interventionStart;
+        stats.totalInterventionUs += stats.lastInterventionUs;
+        LOG_INFO(LogTractionEnd, stats.lastInterventionUs, stats.peakSlip);
+    }
+}
+
+int32_t TractionControl::limit(int32_t torque) const {
+    return (torque * torqueCap) >> SLIP_SHIFT;
+}
+
+int32_t TractionControl::getSlip() const {
+    return slip;
+}
+
+int32_t TractionControl::getTorqueCap() const {
+    return torqueCap;
+}
+
+bool TractionControl::isIntervening() const {
+    return intervening;
+}
+
+const TractionStats& TractionControl::getStats() const {
+    return stats;
+}
@@ -0,0 +1,109 @@
+#include "TxScheduler.h"
+
+TxScheduler::TxScheduler(Clock& clockIn) : clock(clockIn) {}
+
+void TxScheduler::attach(CanBus& busIn) {
+    bus = &busIn;
+}
+
+bool TxScheduler::send(const CAN_message_t& msg, TxClass txClass) {
+    if(txClass == TxControl) {
+        sendLatest(msg);
+        return true;
+    }
+    const TxEntry entry = {msg, clock.micros()};
+    if(!queues[txClass - 1].push(entry)) {
+        stats[txClass].dropped++;
+        return false;
+    }
+    service(); // Goes straight out when the bus is idle
+    return true;
+}
+
+void TxScheduler::sendLatest(const CAN_message_t& msg) {
+    if(latestPending) {
+        stats[TxControl].coalesced++; // The waiting command is stale now
+    }
+    latest = msg;
+    latestMicros = clock.micros();
+    latestPending = true;
+    service();
+}
+
+//FRAMES THE BUS HAS HAD TIME TO SEND SINCE THEY WERE HANDED OVER NO LONGER COUNT (AN ESTIMATE)
+void TxScheduler::updateInFlightEstimate(uint32_t now) {
+    if(estimatedInFlight == 0) {
+        return;
+    }
+    const uint32_t done = (now - estimateSince) / TX_FRAME_TIME_US;
+    if(done >= estimatedInFlight) {
+        estimatedInFlight = 0;
+    } else {
+        estimatedInFlight -= done;
+        estimateSince += done * TX_FRAME_TIME_US;
+    }
+}
+
+void TxScheduler::recordSent(TxClass txClass, uint32_t queuedMicros, uint32_t now) {
+    if(estimatedInFlight == 0) {
+        estimateSince = now;
+    }
+    estimatedInFlight++;
+
+    TxClassStats& classStats = stats[txClass];
+    const uint32_t delay = now - queuedMicros;
+    classStats.sent++;
+    classStats.totalDelayUs += delay;
+    if(delay > classStats.maxDelayUs) {
+        classStats.maxDelayUs = delay;
+    }
+}
+
+//HIGHEST CLASS FIRST WHILE THE ESTIMATE SAYS THE CONTROLLER HAS ROOM (A REFUSED FRAME STAYS QUEUED)
+void TxScheduler::service() {
+    if(bus == nullptr) {
+        return;
+    }
+    const uint32_t now = clock.micros();
+    updateInFlightEstimate(now);
+
+    while(estimatedInFlight < TX_IN_FLIGHT_LIMIT) {
+        if(latestPending) {
+            if(!bus->write(latest)) {
+                return;
+            }
+            latestPending = false;
+            recordSent(TxControl, latestMicros, now);
+            continue;
+        }
+
+        bool moved = false;
+        TxEntry entry;
+        for(uint8_t c = TxSafety; c < TX_CLASS_COUNT && !moved; c++) {
+            if(!queues[c - 1].peek(entry)) {
+                continue;
+            }
+            if(!bus->write(entry.msg)) {
+                return;
+            }
+            queues[c - 1].discard();
+            recordSent(static_cast<TxClass>(c), entry.queuedMicros, now);
+            moved = true;
+        }
+        if(!moved) {
+            return;
+        }
+    }
+}
+
+uint32_t TxScheduler::backlog() const {
+    uint32_t waiting = latestPending ? 1 : 0;
+    for(uint8_t c = TxSafety; c < TX_CLASS_COUNT; c++) {
+        waiting += queues[c - 1].size();
+    }
+    return waiting;
+}
+
+const TxClassStats& TxScheduler::getStats(TxClass txClass) const {
+    return stats[txClass];
+}
@@ -1,16 +1,52 @@
 #include <Arduino.h>
+#include "BinaryLog.h"
+#include "BlackBox.h"
+#include "BlockLogger.h"
+#include "CanTrace.h"
 #include "ECU.h"
+#include "SdBlockStorage.h"
+#include "TeensyHal.h"
 
 constexpr int BEGIN = 9600;
 constexpr int BAUDRATE = 250000;
+constexpr bool INTERRUPT_RX = false; // true -> FlexCAN ISRs feed the ECU rings instead of polling
+constexpr bool CAN_PROMISCUOUS = false; // true -> no acceptance filters: every ID is logged (and read)
+constexpr bool SENSOR_CANFD = false; // true -> throttle/brake batches also arrive on CAN3 (CAN FD)
+constexpr uint32_t CANFD_NOMINAL_BAUDRATE = 500000; // Arbitration phase
+constexpr uint32_t CANFD_DATA_BAUDRATE = 2000000; // Data phase (bit rate switching)
+constexpr uint32_t SD_LOG_SECTORS = 1UL << 20; // 512 MiB per power cycle (~1 h with both buses saturated)
+constexpr uint32_t SD_LOG_FLUSH_MS = 1000; // Longest a frame waits in RAM at low bus load
+constexpr uint32_t BLACK_BOX_RECORDS = 8192; // 160 KiB, ~5 s of typical traffic + state snapshots
+constexpr uint32_t BLACK_BOX_TAIL_US = 1000000; // Kept after the trigger
+constexpr int BLACK_BOX_USB_COMMAND = 'B'; // Sent by the laptop: snapshot comes back as an ECUTRACE file
+
+// Black box RAM: DMAMEM = OCRAM (default), EXTMEM = PSRAM if fitted, -D ECU_BLACKBOX_MEM= for DTCM
+#ifndef ECU_BLACKBOX_MEM
+#define ECU_BLACKBOX_MEM DMAMEM
+#endif
 
 FlexCAN_T4<CAN1, RX_SIZE_256, TX_SIZE_16> can1;
 FlexCAN_T4<CAN2, RX_SIZE_256, TX_SIZE_16> can2;
-ECU mainECU;
+FlexCanBus<CAN1> motorBus(can1);
+FlexCanBus<CAN2> comsBus(can2);
+FlexCAN_T4FD<CAN3, RX_SIZE_256, TX_SIZE_16> can3;
+FlexCanFdBus<CAN3> sensorBus(can3);
+SdBlockStorage sdCard;
+BlockLogger sdLog;
+ECU_BLACKBOX_MEM TraceRecord blackBoxRecords[BLACK_BOX_RECORDS];
+BlackBox blackBox(blackBoxRecords, BLACK_BOX_RECORDS, BLACK_BOX_TAIL_US);
+FrameTapPair recorders(&sdLog, &blackBox);
+TeensyClock teensyClock;
+TeensyGpio teensyGpio;
+TappedCanBus loggedMotorBus(motorBus, TRACE_BUS_MOTOR, teensyClock, recorders);
+TappedCanBus loggedComsBus(comsBus, TRACE_BUS_COMS, teensyClock, recorders);
+ECU mainECU(teensyClock, teensyGpio);
+uint32_t lastLogFlush = 0;
 
 void setup() {
   Serial.begin(BEGIN);
   Serial.println("Start");
+  BinaryLog::begin(teensyClock);
 
   // set up CAN
   can1.begin();
@@ -19,13 +55,84 @@ void setup() {
   can2.begin();
   can2.setBaudRate(BAUDRATE);
 
-  mainECU.setCAN(can2, can1);
+  if(SENSOR_CANFD) {
+    CANFD_timings_t timings;
+    timings.clock = CLK_24MHz;
+    timings.baudrate = CANFD_NOMINAL_BAUDRATE;
+    timings.baudrateFD = CANFD_DATA_BAUDRATE;
+    timings.propdelay = 190;
+    timings.bus_length = 1;
+    timings.sample = 75;
+    can3.begin();
+    can3.setBaudRate(timings);
+    can3.setRegions(64); // 64-byte mailboxes
+    mainECU.setSensorCAN(sensorBus);
+  }
+
+  // Without a card the logger just counts what it couldn't keep
+  if(sdCard.begin(SD_LOG_SECTORS)) {
+    sdLog.attach(sdCard);
+    Serial.println(sdCard.fileName());
+  } else {
+    Serial.println("No SD log");
+  }
+
+  mainECU.setCAN(loggedComsBus, loggedMotorBus);
+  mainECU.setLogTap(&recorders);
+  mainECU.setBlackBox(&blackBox);
+
+  // Only routed IDs get past the Rx FIFO filters, unless the logger should see the whole bus
+  if(INTERRUPT_RX || !CAN_PROMISCUOUS) {
+    can1.enableFIFO();
+    can2.enableFIFO();
+  }
+  if(!CAN_PROMISCUOUS) {
+    const bool motorFiltered = SetAcceptanceFilters(can1, ECU::getAcceptancePlan());
+    const bool comsFiltered = SetAcceptanceFilters(can2, ECU::getAcceptancePlan());
+    if(!motorFiltered || !comsFiltered) {
+      Serial.println("CAN filters refused, accepting all IDs");
+    } else {
+      Serial.println("CAN filters on: SD log, black box and bus stats see routed IDs only");
+    }
+    // The bus stats dump says when it only covers the routed IDs
+    mainECU.getBusAnalyzer().setFiltered(TRACE_BUS_MOTOR, motorFiltered);
+    mainECU.getBusAnalyzer().setFiltered(TRACE_BUS_COMS, comsFiltered);
+  }
+
+  if(INTERRUPT_RX) {
+    can1.enableFIFOInterrupt();
+    can1.onReceive(ECU::onMotorReceive);
+
+    can2.enableFIFOInterrupt();
+    can2.onReceive(ECU::onComsReceive);
+
+    mainECU.setRxMode(RxMode::Interrupt);
+  }
+
   mainECU.boot();
-  pinMode(19, OUTPUT);
-  
+}
+
+// Black box snapshot as an ECUTRACE file on USB serial (blocks until sent, so parked only)
+void dumpBlackBoxUsb() {
+  const TraceHeader header = MakeTraceHeader();
+  Serial.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+  for(uint32_t i = 0; i < blackBox.size(); i++) {
+    Serial.write(reinterpret_cast<const uint8_t*>(&blackBox.at(i)), sizeof(TraceRecord));
+  }
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
   mainECU.run();
+
+  // At most one sector per pass, only when the card is ready
+  sdLog.service();
+  if(millis() - lastLogFlush >= SD_LOG_FLUSH_MS) {
+    sdLog.flush();
+    lastLogFlush = millis();
+  }
+
+  if(Serial.available() > 0 && Serial.read() == BLACK_BOX_USB_COMMAND && !mainECU.isDriving()) {
+    dumpBlackBoxUsb();
+  }
 }
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <math.h>
+#include "BinaryLog.h"
+#include "EcuFixture.h"
+
+constexpr double IMU_DRIVE_G = 9.80665;
+constexpr double IMU_DRIVE_ROLL = 2.0 / IMU_DRIVE_DEG; // Parked on a slope
+constexpr double IMU_DRIVE_PITCH = -3.0 / IMU_DRIVE_DEG;
+constexpr double IMU_DRIVE_SKIDPAD_MPS = 10.0;
+constexpr double IMU_DRIVE_SKIDPAD_R_M = 9.125; // FS skidpad centre line
+
+CAN_message_t makeFrame(uint32_t id, int32_t value) {
+    CAN_message_t msg;
+    msg.id = id;
+    msg.len = 8;
+    for(uint8_t i = 0; i < 4; i++) {
+        msg.buf[i] = (static_cast<uint32_t>(value) >> (8 * i)) & 0xFF;
+    }
+    return msg;
+}
+
+CAN_message_t makeWheelFrame(uint32_t id, int16_t left, int16_t right) {
+    CAN_message_t msg;
+    msg.id = id;
+    msg.len = 8;
+    msg.buf[0] = static_cast<uint16_t>(left) & 0xFF;
+    msg.buf[1] = static_cast<uint16_t>(left) >> 8;
+    msg.buf[2] = static_cast<uint16_t>(right) & 0xFF;
+    msg.buf[3] = static_cast<uint16_t>(right) >> 8;
+    for(uint8_t i = 4; i < 8; i++) {
+        msg.buf[i] = 0;
+    }
+    return msg;
+}
+
+CAN_message_t makeImuFrame(uint32_t id, int16_t x, int16_t y, int16_t z) {
+    CAN_message_t msg = makeWheelFrame(id, x, y);
+    msg.buf[4] = static_cast<uint16_t>(z) & 0xFF;
+    msg.buf[5] = static_cast<uint16_t>(z) >> 8;
+    return msg;
+}
+
+uint32_t xorshift(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+long teensyMap(long x, long inMin, long inMax, long outMin, long outMax) {
+    if((inMax - inMin) > (outMax - outMin)) {
+        return (x - inMin) * (outMax - outMin + 1) / (inMax - inMin + 1) + outMin;
+    }
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+EcuFixture::EcuFixture() : comsSim(clock), motorSim(clock), ecu(clock, gpio) {}
+
+void EcuFixture::setFiltered(bool filtered) {
+    if(filtered) {
+        const AcceptancePlan<CAN_ACCEPTANCE_FILTERS>& plan = ECU::getAcceptancePlan();
+        comsSim.setAcceptance(plan.filters, plan.count);
+        motorSim.setAcceptance(plan.filters, plan.count);
+    } else {
+        comsSim.setAcceptance(nullptr, 0);
+        motorSim.setAcceptance(nullptr, 0);
+    }
+    ecu.getBusAnalyzer().setFiltered(TRACE_BUS_COMS, filtered);
+    ecu.getBusAnalyzer().setFiltered(TRACE_BUS_MOTOR, filtered);
+}
+
+void EcuFixture::setComsFeed(std::function<void(const CAN_message_t&, uint64_t)> feed) {
+    comsFeed = feed;
+}
+
+void EcuFixture::onComsTransmit(std::function<void(const SimTxFrame&)> listener) {
+    comsListener = listener;
+}
+
+void EcuFixture::feedComs(const CAN_message_t& msg, uint64_t atUs) {
+    if(comsFeed) {
+        comsFeed(msg, atUs);
+    } else {
+        comsSim.inject(msg, atUs);
+    }
+}
+
+void EcuFixture::onComsFrame(const SimTxFrame& frame) {
+    if(comsListener) {
+        comsListener(frame);
+    }
+    if(frame.msg.id == ReservedIDs::HealthCheckId) {
+        static const uint32_t DC_IDS[] = {ReservedIDs::DCFId, ReservedIDs::DCRId, ReservedIDs::DCTId};
+        for(const uint32_t id : DC_IDS) {
+            feedComs(makeFrame(id, DC_HEALTHY), frame.timeUs + HEALTH_REPLY_DELAY_US);
+        }
+    }
+}
+
+void EcuFixture::boot() {
+    boot(comsSim, motorSim);
+}
+
+void EcuFixture::boot(CanBus& coms, CanBus& motor) {
+    comsSim.onTransmit([this](const SimTxFrame& frame) { onComsFrame(frame); });
+    BinaryLog::begin(clock);
+    ecu.setCAN(coms, motor);
+    ecu.boot();
+}
+
+void EcuFixture::setStartSwitch(uint64_t atUs, bool on) {
+    feedComs(makeFrame(ReservedIDs::StartSwitchId, on ? 1 : 0), atUs);
+}
+
+void EcuFixture::runUntil(uint64_t endUs) {
+    while(clock.now() < endUs) {
+        clock.advance(LOOP_PERIOD_US);
+        ecu.run();
+    }
+}
+
+void EcuFixture::finish() {
+    while(BinaryLog::flush(UINT16_MAX) > 0) {
+    }
+}
+
+double traceSlip(SpinTrace trace, uint64_t t) {
+    const double s = t / 1e6;
+    switch(trace) {
+        case SpinTrace::Grip:
+            return 0.05;
+        case SpinTrace::Oscillate:
+            return (s < 1.5) ? 0.15 - 0.15 * cos(2 * M_PI * 5 * s) : 0.02;
+        default:
+            return (s < 0.2) ? 0.4 * s / 0.2 : (s < 0.7) ? 0.4 : 0.02;
+    }
+}
+
+TractionResult runSpinTrace(SpinTrace trace) {
+    SimClock clock;
+    TractionControl traction(clock);
+    traction.setTargetSlip(SPIN_TARGET);
+    const uint64_t rxDelay = (trace == SpinTrace::Queued) ? SPIN_RX_DELAY_US : 0;
+    const uint64_t dropAt = (trace == SpinTrace::Dropout) ? 500000 : SPIN_TRACE_US;
+
+    TractionResult result;
+    double requested = 0;
+    double delivered = 0;
+    for(uint64_t t = SENSOR_PERIOD_US; t < SPIN_TRACE_US; t += TRACTION_UPDATE_PERIOD_US) {
+        clock.set(t);
+        const uint64_t arrival = t - rxDelay;
+        if(t % SENSOR_PERIOD_US == 0 && t < dropAt + rxDelay) {
+            const double slip = traceSlip(trace, arrival);
+            const int16_t rear = static_cast<int16_t>(300 * (1 + slip));
+            traction.setFrontWheels(300, 300, static_cast<uint32_t>(arrival));
+            traction.setRearWheels(rear, rear, static_cast<uint32_t>(arrival));
+            result.lastFrameUs = arrival;
+            if(result.firstOverUs == 0 && traction.getSlip() > SPIN_TARGET) {
+                result.firstOverUs = arrival;
+            }
+        }
+        const bool wasCut = traction.getTorqueCap() < SLIP_ONE;
+        traction.update();
+        const int32_t cap = traction.getTorqueCap();
+        result.minCap = std::min(result.minCap, cap);
+        if(cap < SLIP_ONE && result.firstCutUs == 0) {
+            result.firstCutUs = t;
+        }
+        if(cap == SLIP_ONE && wasCut) {
+            result.recoveredUs = t;
+        }
+        const int32_t limited = traction.limit(SPIN_TORQUE);
+        result.maxLimited = std::max(result.maxLimited, limited);
+        requested += SPIN_TORQUE;
+        delivered += limited;
+    }
+    result.interventions = traction.getStats().interventions;
+    result.cutShare = 1.0 - delivered / requested;
+    return result;
+}
+
+void makeImuDrive(std::vector<TraceRecord>& records, std::vector<ImuTruth>& truth) {
+    uint32_t random = 0x1A4F;
+    const auto noise = [&](int32_t span) { return static_cast<int32_t>(xorshift(random) % (2 * span + 1)) - span; };
+    const auto record = [&](const CAN_message_t& msg, uint64_t t) {
+        records.push_back(MakeTraceRecord(TRACE_BUS_COMS, false, static_cast<uint32_t>(t), msg));
+    };
+
+    double heading = 0;
+    double lateralVelocity = 0;
+    for(uint64_t t = 0; t < 50000000; t += SENSOR_PERIOD_US) {
+        const double s = t / 1e6;
+        const double dt = SENSOR_PERIOD_US / 1e6;
+        const bool parked = s < 5;
+        const double speed = parked ? 0 : (s < 8) ? 4 * (s - 5) : (s < 14) ? 12 : (s < 15) ? 12 - 2 * (s - 14)
+                                                                                        : IMU_DRIVE_SKIDPAD_MPS;
+        const double yawRate = (s >= 15 && s < 45) ? IMU_DRIVE_SKIDPAD_MPS / IMU_DRIVE_SKIDPAD_R_M : 0;
+        const double roll = parked ? IMU_DRIVE_ROLL : 0;
+        const double pitch = parked ? IMU_DRIVE_PITCH : 0;
+
+        // Slide: slip angle ramps up over 0.5 s, holds 0.5 s, ramps back
+        const double slide = (s < 46) ? 0 : (s < 46.5) ? (s - 46) / 0.5 : (s < 47) ? 1 : (s < 47.5) ? (47.5 - s) / 0.5 : 0;
+        const double slip = slide * IMU_DRIVE_SLIDE_DEG / IMU_DRIVE_DEG;
+        const double nextLateral = speed * tan(slip);
+        const double lateralAccel = (nextLateral - lateralVelocity) / dt + yawRate * speed;
+        lateralVelocity = nextLateral;
+        heading += yawRate * dt;
+
+        const double accelX = -IMU_DRIVE_G * sin(pitch) + ((s >= 5 && s < 8) ? 4 : 0);
+        const double accelY = IMU_DRIVE_G * sin(roll) * cos(pitch) + lateralAccel;
+        const double accelZ = IMU_DRIVE_G * cos(roll) * cos(pitch);
+        const double wheelRpm = speed * IMU_DRIVE_RPM_PER_MPS;
+        const double wheelSplit = yawRate * IMU_DRIVE_TRACK_M / 2 * IMU_DRIVE_RPM_PER_MPS;
+        const auto mg = [&](double accel) { return static_cast<int16_t>(lround(accel / IMU_DRIVE_G * 1000) + noise(5)); };
+
+        record(makeWheelFrame(EcuIDs::FrontWheelSpeedId, static_cast<int16_t>(lround(wheelRpm - wheelSplit) + noise(2)),
+                              static_cast<int16_t>(lround(wheelRpm + wheelSplit) + noise(2))), t + 300);
+        record(makeImuFrame(EcuIDs::ImuAccelId, mg(accelX), mg(accelY), mg(accelZ)), t + 500);
+        record(makeImuFrame(EcuIDs::ImuGyroId, static_cast<int16_t>(noise(2)), static_cast<int16_t>(noise(2)),
+                            static_cast<int16_t>(lround(yawRate * IMU_DRIVE_DEG * 100) + GYRO_Z_BIAS + noise(2))), t + 600);
+        truth.push_back({(t + 600) / 1e6, roll, pitch, yawRate, heading, slip});
+    }
+}
@@ -0,0 +1,61 @@
+#include <unistd.h>
+#include "FileBlockStorage.h"
+
+FileBlockStorage::~FileBlockStorage() {
+    close();
+}
+
+bool FileBlockStorage::open(const char* path, uint32_t sectorCount) {
+    close();
+    file = fopen(path, "wb+");
+    if(file == nullptr) {
+        return false;
+    }
+    // Sparse on most filesystems, but reads back as zeros like a fresh contiguous file
+    if(ftruncate(fileno(file), static_cast<off_t>(sectorCount) * 512) != 0) {
+        close();
+        return false;
+    }
+    sectors = sectorCount;
+    written = 0;
+    return true;
+}
+
+void FileBlockStorage::close() {
+    if(file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+    sectors = 0;
+}
+
+void FileBlockStorage::setTiming(SimClock& clockIn, uint32_t perSectorUs, uint32_t stallLengthUs,
+                                 uint32_t stallEverySectors) {
+    clock = &clockIn;
+    sectorUs = perSectorUs;
+    stallUs = stallLengthUs;
+    stallEvery = stallEverySectors;
+}
+
+bool FileBlockStorage::busy() {
+    return clock != nullptr && clock->now() < busyUntil;
+}
+
+bool FileBlockStorage::writeSector(uint32_t sector, const uint8_t* data) {
+    if(file == nullptr || sector >= sectors) {
+        return false;
+    }
+    if(fseeko(file, static_cast<off_t>(sector) * 512, SEEK_SET) != 0 || fwrite(data, 512, 1, file) != 1) {
+        return false;
+    }
+    written++;
+    if(clock != nullptr) {
+        const bool stall = (stallEvery > 0) && (written % stallEvery) == 0;
+        busyUntil = clock->now() + sectorUs + (stall ? stallUs : 0);
+    }
+    return true;
+}
+
+uint32_t FileBlockStorage::sectorCount() const {
+    return sectors;
+}
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <memory>
+#include <string.h>
+#include <thread>
+#include "BinaryLog.h"
+#include "ECU.h"
+#include "Replay.h"
+#include "SimHal.h"
+
+// Keeps every tapped frame and forwards it to an optional second tap (e.g. a TraceWriter)
+class CollectingTap : public FrameTap {
+    private:
+        std::vector<TraceRecord>& records;
+        FrameTap* forward;
+
+    public:
+        CollectingTap(std::vector<TraceRecord>& output, FrameTap* next) : records(output), forward(next) {}
+
+        void onFrame(const TraceRecord& record) override {
+            records.push_back(record);
+            if(forward != nullptr) {
+                forward->onFrame(record);
+            }
+        }
+};
+
+bool IsGoldenFrame(const TraceRecord& record) {
+    if((record.flags & TRACE_FLAG_TX) == 0) {
+        return false;
+    }
+    return (record.bus == TRACE_BUS_MOTOR && record.id == ReservedIDs::ControlCommandId)
+        || (record.bus == TRACE_BUS_COMS && (record.id == ReservedIDs::FaultId || record.id == EcuIDs::EcuFaultId));
+}
+
+ReplayEngine::ReplayEngine(const ReplayOptions& replayOptions) : options(replayOptions) {}
+
+ReplayReport ReplayEngine::run(const std::vector<TraceRecord>& input, std::vector<TraceRecord>& output,
+                               FrameTap* tap) {
+    ReplayReport report;
+    SimClock clock;
+    SimGpio gpio;
+    SimCanBus comsSim(clock);
+    SimCanBus motorSim(clock);
+    CollectingTap collector(output, tap);
+    TappedCanBus coms(comsSim, TRACE_BUS_COMS, clock, collector);
+    TappedCanBus motor(motorSim, TRACE_BUS_MOTOR, clock, collector);
+
+    std::unique_ptr<ECU> ecu(new ECU(clock, gpio));
+    BinaryLog::begin(clock);
+    ecu->setCAN(coms, motor);
+    ecu->boot();
+
+    // Frames the ECU sent in the original capture are output, not input
+    uint64_t lastUs = 0;
+    for(const TraceRecord& record : input) {
+        if((record.flags & TRACE_FLAG_TX) || record.bus == TRACE_BUS_ECU) {
+            continue;
+        }
+        SimCanBus& bus = (record.bus == TRACE_BUS_MOTOR) ? motorSim : comsSim;
+        bus.inject(TraceRecordToMessage(record), record.timestampUs);
+        lastUs = (record.timestampUs > lastUs) ? record.timestampUs : lastUs;
+        report.framesIn++;
+    }
+
+    const uint64_t endUs = lastUs + options.tailUs;
+    const auto wallStart = std::chrono::steady_clock::now();
+    while(clock.now() < endUs) {
+        clock.advance(options.loopPeriodUs);
+        ecu->run();
+        report.passes++;
+        if(options.realTime) {
+            std::this_thread::sleep_until(wallStart + std::chrono::microseconds(clock.now()));
+        }
+    }
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    report.simSeconds = clock.now() / 1e6;
+    report.rxDropped = comsSim.rxDropped() + motorSim.rxDropped();
+    for(const TraceRecord& record : output) {
+        report.framesOut += (record.flags & TRACE_FLAG_TX) ? 1 : 0;
+    }
+    return report;
+}
+
+void ReplayEngine::compare(const std::vector<TraceRecord>& output, const std::vector<TraceRecord>& golden,
+                           ReplayReport& report) const {
+    std::vector<const TraceRecord*> actual;
+    std::vector<const TraceRecord*> expected;
+    uint64_t goldenEndUs = 0;
+    for(const TraceRecord& record : golden) {
+        if(IsGoldenFrame(record)) {
+            expected.push_back(&record);
+            goldenEndUs = record.timestampUs;
+        }
+    }
+    // The golden run may have stopped earlier than this one; only its time window is judged
+    for(const TraceRecord& record : output) {
+        if(IsGoldenFrame(record) && record.timestampUs <= goldenEndUs + options.timeToleranceUs) {
+            actual.push_back(&record);
+        }
+    }
+
+    report.compared = true;
+    report.checked = 0;
+    report.mismatches = 0;
+    report.firstMismatch = -1;
+
+    const size_t common = (actual.size() < expected.size()) ? actual.size() : expected.size();
+    for(size_t i = 0; i < common; i++) {
+        const TraceRecord& a = *actual[i];
+        const TraceRecord& e = *expected[i];
+        const uint64_t drift = (a.timestampUs > e.timestampUs) ? a.timestampUs - e.timestampUs
+                                                               : e.timestampUs - a.timestampUs;
+        const bool same = a.bus == e.bus && a.id == e.id && a.len == e.len
+            && memcmp(a.data, e.data, a.len) == 0 && drift <= options.timeToleranceUs;
+        report.checked++;
+        if(!same) {
+            report.mismatches++;
+            if(report.firstMismatch < 0) {
+                report.firstMismatch = static_cast<int64_t>(i);
+            }
+        }
+    }
+
+    // Missing or extra frames count as mismatches too
+    const size_t longest = (actual.size() > expected.size()) ? actual.size() : expected.size();
+    if(longest > common) {
+        report.mismatches += longest - common;
+        if(report.firstMismatch < 0) {
+            report.firstMismatch = static_cast<int64_t>(common);
+        }
+    }
+}
@@ -0,0 +1,188 @@
+#include "SimHal.h"
+
+uint32_t SimClock::millis() {
+    return static_cast<uint32_t>(nowUs / 1000);
+}
+
+uint32_t SimClock::micros() {
+    return static_cast<uint32_t>(nowUs);
+}
+
+void SimClock::advance(uint64_t us) {
+    nowUs += us;
+}
+
+void SimClock::set(uint64_t us) {
+    nowUs = us;
+}
+
+uint64_t SimClock::now() const {
+    return nowUs;
+}
+
+void SimGpio::pinMode(uint8_t pin, uint8_t mode) {
+    if(pin < PIN_COUNT) {
+        modes[pin] = mode;
+    }
+}
+
+void SimGpio::digitalWrite(uint8_t pin, uint8_t value) {
+    if(pin < PIN_COUNT) {
+        levels[pin] = value;
+    }
+}
+
+uint8_t SimGpio::level(uint8_t pin) const {
+    return (pin < PIN_COUNT) ? levels[pin] : GPIO_LOW;
+}
+
+SimCanBus::SimCanBus(SimClock& clockIn, size_t rxSize) : clock(clockIn), rxCapacity(rxSize) {}
+
+void SimCanBus::deliverDue() {
+    while(!inFlight.empty() && inFlight.top().deliverUs <= clock.now()) {
+        if(!accepted(inFlight.top().msg)) {
+            rejected++;
+        } else if(rxQueue.size() < rxCapacity) {
+            rxQueue.push_back(inFlight.top().msg);
+        } else {
+            rxDrops++; // Same as a full FlexCAN RX ring: the new frame is lost
+        }
+        inFlight.pop();
+    }
+}
+
+bool SimCanBus::accepted(const CAN_message_t& msg) const {
+    if(filters == nullptr) {
+        return true;
+    }
+    if(msg.flags.extended) {
+        return false; // Filters are standard-ID only
+    }
+    for(uint8_t i = 0; i < filterCount; i++) {
+        if(FilterAccepts(filters[i], msg.id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SimCanBus::transmit(const SimTxFrame& frame) {
+    txLog.push_back(frame);
+    if(txListener) {
+        txListener(frame);
+    }
+}
+
+void SimCanBus::transmitDue() {
+    while(!txQueue.empty() && txQueue.front().timeUs <= clock.now()) {
+        transmit(txQueue.front());
+        txQueue.pop_front();
+    }
+}
+
+bool SimCanBus::read(CAN_message_t& msg) {
+    deliverDue();
+    transmitDue();
+    if(rxQueue.empty()) {
+        return false;
+    }
+    msg = rxQueue.front();
+    rxQueue.pop_front();
+    return true;
+}
+
+bool SimCanBus::write(const CAN_message_t& msg) {
+    if(txCapacity == 0) {
+        transmit({clock.now(), msg});
+        return true;
+    }
+    transmitDue();
+    if(txQueue.size() >= txCapacity) {
+        return false; // Same as a full FlexCAN TX ring
+    }
+    txFreeUs = ((txFreeUs > clock.now()) ? txFreeUs : clock.now()) + txFrameUs;
+    txQueue.push_back({txFreeUs, msg});
+    return true;
+}
+
+void SimCanBus::inject(const CAN_message_t& msg) {
+    inject(msg, clock.now());
+}
+
+void SimCanBus::inject(const CAN_message_t& msg, uint64_t atUs) {
+    inFlight.push({atUs, injected++, msg});
+}
+
+void SimCanBus::onTransmit(std::function<void(const SimTxFrame&)> listener) {
+    txListener = listener;
+}
+
+void SimCanBus::setAcceptance(const AcceptanceFilter* filterTable, uint8_t count) {
+    filters = filterTable;
+    filterCount = count;
+}
+
+void SimCanBus::deliver() {
+    deliverDue();
+}
+
+void SimCanBus::setTxQueue(size_t depth, uint32_t frameUs) {
+    txCapacity = depth;
+    txFrameUs = frameUs;
+}
+
+const std::vector<SimTxFrame>& SimCanBus::transmitted() const {
+    return txLog;
+}
+
+void SimCanBus::clearTransmitted() {
+    txLog.clear();
+}
+
+size_t SimCanBus::pending() const {
+    return inFlight.size() + rxQueue.size();
+}
+
+uint32_t SimCanBus::rxDropped() const {
+    return rxDrops;
+}
+
+uint32_t SimCanBus::filtered() const {
+    return rejected;
+}
+
+SimCanFdBus::SimCanFdBus(SimClock& clockIn, size_t rxSize) : clock(clockIn), rxCapacity(rxSize) {}
+
+bool SimCanFdBus::read(CANFD_message_t& msg) {
+    while(!inFlight.empty() && inFlight.top().deliverUs <= clock.now()) {
+        if(rxQueue.size() < rxCapacity) {
+            rxQueue.push_back(inFlight.top().msg);
+        } else {
+            rxDrops++;
+        }
+        inFlight.pop();
+    }
+    if(rxQueue.empty()) {
+        return false;
+    }
+    msg = rxQueue.front();
+    rxQueue.pop_front();
+    return true;
+}
+
+bool SimCanFdBus::write(const CANFD_message_t&) {
+    writes++;
+    return true;
+}
+
+void SimCanFdBus::inject(const CANFD_message_t& msg, uint64_t atUs) {
+    inFlight.push({atUs, injected++, msg});
+}
+
+uint32_t SimCanFdBus::rxDropped() const {
+    return rxDrops;
+}
+
+uint32_t SimCanFdBus::written() const {
+    return writes;
+}
@@ -0,0 +1,196 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BlockLogger.h"
+#include "TraceFile.h"
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const char* path) {
+    close();
+    file = fopen(path, "wb");
+    if(file == nullptr) {
+        return false;
+    }
+    const TraceHeader header = MakeTraceHeader();
+    fwrite(&header, sizeof(header), 1, file);
+    count = 0;
+    return true;
+}
+
+void TraceWriter::close() {
+    if(file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void TraceWriter::onFrame(const TraceRecord& record) {
+    if(file != nullptr) {
+        fwrite(&record, sizeof(record), 1, file);
+        count++;
+    }
+}
+
+uint32_t TraceWriter::records() const {
+    return count;
+}
+
+// Parses "(sec.usec)" into microseconds
+static bool parseTimestamp(const char* text, uint64_t& us) {
+    unsigned long long seconds = 0;
+    char fraction[16] = {0};
+    if(sscanf(text, "(%llu.%15[0-9])", &seconds, fraction) != 2) {
+        return false;
+    }
+    // Right-pad the fraction to 6 digits so "(1.5)" reads as 1.500000 s
+    const size_t digits = strlen(fraction);
+    uint64_t micro = 0;
+    for(size_t i = 0; i < 6; i++) {
+        micro = micro * 10 + ((i < digits) ? (fraction[i] - '0') : 0);
+    }
+    us = seconds * 1000000ULL + micro;
+    return true;
+}
+
+// One candump line -> record (bus and timestamp filled in by the caller)
+static bool parseCandumpFrame(char* line, const char* comsInterface, const char* motorInterface,
+                              uint64_t& timestampUs, TraceRecord& record) {
+    char* save = nullptr;
+    const char* stamp = strtok_r(line, " \t\r\n", &save);
+    const char* iface = strtok_r(nullptr, " \t\r\n", &save);
+    char* frame = strtok_r(nullptr, " \t\r\n", &save);
+    if(stamp == nullptr || iface == nullptr || frame == nullptr || !parseTimestamp(stamp, timestampUs)) {
+        return false;
+    }
+
+    if(strcmp(iface, comsInterface) == 0) {
+        record.bus = TRACE_BUS_COMS;
+    } else if(strcmp(iface, motorInterface) == 0) {
+        record.bus = TRACE_BUS_MOTOR;
+    } else {
+        return false;
+    }
+
+    CAN_message_t msg;
+    msg.len = 0;
+    char* hash = strchr(frame, '#');
+    if(hash != nullptr) {
+        // candump -l: 123#DEADBEEF (8 hex digit IDs are extended)
+        *hash = '\0';
+        msg.id = strtoul(frame, nullptr, 16);
+        msg.flags.extended = strlen(frame) > 3;
+        const char* data = hash + 1;
+        if(*data == 'R') {
+            return false; // Remote frames carry nothing the ECU uses
+        }
+        while(msg.len < 8 && isxdigit(data[0]) && isxdigit(data[1])) {
+            char byte[3] = {data[0], data[1], '\0'};
+            msg.buf[msg.len++] = strtoul(byte, nullptr, 16);
+            data += 2;
+        }
+    } else {
+        // candump -ta: 123   [4]  DE AD BE EF
+        msg.id = strtoul(frame, nullptr, 16);
+        msg.flags.extended = strlen(frame) > 3;
+        const char* lenToken = strtok_r(nullptr, " \t\r\n", &save);
+        unsigned len = 0;
+        if(lenToken == nullptr || sscanf(lenToken, "[%u]", &len) != 1) {
+            return false;
+        }
+        const char* byte = nullptr;
+        while(msg.len < len && msg.len < 8 && (byte = strtok_r(nullptr, " \t\r\n", &save)) != nullptr) {
+            msg.buf[msg.len++] = strtoul(byte, nullptr, 16);
+        }
+    }
+
+    const uint8_t bus = record.bus;
+    record = MakeTraceRecord(bus, false, 0, msg);
+    return true;
+}
+
+// Appends device records with u32 timestamps unwrapped (they wrap every ~71 minutes) and rebased to 0
+class RebasingAppender {
+    private:
+        std::vector<TraceRecord>& records;
+        uint64_t wraps = 0;
+        uint32_t previous = 0;
+        uint64_t first = 0;
+
+    public:
+        explicit RebasingAppender(std::vector<TraceRecord>& out) : records(out) {}
+
+        void append(TraceRecord record) {
+            if(!records.empty() && record.timestampUs < previous) {
+                wraps += 1ULL << 32;
+            }
+            previous = record.timestampUs;
+            const uint64_t absolute = wraps + record.timestampUs;
+            if(records.empty()) {
+                first = absolute;
+            }
+            record.timestampUs = static_cast<uint32_t>(absolute - first);
+            records.push_back(record);
+        }
+};
+
+bool LoadTrace(const char* path, std::vector<TraceRecord>& records,
+               const char* comsInterface, const char* motorInterface) {
+    FILE* file = fopen(path, "rb");
+    if(file == nullptr) {
+        return false;
+    }
+    records.clear();
+
+    TraceHeader header;
+    if(fread(&header, sizeof(header), 1, file) == 1 && IsTraceHeader(header)) {
+        RebasingAppender appender(records);
+        TraceRecord record;
+        while(fread(&record, sizeof(record), 1, file) == 1) {
+            appender.append(record);
+        }
+        fclose(file);
+        return true;
+    }
+
+    // SD card log: sectors in sequence until the first one that was never written (preallocated zeros)
+    rewind(file);
+    LogSector sector;
+    if(fread(&sector, sizeof(sector), 1, file) == 1 && sector.header.magic == LOG_SECTOR_MAGIC) {
+        RebasingAppender appender(records);
+        uint32_t expected = 0;
+        do {
+            if(sector.header.magic != LOG_SECTOR_MAGIC || sector.header.sequence != expected) {
+                break;
+            }
+            const uint32_t count = (sector.header.records < LOG_RECORDS_PER_SECTOR) ? sector.header.records
+                                                                                    : LOG_RECORDS_PER_SECTOR;
+            for(uint32_t i = 0; i < count; i++) {
+                appender.append(sector.records[i]);
+            }
+            expected++;
+        } while(fread(&sector, sizeof(sector), 1, file) == 1);
+        fclose(file);
+        return true;
+    }
+
+    rewind(file);
+    char line[256];
+    uint64_t first = 0;
+    while(fgets(line, sizeof(line), file) != nullptr) {
+        TraceRecord record;
+        uint64_t timestampUs = 0;
+        if(!parseCandumpFrame(line, comsInterface, motorInterface, timestampUs, record)) {
+            continue;
+        }
+        if(records.empty()) {
+            first = timestampUs;
+        }
+        record.timestampUs = static_cast<uint32_t>(timestampUs - first);
+        records.push_back(record);
+    }
+    fclose(file);
+    return true;
+}
@@ -0,0 +1,1505 @@
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+#include "BinaryLog.h"
+#include "BlackBox.h"
+#include "BlockLogger.h"
+#include "BusAnalyzer.h"
+#include "CanTiming.h"
+#include "ECU.h"
+#include "EcuFixture.h"
+#include "FileBlockStorage.h"
+#include "Replay.h"
+#include "SimHal.h"
+#include "TraceFile.h"
+
+#ifndef PIO_UNIT_TESTING
+
+// HOST ENTRY POINT ([env:native])
+//   program [sim] [seconds] [--record out.trace] [--tx-depth n] [--drop id [--drop-at s]]
+//               [--sd-log out.bin] [--black-box out.trace] [--promiscuous]
+//       Scripted drive on simulated buses: boot diagnostics, a start with the brake held, then a
+//       pedal sweep with rear wheel spin near full pedal. Reports how much faster than real time
+//       the run was and what traction control did. --tx-depth gives both simulated controllers an
+//       n-frame TX queue drained at the 250 kbit/s frame time, with a fault storm at 5 s, and
+//       reports the per-class TX counters.
+//       --drop silences one CAN ID (e.g. 0x0B1) from --drop-at seconds on (default 8) to exercise
+//       the heartbeat policies; the liveness line shows what the ECU made of it. --sd-log also
+//       runs the on-board logger into a file (replayable like a trace). --black-box writes the
+//       black box snapshot (frozen by a fault, e.g. with --drop 0x00B) as a trace. Both simulated
+//       controllers use the ECU's acceptance filters like the car unless --promiscuous is given.
+//       Built with -D ECU_PROFILING it also prints the loop probes (ns per ECU::run() pass etc.).
+//   program replay <trace> [--golden golden.trace] [--record out.trace] [--realtime]
+//                          [--coms can0] [--motor can1]
+//       Replays a recorded ECUTRACE or candump log through the ECU and reports frames/s. With
+//       --golden, exits non-zero if torque or fault frames differ from the golden run.
+//   program logbench [seconds] [--out file] [--load x] [--sector-us n] [--stall-ms n] [--stall-every n]
+//       Pushes synthetic frames at x times a saturated 250 kbit/s bus on both buses (default 2)
+//       through the on-board logger into a file whose "card" takes sector-us per sector and stalls
+//       for stall-ms every stall-every sectors. Reads the file back and exits non-zero if any frame
+//       was dropped or lost.
+//   program boxbench [frames]
+//       Times BlackBox::onFrame() and BlockLogger::onFrame() per frame on this host.
+//   program fdsim [seconds] [--rate hz] [--batch n]
+//       Throttle and brake sampled at each rate (default a 100/250/500/1000 Hz sweep), sent either
+//       as one classic frame per sample on the 250 kbit/s comsCAN or as CAN FD batches of n samples
+//       per sensor (default 3) on CAN3 at 500 kbit/s / 2 Mbit/s. Wire time uses worst-case bit
+//       stuffing and each sender queues at most 16 frames. Reports sensor frames/s, bus load, lost
+//       samples and the time from a pedal step being sampled to the torque command changing.
+//   program busbench [seconds] [--frames n]
+//       Loads the simulated comsCAN with random frames (standard and extended IDs, 0-8 bytes) at
+//       10/30/50/80/95 % of 250 kbit/s plus one 10 ms periodic ID, runs the ECU on it and compares
+//       the bus analyzer's load with the exact wire time of every frame (the ECU's own TX included)
+//       and with the worst-case stuffing estimate. Exits non-zero if the analyzer is off by more than
+//       0.5 points or miscounts a frame. Then times BusAnalyzer::record() over n frames.
+//   program filterbench [seconds] [--load x]
+//       Drives the ECU with its normal sensor traffic while both buses also carry unrouted IDs at
+//       x (default 0.8) of 250 kbit/s, once accepting every ID and once with the acceptance filters
+//       built from the route table. Reports the frames that reached the ECU and the host time per
+//       run() pass, and exits non-zero if the torque commands differ between the two runs.
+//   program torquebench [samples]
+//       Times the old per-sample pedal path (map() straight to torque) against Throttle::mapPedal(),
+//       the curve lookup alone and behind mapPedal(), plus the full 2D lookup and the curve rebuild
+//       a motor speed change costs.
+//   program streambench [samples]
+//       Times each StreamFilter mode and window per sample on noise.
+//   program tractionbench [samples]
+//       Runs TractionControl through synthetic wheel-spin traces (steady grip, a launch spin, an
+//       oscillating spin, wheel frames stopping mid-spin, frames processed 60 ms after arrival) and
+//       reports the interventions, deepest cut, frame-to-cut latency and recovery. Then times the
+//       wheel frame, controller step and torque command per call.
+//   program imubench [samples] [--trace file]
+//       Times one ImuFusion step per gyro frame over the synthetic drive the tests use. With --trace,
+//       fuses the IMU and wheel frames of a recorded drive instead and reports its yaw rate against
+//       the front axle's.
+//   program routebench [frames] [--unrouted percent]
+//       Times the baseline switch() router against the dispatch tables per frame over one stream of
+//       routed IDs in random order plus percent (default 20) unrouted IDs. Exits non-zero if the two
+//       handle different frames.
+// The pass/fail checks of the control blocks and of the ECU on the sim buses are Unity tests in
+// test/ (pio test -e native); the test runner brings its own main(), so none of this is built there.
+
+constexpr int32_t PEDAL_SPIN = 920; // Rear wheels spin up above this pedal reading
+constexpr int32_t WHEEL_SPIN_PERCENT = 130; // Rear speed relative to front while spinning
+constexpr uint64_t FAULT_STORM_US = 5000000; // --tx-depth only
+constexpr uint8_t FAULT_STORM_FRAMES = 24;
+constexpr int FAULT_STORM_CODE = 1;
+constexpr int32_t GEAR_RATIO_X2 = 7; // Motor rpm = rear wheel rpm * 3.5
+constexpr uint32_t SIM_SD_LOG_SECTORS = 1u << 18; // 128 MiB, sparse on the host
+
+constexpr uint32_t SIM_BLACK_BOX_RECORDS = 8192; // Same as the car
+constexpr uint32_t SIM_BLACK_BOX_TAIL_US = 1000000;
+
+static BlockLogger sdLog; // 64 KiB of buffers: static like on the car
+static TraceRecord blackBoxRecords[SIM_BLACK_BOX_RECORDS];
+
+// Triangle pedal sweep with a 4 s period
+static int32_t pedalAt(uint64_t us) {
+    const uint64_t phase = us % 4000000;
+    const uint64_t half = (phase < 2000000) ? phase : 4000000 - phase;
+    return PEDAL_MIN + static_cast<int32_t>(half * (PEDAL_MAX - PEDAL_MIN) / 2000000);
+}
+
+// Value of "--name value" in argv, or fallback
+static const char* option(int argc, char** argv, const char* name, const char* fallback) {
+    for(int i = 0; i < argc - 1; i++) {
+        if(strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return fallback;
+}
+
+static bool flag(int argc, char** argv, const char* name) {
+    for(int i = 0; i < argc; i++) {
+        if(strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int runSim(int argc, char** argv) {
+    const double seconds = (argc > 0 && argv[0][0] != '-') ? atof(argv[0]) : 10.0;
+    const uint64_t durationUs = static_cast<uint64_t>(seconds * 1e6);
+    const char* recordPath = option(argc, argv, "--record", nullptr);
+    const int txDepth = atoi(option(argc, argv, "--tx-depth", "0"));
+    const uint32_t dropId = strtoul(option(argc, argv, "--drop", "0xFFFFFFFF"), nullptr, 0);
+    const uint64_t dropUs = static_cast<uint64_t>(atof(option(argc, argv, "--drop-at", "8")) * 1e6);
+    const char* sdLogPath = option(argc, argv, "--sd-log", nullptr);
+    const char* blackBoxPath = option(argc, argv, "--black-box", nullptr);
+
+    EcuFixture sim;
+    SimClock& clock = sim.clock;
+    SimCanBus& comsSim = sim.comsSim;
+    SimCanBus& motorSim = sim.motorSim;
+    ECU& ecu = sim.ecu;
+    const bool promiscuous = flag(argc, argv, "--promiscuous");
+    sim.setFiltered(!promiscuous);
+    if(txDepth > 0) {
+        comsSim.setTxQueue(txDepth, TX_FRAME_TIME_US);
+        motorSim.setTxQueue(txDepth, TX_FRAME_TIME_US);
+    }
+    TraceWriter recorder;
+    if(recordPath != nullptr && !recorder.open(recordPath)) {
+        fprintf(stderr, "cannot write %s\n", recordPath);
+        return 1;
+    }
+    FileBlockStorage sdFile;
+    if(sdLogPath != nullptr) {
+        if(!sdFile.open(sdLogPath, SIM_SD_LOG_SECTORS)) {
+            fprintf(stderr, "cannot write %s\n", sdLogPath);
+            return 1;
+        }
+        sdLog.attach(sdFile);
+    }
+    BlackBox blackBox(blackBoxRecords, SIM_BLACK_BOX_RECORDS, SIM_BLACK_BOX_TAIL_US);
+    FrameTapPair onboard((sdLogPath != nullptr) ? &sdLog : nullptr, (blackBoxPath != nullptr) ? &blackBox : nullptr);
+    FrameTapPair taps(&recorder, &onboard);
+    TappedCanBus comsBus(comsSim, TRACE_BUS_COMS, clock, taps);
+    TappedCanBus motorBus(motorSim, TRACE_BUS_MOTOR, clock, taps);
+    if(sdLogPath != nullptr || blackBoxPath != nullptr) {
+        ecu.setLogTap(&onboard);
+        if(!promiscuous) {
+            printf("acceptance filters on: the SD log and black box hold routed IDs only (--promiscuous for the whole bus)\n");
+        }
+    }
+    if(blackBoxPath != nullptr) {
+        ecu.setBlackBox(&blackBox);
+    }
+
+    // Everything a node would send, unless --drop has silenced its ID
+    auto feed = [&](SimCanBus& bus, const CAN_message_t& msg, uint64_t atUs) {
+        if(msg.id != dropId || atUs < dropUs) {
+            bus.inject(msg, atUs);
+        }
+    };
+    sim.setComsFeed([&](const CAN_message_t& msg, uint64_t atUs) { feed(comsSim, msg, atUs); });
+    sim.boot(comsBus, motorBus);
+    sim.setStartSwitch(START_SWITCH_US);
+    for(uint64_t t = 0; t < durationUs; t += SENSOR_PERIOD_US) {
+        const int32_t brake = (t < BRAKE_RELEASE_US) ? BRAKE_HELD : BRAKE_RELEASED;
+        const int32_t pedal = (t < BRAKE_RELEASE_US) ? PEDAL_MIN : pedalAt(t - BRAKE_RELEASE_US);
+        feed(comsSim, makeFrame(ReservedIDs::BrakePressureId, brake), t);
+        feed(comsSim, makeFrame(ReservedIDs::Throttle1PositionId, pedal), t + 100);
+        feed(comsSim, makeFrame(ReservedIDs::Throttle2PositionId, pedal), t + 200);
+
+        // Road speed follows the pedal, the rear axle breaks loose near full pedal
+        const int16_t front = static_cast<int16_t>(200 + pedal / 2);
+        const int16_t rear = (pedal > PEDAL_SPIN) ? static_cast<int16_t>(front * WHEEL_SPIN_PERCENT / 100) : front;
+        feed(comsSim, makeWheelFrame(EcuIDs::FrontWheelSpeedId, front, front), t + 300);
+        feed(comsSim, makeWheelFrame(EcuIDs::RearWheelSpeedId, rear, rear), t + 400);
+        feed(comsSim, makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + 500);
+        feed(comsSim, makeImuFrame(EcuIDs::ImuGyroId, 0, 0, GYRO_Z_BIAS), t + 600);
+        const int16_t motor = static_cast<int16_t>(rear * GEAR_RATIO_X2 / 2);
+        feed(motorSim, makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, motor), t + 700);
+    }
+
+    uint32_t torqueFrames = 0;
+    uint32_t peakTorque = 0;
+    motorSim.onTransmit([&](const SimTxFrame& frame) {
+        if(frame.msg.id == ReservedIDs::ControlCommandId) {
+            const uint32_t torque = frame.msg.buf[0] + frame.msg.buf[1] * 256;
+            torqueFrames++;
+            peakTorque = (torque > peakTorque) ? torque : peakTorque;
+        }
+    });
+
+    uint64_t passes = 0;
+    const auto wallStart = std::chrono::steady_clock::now();
+    while(clock.now() < durationUs) {
+        clock.advance(LOOP_PERIOD_US);
+        if(txDepth > 0 && clock.now() == FAULT_STORM_US) {
+            for(uint8_t i = 0; i < FAULT_STORM_FRAMES; i++) {
+                ecu.throwError(FAULT_STORM_CODE); // More faults than the TX queue holds
+            }
+        }
+        ecu.run();
+        sdLog.service();
+        passes++;
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    sdLog.flush();
+    while(sdLog.service()) {
+    }
+    sim.finish();
+    printf("simulated %.2f s (%llu passes) in %.3f s wall -> %.0fx real time\n", seconds,
+           static_cast<unsigned long long>(passes), wall, seconds / wall);
+    printf("torque frames: %u  peak torque: %u  coms drops: %u\n", torqueFrames, peakTorque,
+           comsSim.rxDropped());
+    if(txDepth > 0) {
+        static const char* const CLASS_NAMES[TX_CLASS_COUNT] = {"control", "safety", "status", "diagnostic"};
+        for(uint8_t c = 0; c < TX_CLASS_COUNT; c++) {
+            const TxClassStats& coms = ecu.getComsTxStats(static_cast<TxClass>(c));
+            const TxClassStats& motor = ecu.getMotorTxStats(static_cast<TxClass>(c));
+            printf("tx %-10s coms sent %u dropped %u max delay %u us | motor sent %u coalesced %u max delay %u us\n",
+                   CLASS_NAMES[c], coms.sent, coms.dropped, coms.maxDelayUs, motor.sent, motor.coalesced,
+                   motor.maxDelayUs);
+        }
+    }
+    const TractionStats& traction = ecu.getTractionControl().getStats();
+    printf("traction control: %u interventions, %.3f s cutting torque, last peak slip %.1f%%\n",
+           traction.interventions, traction.totalInterventionUs / 1e6, traction.peakSlip * 100.0 / SLIP_ONE);
+    printf("imu fusion: heading %.2f deg (raw gyro would drift %.2f deg), slip angle %.2f deg\n",
+           ecu.getImuEstimate().heading * 57.2958f, GYRO_Z_BIAS * 0.01 * seconds,
+           ecu.getImuEstimate().slipAngle * 57.2958f);
+    const FaultManager& faults = ecu.getFaultManager();
+    printf("faults: active 0x%04x latched 0x%04x, %u raised\n", faults.getActiveMask(), faults.getLatchedMask(),
+           faults.getOccurrences());
+    printf("liveness: alive 0x%04x lost since boot 0x%04x, %s%s\n", ecu.getHeartbeat().getAliveMask(),
+           ecu.getHeartbeat().getLostMask(), ecu.isDriving() ? "driving" : "stopped",
+           ecu.isLimping() ? " (limp)" : "");
+#ifdef ECU_PROFILING
+    static const char* const PROBE_NAMES[PROBE_COUNT] = {"run", "route", "updateThrottle", "sendMotorCommand",
+                                                         "traction", "imuFusion"};
+    for(uint8_t p = 0; p < PROBE_COUNT; p++) {
+        const ProbeStats& probe = Profiler::getStats(static_cast<ProbeId>(p));
+        if(probe.count > 0) {
+            printf("probe %-16s %9u calls  min %5u  mean %7.1f  max %7u ns\n", PROBE_NAMES[p], probe.count, probe.min,
+                   static_cast<double>(probe.total) / probe.count, probe.max);
+        }
+    }
+#endif
+    if(recordPath != nullptr) {
+        printf("recorded %u frames to %s\n", recorder.records(), recordPath);
+    }
+    if(sdLogPath != nullptr) {
+        const BlockLogStats& log = sdLog.getStats();
+        printf("sd log: %u frames in %u sectors to %s, %u dropped\n", log.frames, log.sectorsWritten, sdLogPath,
+               log.dropped);
+    }
+    if(blackBoxPath != nullptr) {
+        TraceWriter boxWriter;
+        if(!boxWriter.open(blackBoxPath)) {
+            fprintf(stderr, "cannot write %s\n", blackBoxPath);
+            return 1;
+        }
+        for(uint32_t i = 0; i < blackBox.size(); i++) {
+            boxWriter.onFrame(blackBox.at(i));
+        }
+        static const char* const BOX_STATES[] = {"recording", "triggered", "frozen"};
+        const bool triggered = blackBox.getState() != BlackBoxState::Recording;
+        printf("black box: %s (reason %u), %u records to %s", BOX_STATES[static_cast<uint8_t>(blackBox.getState())],
+               blackBox.getReason(), blackBox.size(), blackBoxPath);
+        if(triggered && blackBox.size() > 0) {
+            const uint32_t first = blackBox.at(0).timestampUs;
+            const uint32_t last = blackBox.at(blackBox.size() - 1).timestampUs;
+            const uint32_t at = (blackBox.triggerIndex() < blackBox.size())
+                                    ? blackBox.at(blackBox.triggerIndex()).timestampUs : last;
+            printf(", %.3f s before and %.3f s after the trigger", (at - first) / 1e6, (last - at) / 1e6);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+constexpr uint32_t FDSIM_CLASSIC_BITRATE = 250000;
+constexpr uint32_t FDSIM_NOMINAL_BITRATE = 500000;
+constexpr uint32_t FDSIM_DATA_BITRATE = 2000000;
+constexpr uint32_t FDSIM_SENDER_QUEUE = 16; // Frames a sensor node can hold back before it drops
+constexpr uint64_t FDSIM_BACKGROUND_US = 10000; // Wheel speed, IMU and motor position at 100 Hz
+constexpr uint64_t FDSIM_STEP_US = 100000; // Pedal alternates between two levels after the brake release
+constexpr int32_t FDSIM_PEDAL_LOW = 300;
+constexpr int32_t FDSIM_PEDAL_HIGH = 700;
+
+// One sender's view of a bus: frames go out back to back, worst-case length each
+class SimWire {
+    private:
+        uint64_t freeNs = 0;
+        uint64_t busyNs = 0;
+        uint32_t drops = 0;
+
+    public:
+        // -> Arrival time in us, or 0 if the sender's queue was full and the frame is lost
+        uint64_t send(uint64_t readyUs, uint32_t frameNs) {
+            const uint64_t readyNs = readyUs * 1000;
+            const uint64_t startNs = (freeNs > readyNs) ? freeNs : readyNs;
+            if(startNs - readyNs > static_cast<uint64_t>(FDSIM_SENDER_QUEUE) * frameNs) {
+                drops++;
+                return 0;
+            }
+            freeNs = startNs + frameNs;
+            busyNs += frameNs;
+            return (freeNs + 999) / 1000;
+        }
+
+        double load(uint64_t durationUs) const { // -> Busy fraction (frames still queued at the end count)
+            const double load = static_cast<double>(busyNs) / (durationUs * 1000.0);
+            return (load < 1.0) ? load : 1.0;
+        }
+
+        uint32_t dropped() const {
+            return drops;
+        }
+};
+
+struct SensorPathResult {
+    double framesPerSecond = 0.0; // Frames carrying throttle/brake samples
+    double samplesPerSecond = 0.0; // Samples the ECU routed
+    double sensorLoad = 0.0; // Bus the samples travel on
+    double comsLoad = 0.0;
+    uint32_t lostSamples = 0;
+    uint32_t steps = 0;
+    double responseMeanUs = 0.0; // Step sampled -> first changed torque command
+    double responseMaxUs = 0.0;
+    double settleMeanUs = 0.0; // Step sampled -> torque command at its new steady value
+};
+
+// Pedal position the sensors read at t (steps start one step after the brake release, so the
+// brake filter has let go and the brake/throttle override never trips)
+static int32_t steppedPedalAt(uint64_t us) {
+    if(us < BRAKE_RELEASE_US + FDSIM_STEP_US) {
+        return PEDAL_MIN;
+    }
+    return (((us - BRAKE_RELEASE_US) / FDSIM_STEP_US) % 2 == 1) ? FDSIM_PEDAL_LOW : FDSIM_PEDAL_HIGH;
+}
+
+static SensorPathResult simulateSensorPath(bool fd, uint32_t rateHz, uint8_t batchPerSensor, uint64_t durationUs) {
+    static const uint16_t SENSOR_IDS[] = {ReservedIDs::Throttle1PositionId, ReservedIDs::Throttle2PositionId,
+                                          ReservedIDs::BrakePressureId};
+    constexpr uint8_t SENSORS = sizeof(SENSOR_IDS) / sizeof(SENSOR_IDS[0]);
+    const uint64_t periodUs = 1000000 / rateHz;
+
+    EcuFixture sim;
+    SimCanBus& comsSim = sim.comsSim;
+    SimCanFdBus sensorSim(sim.clock);
+    if(fd) {
+        sim.ecu.setSensorCAN(sensorSim);
+    }
+    sim.boot();
+
+    std::vector<SimTxFrame> torque;
+    sim.motorSim.onTransmit([&](const SimTxFrame& frame) {
+        // Same ID as the keep-alive ping, which goes out with the enable bit clear
+        if(frame.msg.id == ReservedIDs::ControlCommandId && InverterCommandMsg::decode(frame.msg.buf).enable != 0) {
+            torque.push_back(frame);
+        }
+    });
+    sim.setStartSwitch(START_SWITCH_US);
+
+    SimWire comsWire;
+    SimWire sensorWire;
+    const uint32_t classicNs = ClassicFrameNs(CAN_FRAME_LEN, FDSIM_CLASSIC_BITRATE);
+    uint32_t sensorFrames = 0;
+    uint64_t nextBackgroundUs = 0;
+    CANFD_message_t batch;
+    batch.id = EcuIDs::SensorBatchId;
+    uint8_t batchSamples = 0;
+    uint64_t batchTimes[SENSOR_BATCH_MAX_SAMPLES] = {};
+    uint8_t sequence = 0;
+    uint32_t lost = 0;
+
+    for(uint64_t t = 0; t < durationUs; t += periodUs) {
+        const int32_t pedal = steppedPedalAt(t);
+        const int32_t values[SENSORS] = {pedal, pedal, (t < BRAKE_RELEASE_US) ? BRAKE_HELD : BRAKE_RELEASED};
+        for(uint8_t s = 0; s < SENSORS; s++) {
+            if(!fd) {
+                const uint64_t at = comsWire.send(t, classicNs);
+                if(at != 0) {
+                    comsSim.inject(makeFrame(SENSOR_IDS[s], values[s]), at);
+                    sensorFrames++;
+                } else {
+                    lost++;
+                }
+                continue;
+            }
+            batchTimes[batchSamples] = t;
+            SensorSampleMsg{0, SENSOR_IDS[s], static_cast<int16_t>(values[s])}.encode(
+                batch.buf + SensorBatchMsg::LEN + batchSamples * SensorSampleMsg::LEN);
+            batchSamples++;
+        }
+
+        // Batch goes out as soon as its last sample is taken, ages relative to that moment
+        if(fd && batchSamples >= batchPerSensor * SENSORS) {
+            for(uint8_t i = 0; i < batchSamples; i++) {
+                SensorSampleMsg::AgeUs::put(batch.buf + SensorBatchMsg::LEN + i * SensorSampleMsg::LEN,
+                                            static_cast<uint16_t>(t - batchTimes[i]));
+            }
+            SensorBatchMsg{sequence++, batchSamples}.encode(batch.buf);
+            batch.len = FdPayloadLen(SensorBatchMsg::LEN + batchSamples * SensorSampleMsg::LEN);
+            const uint64_t at = sensorWire.send(t, FdFrameNs(batch.len, FDSIM_NOMINAL_BITRATE, FDSIM_DATA_BITRATE));
+            if(at != 0) {
+                sensorSim.inject(batch, at);
+                sensorFrames++;
+            } else {
+                lost += batchSamples;
+            }
+            batchSamples = 0;
+        }
+
+        // Higher IDs than the sensors, so they lose arbitration to samples taken at the same time
+        for(; nextBackgroundUs <= t; nextBackgroundUs += FDSIM_BACKGROUND_US) {
+            const int16_t wheel = 400;
+            const CAN_message_t background[] = {
+                makeWheelFrame(EcuIDs::FrontWheelSpeedId, wheel, wheel),
+                makeWheelFrame(EcuIDs::RearWheelSpeedId, wheel, wheel),
+                makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G),
+                makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0),
+            };
+            for(const CAN_message_t& msg : background) {
+                const uint64_t at = comsWire.send(nextBackgroundUs, classicNs);
+                if(at != 0) {
+                    comsSim.inject(msg, at);
+                }
+            }
+            sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, wheel * GEAR_RATIO_X2 / 2),
+                                nextBackgroundUs);
+        }
+    }
+    sim.runUntil(durationUs);
+    sim.finish();
+
+    SensorPathResult result;
+    const double seconds = durationUs / 1e6;
+    result.framesPerSecond = sensorFrames / seconds;
+    result.samplesPerSecond = (fd ? sim.ecu.getSensorBatchStats().samples : (sensorFrames - comsSim.rxDropped())) / seconds;
+    result.sensorLoad = fd ? sensorWire.load(durationUs) : comsWire.load(durationUs);
+    result.comsLoad = comsWire.load(durationUs);
+    result.lostSamples = lost + comsSim.rxDropped() + sensorSim.rxDropped();
+
+    // Each step is seen by the first sample taken at or after it
+    auto torqueOf = [](const SimTxFrame& frame) {
+        return InverterCommandMsg::decode(frame.msg.buf).torque;
+    };
+    double responseTotal = 0.0;
+    double settleTotal = 0.0;
+    uint32_t settled = 0;
+    for(uint64_t step = BRAKE_RELEASE_US + FDSIM_STEP_US; step + FDSIM_STEP_US < durationUs; step += FDSIM_STEP_US) {
+        const uint64_t sampled = (step + periodUs - 1) / periodUs * periodUs;
+        size_t i = 0;
+        while(i < torque.size() && torque[i].timeUs < sampled) {
+            i++;
+        }
+        if(i == 0 || i == torque.size()) {
+            continue;
+        }
+        const int16_t before = torqueOf(torque[i - 1]);
+        size_t response = i;
+        while(response < torque.size() && torqueOf(torque[response]) == before) {
+            response++;
+        }
+        size_t end = i;
+        while(end < torque.size() && torque[end].timeUs < step + FDSIM_STEP_US) {
+            end++;
+        }
+        if(response >= end) {
+            continue;
+        }
+        const double responseUs = static_cast<double>(torque[response].timeUs - sampled);
+        responseTotal += responseUs;
+        result.responseMaxUs = (responseUs > result.responseMaxUs) ? responseUs : result.responseMaxUs;
+        result.steps++;
+
+        const int16_t steady = torqueOf(torque[end - 1]);
+        size_t settle = response;
+        while(settle < end && torqueOf(torque[settle]) != steady) {
+            settle++;
+        }
+        settleTotal += static_cast<double>(torque[settle].timeUs - sampled);
+        settled++;
+    }
+    result.responseMeanUs = (result.steps > 0) ? responseTotal / result.steps : 0.0;
+    result.settleMeanUs = (settled > 0) ? settleTotal / settled : 0.0;
+    return result;
+}
+
+static int runFdSim(int argc, char** argv) {
+    const double seconds = (argc > 0 && argv[0][0] != '-') ? atof(argv[0]) : 10.0;
+    const uint64_t durationUs = static_cast<uint64_t>(seconds * 1e6);
+    const uint32_t onlyRate = strtoul(option(argc, argv, "--rate", "0"), nullptr, 0);
+    const int batch = atoi(option(argc, argv, "--batch", "3"));
+    if(batch < 1 || batch * 3 > SENSOR_BATCH_MAX_SAMPLES) {
+        fprintf(stderr, "--batch must be 1..%u samples per sensor\n", SENSOR_BATCH_MAX_SAMPLES / 3);
+        return 2;
+    }
+    static const uint32_t SWEEP[] = {100, 250, 500, 1000};
+    const uint32_t* rates = (onlyRate > 0) ? &onlyRate : SWEEP;
+    const size_t rateCount = (onlyRate > 0) ? 1 : sizeof(SWEEP) / sizeof(SWEEP[0]);
+
+    // ECU log lines of each run come first, the comparison table last
+    std::vector<SensorPathResult> results;
+    for(size_t r = 0; r < rateCount; r++) {
+        for(int fd = 0; fd < 2; fd++) {
+            printf("== %u Hz %s\n", rates[r], fd ? "can fd" : "classic");
+            results.push_back(simulateSensorPath(fd != 0, rates[r], batch, durationUs));
+        }
+    }
+    printf("%6s %-8s %9s %9s %7s %7s %6s %18s %10s\n", "rate", "path", "frames/s", "samples/s", "load",
+           "coms", "lost", "response mean/max", "settle");
+    for(size_t r = 0; r < rateCount; r++) {
+        for(int fd = 0; fd < 2; fd++) {
+            const SensorPathResult& result = results[r * 2 + fd];
+            printf("%4u Hz %-8s %9.0f %9.0f %6.1f%% %6.1f%% %6u ", rates[r], fd ? "can fd" : "classic",
+                   result.framesPerSecond, result.samplesPerSecond, result.sensorLoad * 100, result.comsLoad * 100,
+                   result.lostSamples);
+            if(result.steps > 0) {
+                printf("%8.2f/%6.2f ms %7.2f ms\n", result.responseMeanUs / 1000, result.responseMaxUs / 1000,
+                       result.settleMeanUs / 1000);
+            } else {
+                printf("%18s %10s\n", "never drove", "-");
+            }
+        }
+    }
+    return 0;
+}
+
+// Per-frame cost of the capture paths (both are a copy into a static buffer, no branches on the bus)
+static int runBoxBench(int argc, char** argv) {
+    const uint32_t frames = (argc > 0 && argv[0][0] != '-') ? strtoul(argv[0], nullptr, 0) : 20000000;
+    BlackBox blackBox(blackBoxRecords, SIM_BLACK_BOX_RECORDS, SIM_BLACK_BOX_TAIL_US);
+    FileBlockStorage nowhere; // Never opened: the logger fills and drops without touching storage
+    sdLog.attach(nowhere);
+
+    CAN_message_t msg;
+    TraceRecord record = MakeTraceRecord(TRACE_BUS_COMS, false, 0, msg);
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < frames; i++) {
+        record.timestampUs = i;
+        record.id = i & 0x7FF;
+        blackBox.onFrame(record);
+    }
+    const double boxNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    const uint32_t logFrames = 2 * LOG_BUFFER_SECTORS * LOG_RECORDS_PER_SECTOR; // Until both buffers are full
+    start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < logFrames; i++) {
+        record.timestampUs = i;
+        sdLog.onFrame(record);
+    }
+    const double logNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    printf("black box: %u frames, %.1f ns/frame (last id 0x%03x)\n", frames, boxNs / frames,
+           blackBox.at(blackBox.size() - 1).id);
+    printf("sd logger: %u frames, %.1f ns/frame\n", logFrames, logNs / logFrames);
+    return 0;
+}
+
+static int runLogBench(int argc, char** argv) {
+    const double seconds = (argc > 0 && argv[0][0] != '-') ? atof(argv[0]) : 10.0;
+    const uint64_t durationUs = static_cast<uint64_t>(seconds * 1e6);
+    const char* path = option(argc, argv, "--out", "logbench.bin");
+    const double load = atof(option(argc, argv, "--load", "2"));
+    const uint32_t sectorUs = atoi(option(argc, argv, "--sector-us", "60"));
+    const uint32_t stallUs = atoi(option(argc, argv, "--stall-ms", "100")) * 1000;
+    const uint32_t stallEvery = atoi(option(argc, argv, "--stall-every", "1000"));
+
+    // Both buses at load x a back-to-back stream of worst-case frames
+    const double framesPerSecond = load * 2 * 1e6 / TX_FRAME_TIME_US;
+    const double frameIntervalUs = 1e6 / framesPerSecond;
+    const uint32_t sectors = static_cast<uint32_t>(framesPerSecond * seconds / LOG_RECORDS_PER_SECTOR) + 1024;
+
+    SimClock clock;
+    FileBlockStorage storage;
+    if(!storage.open(path, sectors)) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 2;
+    }
+    storage.setTiming(clock, sectorUs, stallUs, stallEvery);
+    sdLog.attach(storage);
+
+    uint32_t sent = 0;
+    uint32_t peakPending = 0;
+    double nextFrameUs = 0.0;
+    CAN_message_t msg;
+    const auto wallStart = std::chrono::steady_clock::now();
+    while(clock.now() < durationUs) {
+        clock.advance(LOOP_PERIOD_US);
+        while(nextFrameUs <= clock.now()) {
+            msg.id = 0x100 + (sent % 64);
+            memcpy(msg.buf, &sent, sizeof(sent));
+            sdLog.onFrame(MakeTraceRecord(sent % 2, false, clock.micros(), msg));
+            sent++;
+            nextFrameUs += frameIntervalUs;
+        }
+        sdLog.service();
+        peakPending = (sdLog.pendingSectorCount() > peakPending) ? sdLog.pendingSectorCount() : peakPending;
+    }
+    sdLog.flush();
+    while(!sdLog.idle()) {
+        clock.advance(LOOP_PERIOD_US);
+        sdLog.service();
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    storage.close();
+
+    const BlockLogStats& log = sdLog.getStats();
+    std::vector<TraceRecord> readBack;
+    LoadTrace(path, readBack);
+    const double megabytes = log.sectorsWritten * LOG_SECTOR_SIZE / 1e6;
+    printf("logbench: %.0f frames/s (%.1fx a saturated bus pair) for %.1f s, card %u us/sector + %u ms stall "
+           "every %u sectors\n", framesPerSecond, load, seconds, sectorUs, stallUs / 1000, stallEvery);
+    printf("  %u frames, %u dropped, %u read back, %u sectors (%.1f MB), peak backlog %u of %u sectors\n", sent,
+           log.dropped, static_cast<uint32_t>(readBack.size()), log.sectorsWritten, megabytes, peakPending,
+           2 * LOG_BUFFER_SECTORS);
+    printf("  needs %.0f kB/s, host wrote %.1f MB/s\n", framesPerSecond * sizeof(TraceRecord) / 1e3,
+           megabytes / wall);
+    return (log.dropped == 0 && readBack.size() == sent) ? 0 : 1;
+}
+
+constexpr uint32_t BUSBENCH_BITRATE = 250000;
+constexpr uint32_t BUSBENCH_PERIODIC_ID = 0x321;
+constexpr uint64_t BUSBENCH_PERIODIC_US = 10000;
+constexpr uint8_t BUSBENCH_STANDARD_IDS = 40;
+constexpr uint8_t BUSBENCH_EXTENDED_IDS = 8;
+constexpr uint16_t BUSBENCH_MAX_ERROR_BP = 50;
+
+// Reference wire length: the frame serialised bit by bit, CRC by long division, stuff bits inserted
+static uint32_t WireBits(const CAN_message_t& msg) {
+    std::vector<uint8_t> bits;
+    auto append = [&bits](uint32_t value, int count) {
+        for(int i = count - 1; i >= 0; i--) {
+            bits.push_back((value >> i) & 1);
+        }
+    };
+    append(0, 1);
+    if(msg.flags.extended) {
+        append(msg.id >> 18, 11);
+        append(1, 1); // SRR
+        append(1, 1); // IDE
+        append(msg.id & 0x3FFFF, 18);
+        append(msg.flags.remote, 1);
+        append(0, 2);
+    } else {
+        append(msg.id, 11);
+        append(msg.flags.remote, 1);
+        append(0, 2); // IDE, r0
+    }
+    append(msg.len, 4);
+    for(uint8_t i = 0; !msg.flags.remote && i < msg.len; i++) {
+        append(msg.buf[i], 8);
+    }
+    std::vector<uint8_t> remainder(bits);
+    remainder.resize(bits.size() + 15, 0);
+    for(size_t i = 0; i < bits.size(); i++) {
+        if(remainder[i]) {
+            for(int j = 0; j < 16; j++) {
+                remainder[i + j] ^= (0xC599 >> (15 - j)) & 1; // x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1
+            }
+        }
+    }
+    bits.insert(bits.end(), remainder.end() - 15, remainder.end());
+
+    std::vector<uint8_t> wire;
+    int run = 0;
+    for(uint8_t bit : bits) {
+        if(!wire.empty() && bit == wire.back()) {
+            run++;
+        } else {
+            run = 1;
+        }
+        wire.push_back(bit);
+        if(run == 5) {
+            wire.push_back(!bit);
+            run = 1;
+        }
+    }
+    return static_cast<uint32_t>(wire.size()) + 13;
+}
+
+struct BusBenchResult {
+    double truthLoad; // Exact wire time of every frame on the bus
+    double analyzerLoad;
+    double worstCaseLoad;
+    uint32_t truthFrames;
+    uint32_t analyzerFrames;
+    uint32_t periodicCount;
+    double periodicMeanUs;
+    double periodicJitterUs;
+    uint32_t periodicMinUs;
+    uint32_t periodicMaxUs;
+};
+
+// Runs the ECU on a comsCAN loaded to targetLoad and reads the analyzer back through its dump frames
+static BusBenchResult simulateBusLoad(double targetLoad, uint64_t durationUs, uint32_t seed) {
+    EcuFixture sim;
+
+    uint64_t truthBits = 0;
+    uint64_t worstBits = 0;
+    uint32_t frames = 0;
+    auto count = [&](const CAN_message_t& msg) {
+        truthBits += WireBits(msg);
+        worstBits += msg.flags.extended ? ClassicExtendedFrameBits(msg.len) : ClassicFrameBits(msg.len);
+        frames++;
+    };
+    std::vector<CAN_message_t> dump;
+    sim.onComsTransmit([&](const SimTxFrame& frame) {
+        count(frame.msg);
+        if(frame.msg.id == EcuIDs::BusStatsDataId) {
+            dump.push_back(frame.msg);
+        }
+    });
+    // The DC health replies are bus traffic too
+    sim.setComsFeed([&](const CAN_message_t& msg, uint64_t atUs) {
+        count(msg);
+        sim.comsSim.inject(msg, atUs);
+    });
+    sim.boot();
+
+    // Random frames spaced for the target load; the periodic ID goes out when due, or right after
+    // the frame on the wire if the bus is busy
+    uint32_t random = seed;
+    uint64_t busFreeNs = 0;
+    uint64_t nextRandomNs = 0;
+    uint64_t nextPeriodicNs = BUSBENCH_PERIODIC_US * 1000;
+    for(;;) {
+        CAN_message_t msg;
+        const bool periodic = nextPeriodicNs <= nextRandomNs;
+        if(periodic) {
+            msg.id = BUSBENCH_PERIODIC_ID;
+            msg.len = 8;
+            memcpy(msg.buf, &nextPeriodicNs, sizeof(nextPeriodicNs));
+        } else {
+            const uint32_t pick = xorshift(random);
+            const uint8_t slot = pick % (BUSBENCH_STANDARD_IDS + BUSBENCH_EXTENDED_IDS);
+            msg.flags.extended = slot >= BUSBENCH_STANDARD_IDS;
+            msg.id = msg.flags.extended ? 0x18FF0000 + slot * 0x111 : 0x100 + slot * 0x25;
+            msg.len = (pick >> 8) % 9;
+            for(uint8_t i = 0; i < msg.len; i++) {
+                msg.buf[i] = xorshift(random) & 0xFF;
+            }
+        }
+        const uint64_t frameNs = static_cast<uint64_t>(WireBits(msg)) * 1000000000 / BUSBENCH_BITRATE;
+        const uint64_t readyNs = periodic ? nextPeriodicNs : nextRandomNs;
+        const uint64_t startNs = (busFreeNs > readyNs) ? busFreeNs : readyNs;
+        if(startNs + frameNs > durationUs * 1000) {
+            break;
+        }
+        busFreeNs = startNs + frameNs;
+        if(periodic) {
+            nextPeriodicNs += BUSBENCH_PERIODIC_US * 1000;
+        } else {
+            nextRandomNs = startNs + static_cast<uint64_t>(frameNs / targetLoad);
+        }
+        sim.comsSim.inject(msg, busFreeNs / 1000);
+        count(msg);
+    }
+    sim.runUntil(durationUs);
+
+    // Dump request at the end of the window (not counted: it is not part of the measured traffic)
+    CAN_message_t request;
+    request.id = EcuIDs::BusStatsRequestId;
+    request.len = 1;
+    sim.ecu.route(request, sim.clock.micros());
+    const uint32_t endFrames = frames;
+    const uint64_t endBits = truthBits;
+    const uint64_t endWorst = worstBits;
+    sim.runUntil(sim.clock.now() + BUS_ANALYZER_DUMP_FRAMES * LOOP_PERIOD_US);
+    sim.finish();
+
+    // Decode the dump like tools/bus_stats.py does
+    BusBenchResult result = {};
+    const double bitsAvailable = static_cast<double>(BUSBENCH_BITRATE) * durationUs / 1e6;
+    result.truthLoad = endBits / bitsAvailable;
+    result.worstCaseLoad = endWorst / bitsAvailable;
+    result.truthFrames = endFrames;
+    int periodicSlot = -1;
+    for(const CAN_message_t& frame : dump) {
+        const uint8_t slot = frame.buf[0];
+        const uint8_t part = frame.buf[1];
+        uint32_t word;
+        memcpy(&word, frame.buf + 2, sizeof(word));
+        const uint16_t half = frame.buf[6] | (frame.buf[7] << 8);
+        if(slot == BUS_ANALYZER_SUMMARY_SLOT) {
+            if(part == TRACE_BUS_COMS * BUS_ANALYZER_BUS_PARTS) {
+                result.analyzerFrames = word;
+            } else if(part == TRACE_BUS_COMS * BUS_ANALYZER_BUS_PARTS + 1) {
+                result.analyzerLoad = (frame.buf[4] | (frame.buf[5] << 8)) / 10000.0;
+            }
+            continue;
+        }
+        if(part == 0 && word == (BUSBENCH_PERIODIC_ID | (static_cast<uint32_t>(TRACE_BUS_COMS) << 30))) {
+            periodicSlot = slot;
+        }
+        if(slot != periodicSlot) {
+            continue;
+        }
+        if(part == 1) {
+            result.periodicCount = word;
+        } else if(part == 2) {
+            result.periodicMeanUs = word;
+            result.periodicJitterUs = half;
+        } else if(part == 3) {
+            result.periodicMinUs = word;
+        } else if(part == 4) {
+            result.periodicMaxUs = word;
+        }
+    }
+    return result;
+}
+
+static int runBusBench(int argc, char** argv) {
+    const double seconds = (argc > 0 && argv[0][0] != '-') ? atof(argv[0]) : 5.0;
+    const uint64_t durationUs = static_cast<uint64_t>(seconds * 1e6);
+    const uint32_t benchFrames = strtoul(option(argc, argv, "--frames", "4000000"), nullptr, 0);
+    static const double LOADS[] = {0.10, 0.30, 0.50, 0.80, 0.95};
+
+    bool pass = true;
+    std::vector<BusBenchResult> results;
+    for(double load : LOADS) {
+        printf("== %.0f %% target\n", load * 100);
+        results.push_back(simulateBusLoad(load, durationUs, 0x2545F491));
+    }
+    printf("%7s %8s %9s %7s %10s %7s %9s %26s\n", "target", "truth", "analyzer", "error", "worst-case", "error",
+           "frames", "periodic mean/jitter/min/max");
+    for(size_t i = 0; i < results.size(); i++) {
+        const BusBenchResult& r = results[i];
+        const double error = (r.analyzerLoad - r.truthLoad) * 100;
+        const double worstError = (r.worstCaseLoad - r.truthLoad) * 100;
+        const bool ok = (error < 0 ? -error : error) * 100 <= BUSBENCH_MAX_ERROR_BP
+                        && r.analyzerFrames == r.truthFrames;
+        pass = pass && ok;
+        printf("%6.0f%% %7.2f%% %8.2f%% %+6.2f %9.2f%% %+6.2f %4u/%-4u %8.0f/%4.0f/%5u/%5u us%s\n",
+               LOADS[i] * 100, r.truthLoad * 100, r.analyzerLoad * 100, error, r.worstCaseLoad * 100, worstError,
+               r.analyzerFrames, r.truthFrames, r.periodicMeanUs, r.periodicJitterUs, r.periodicMinUs,
+               r.periodicMaxUs, ok ? "" : "  FAIL");
+    }
+
+    // Cost of one record() on this host (varied IDs, lengths and data so the stuffing loop does real work)
+    BusAnalyzer analyzer;
+    std::vector<CAN_message_t> frames(1024);
+    uint32_t random = 0x9E3779B9;
+    for(CAN_message_t& msg : frames) {
+        msg.id = 0x100 + xorshift(random) % 40;
+        msg.len = xorshift(random) % 9;
+        for(uint8_t i = 0; i < msg.len; i++) {
+            msg.buf[i] = xorshift(random) & 0xFF;
+        }
+    }
+    uint32_t lengthMismatches = 0;
+    for(size_t i = 0; i < frames.size(); i++) {
+        CAN_message_t msg = frames[i];
+        msg.flags.extended = (i % 4) == 1;
+        msg.flags.remote = (i % 16) == 2;
+        if(msg.flags.extended) {
+            msg.id = xorshift(random) & 0x1FFFFFFF;
+        }
+        lengthMismatches += StuffedFrameBits(msg) != WireBits(msg);
+    }
+    printf("frame lengths: %u of %u differ from the reference serialiser\n", lengthMismatches,
+           static_cast<uint32_t>(frames.size()));
+    pass = pass && lengthMismatches == 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < benchFrames; i++) {
+        analyzer.record(i & 1, frames[i & 1023], i * 250);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("record(): %u frames, %.1f ns/frame (%u IDs tracked)\n", benchFrames, ns / benchFrames, analyzer.size());
+    return pass ? 0 : 1;
+}
+
+struct FilterBenchResult {
+    uint32_t framesRead; // Frames that reached the ECU
+    uint32_t filtered; // Rejected by the (simulated) controller filters
+    uint32_t rxDropped;
+    uint32_t budgetExhausted; // Drain passes that left a frame unread
+    uint64_t passes;
+    double runNs; // Host time inside ECU::run()
+    std::vector<CAN_message_t> torque;
+};
+
+static FilterBenchResult simulateFilteredBus(bool filtered, double foreignLoad, uint64_t durationUs) {
+    EcuFixture sim;
+    SimCanBus& comsSim = sim.comsSim;
+    SimCanBus& motorSim = sim.motorSim;
+    sim.setFiltered(filtered);
+    sim.boot();
+
+    FilterBenchResult result = {};
+    motorSim.onTransmit([&](const SimTxFrame& frame) {
+        if(frame.msg.id == ReservedIDs::ControlCommandId) {
+            result.torque.push_back(frame.msg);
+        }
+    });
+    sim.setStartSwitch(START_SWITCH_US);
+    for(uint64_t t = 0; t < durationUs; t += SENSOR_PERIOD_US) {
+        const int32_t pedal = (t < BRAKE_RELEASE_US) ? PEDAL_MIN : pedalAt(t - BRAKE_RELEASE_US);
+        comsSim.inject(makeFrame(ReservedIDs::BrakePressureId, (t < BRAKE_RELEASE_US) ? BRAKE_HELD : BRAKE_RELEASED), t);
+        comsSim.inject(makeFrame(ReservedIDs::Throttle1PositionId, pedal), t + 100);
+        comsSim.inject(makeFrame(ReservedIDs::Throttle2PositionId, pedal), t + 200);
+        comsSim.inject(makeWheelFrame(EcuIDs::FrontWheelSpeedId, 300, 300), t + 300);
+        comsSim.inject(makeWheelFrame(EcuIDs::RearWheelSpeedId, 300, 300), t + 400);
+        comsSim.inject(makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + 500);
+        comsSim.inject(makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0), t + 600);
+        motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 1050), t + 700);
+    }
+
+    // Foreign traffic: unrouted IDs spaced by their exact wire time for the requested load
+    uint32_t random = 0xA5A5F00D;
+    SimCanBus* buses[] = {&comsSim, &motorSim};
+    for(SimCanBus* bus : buses) {
+        uint64_t wireNs = 0;
+        while(wireNs < durationUs * 1000) {
+            CAN_message_t msg;
+            do {
+                msg.id = 0x100 + xorshift(random) % 0x600;
+            } while(ECU::getAcceptancePlan().accepts(msg.id));
+            msg.len = 8;
+            for(uint8_t i = 0; i < msg.len; i++) {
+                msg.buf[i] = xorshift(random) & 0xFF;
+            }
+            wireNs += static_cast<uint64_t>(StuffedFrameBits(msg) * 1e9 / BUSBENCH_BITRATE / foreignLoad);
+            bus->inject(msg, wireNs / 1000);
+        }
+    }
+
+    while(sim.clock.now() < durationUs) {
+        sim.clock.advance(LOOP_PERIOD_US);
+        comsSim.deliver(); // The controller's share of the work, not the ECU's
+        motorSim.deliver();
+        const auto start = std::chrono::steady_clock::now();
+        sim.ecu.run();
+        result.runNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        result.passes++;
+    }
+    sim.finish();
+    result.framesRead = sim.ecu.getComsRxStats().framesRead + sim.ecu.getMotorRxStats().framesRead;
+    result.budgetExhausted = sim.ecu.getComsRxStats().budgetExhausted + sim.ecu.getMotorRxStats().budgetExhausted;
+    result.filtered = comsSim.filtered() + motorSim.filtered();
+    result.rxDropped = comsSim.rxDropped() + motorSim.rxDropped();
+    return result;
+}
+
+static int runFilterBench(int argc, char** argv) {
+    const double seconds = (argc > 0 && argv[0][0] != '-') ? atof(argv[0]) : 10.0;
+    const uint64_t durationUs = static_cast<uint64_t>(seconds * 1e6);
+    const double load = atof(option(argc, argv, "--load", "0.8"));
+
+    const AcceptancePlan<CAN_ACCEPTANCE_FILTERS>& plan = ECU::getAcceptancePlan();
+    printf("acceptance plan: %u of %u filters, %u unrouted IDs let through\n", plan.count,
+           static_cast<unsigned>(CAN_ACCEPTANCE_FILTERS), plan.extraIds);
+    for(uint8_t i = 0; i < plan.count; i++) {
+        printf("  id 0x%03x mask 0x%03x (%u IDs)\n", plan.filters[i].id, plan.filters[i].mask, FilterSpan(plan.filters[i]));
+    }
+
+    FilterBenchResult results[2];
+    for(int filtered = 0; filtered < 2; filtered++) {
+        printf("== %s\n", filtered ? "filtered" : "promiscuous");
+        results[filtered] = simulateFilteredBus(filtered != 0, load, durationUs);
+    }
+    printf("%.0f %% foreign load on both buses, %.0f s\n", load * 100, seconds);
+    printf("%-12s %12s %10s %9s %11s %12s %10s\n", "mode", "ECU frames/s", "rejected/s", "rx drops", "over budget",
+           "ns/run()", "loop load");
+    for(int filtered = 0; filtered < 2; filtered++) {
+        const FilterBenchResult& r = results[filtered];
+        const double nsPerPass = r.runNs / r.passes;
+        printf("%-12s %12.0f %10.0f %9u %11u %12.1f %9.2f%%\n", filtered ? "filtered" : "promiscuous",
+               r.framesRead / seconds, r.filtered / seconds, r.rxDropped, r.budgetExhausted, nsPerPass,
+               nsPerPass / (LOOP_PERIOD_US * 10.0));
+    }
+    const bool same = results[0].torque.size() == results[1].torque.size()
+        && std::equal(results[0].torque.begin(), results[0].torque.end(), results[1].torque.begin(),
+                      [](const CAN_message_t& a, const CAN_message_t& b) { return memcmp(a.buf, b.buf, 8) == 0; });
+    printf("torque commands: %zu, %s\n", results[1].torque.size(), same ? "identical in both runs" : "DIFFER");
+    return same ? 0 : 1;
+}
+
+static int runReplay(int argc, char** argv) {
+    if(argc < 1) {
+        fprintf(stderr, "replay needs a trace file\n");
+        return 2;
+    }
+    const char* comsInterface = option(argc, argv, "--coms", "can0");
+    const char* motorInterface = option(argc, argv, "--motor", "can1");
+    const char* goldenPath = option(argc, argv, "--golden", nullptr);
+    const char* recordPath = option(argc, argv, "--record", nullptr);
+
+    std::vector<TraceRecord> input;
+    if(!LoadTrace(argv[0], input, comsInterface, motorInterface)) {
+        fprintf(stderr, "cannot read %s\n", argv[0]);
+        return 2;
+    }
+    std::vector<TraceRecord> golden;
+    if(goldenPath != nullptr && !LoadTrace(goldenPath, golden, comsInterface, motorInterface)) {
+        fprintf(stderr, "cannot read %s\n", goldenPath);
+        return 2;
+    }
+    TraceWriter recorder;
+    if(recordPath != nullptr && !recorder.open(recordPath)) {
+        fprintf(stderr, "cannot write %s\n", recordPath);
+        return 2;
+    }
+
+    ReplayOptions options;
+    options.realTime = flag(argc, argv, "--realtime");
+    ReplayEngine engine(options);
+    std::vector<TraceRecord> output;
+    ReplayReport report = engine.run(input, output, (recordPath != nullptr) ? &recorder : nullptr);
+
+    while(BinaryLog::flush(UINT16_MAX) > 0) {
+    }
+    printf("replayed %llu frames (%.2f s of bus time) in %.3f s wall -> %.0f frames/s, %.0fx real time\n",
+           static_cast<unsigned long long>(report.framesIn), report.simSeconds, report.wallSeconds,
+           report.framesIn / report.wallSeconds, report.simSeconds / report.wallSeconds);
+    printf("ECU sent %llu frames, %u RX drops\n", static_cast<unsigned long long>(report.framesOut),
+           report.rxDropped);
+
+    if(goldenPath == nullptr) {
+        return 0;
+    }
+    engine.compare(output, golden, report);
+    if(report.mismatches == 0) {
+        printf("golden: %u torque/fault frames match\n", report.checked);
+        return 0;
+    }
+    printf("golden: %u mismatches in %u compared torque/fault frames (first at #%lld)\n",
+           report.mismatches, report.checked, static_cast<long long>(report.firstMismatch));
+    return 1;
+}
+
+__attribute__((noinline)) static int32_t mapPedalOnce(const Throttle& throttle, int input) {
+    return throttle.mapPedal(input);
+}
+
+// TORQUEBENCH: PEDAL -> TORQUE PER SAMPLE, OLD map() AGAINST THE DRIVE-MODE TORQUE MAP
+// (test_control holds mapPedal() to map() and the curve to the 2D map; this only times them)
+static constexpr TorqueMap TORQUEBENCH_MAP = MakeTorqueMap({3100, 80000, 0}); // Full power mode
+
+__attribute__((noinline)) static int32_t emptyCallOnce(int32_t value) {
+    __asm__ volatile("" : "+r"(value)); // Opaque, so the call is not folded away
+    return value;
+}
+
+__attribute__((noinline)) static int32_t mapLookupOnce(const TorqueMap& map, int32_t pedal, int32_t rpm) {
+    return map.lookup(pedal, rpm);
+}
+
+__attribute__((noinline)) static int32_t curveLookupOnce(const TorqueCurve& curve, int32_t pedal) {
+    return curve.lookup(pedal);
+}
+
+__attribute__((noinline)) static void curveBuildOnce(TorqueCurve& curve, const TorqueMap& map, int32_t rpm) {
+    curve.build(map, rpm);
+}
+
+// Best of five runs of fn(i) over samples calls, in ns per call (the least disturbed run)
+template<typename Fn>
+static double nsPerCall(uint32_t samples, Fn fn) {
+    double best = 1e30;
+    for(int run = 0; run < 5; run++) {
+        const auto start = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < samples; i++) {
+            fn(i);
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best / samples;
+}
+
+static int runTorqueBench(int argc, char** argv) {
+    const uint32_t samples = (argc > 0 && argv[0][0] != '-') ? strtoul(argv[0], nullptr, 0) : 10000000;
+
+    // Random ADC readings and motor speeds over the whole map
+    std::vector<int> readings(4096);
+    std::vector<int32_t> speeds(4096);
+    uint32_t random = 0x600DF00D;
+    for(size_t i = 0; i < readings.size(); i++) {
+        readings[i] = xorshift(random) & 0x3FF;
+        speeds[i] = static_cast<int32_t>(xorshift(random) % (2 * TORQUE_MAP_SPEED_MAX)) - TORQUE_MAP_SPEED_MAX;
+    }
+    Throttle throttle; // Q12 pedal position, default calibration
+    TorqueCurve curve;
+    curve.build(TORQUEBENCH_MAP, 3000);
+
+    int64_t sink = 0;
+    const double callNs = nsPerCall(samples, [&](uint32_t i) { sink += emptyCallOnce(readings[i & 4095]); });
+    const double mapNs = nsPerCall(samples, [&](uint32_t i) { sink += teensyMap(readings[i & 4095], 8, 1023, 0, 3100); });
+    const double pedalNs = nsPerCall(samples, [&](uint32_t i) { sink += mapPedalOnce(throttle, readings[i & 4095]); });
+    const double lookupNs = nsPerCall(samples, [&](uint32_t i) {
+        sink += mapLookupOnce(TORQUEBENCH_MAP, readings[i & 4095] << 2, speeds[i & 4095]);
+    });
+    const double curveNs = nsPerCall(samples, [&](uint32_t i) { sink += curveLookupOnce(curve, readings[i & 4095] << 2); });
+    const double pathNs = nsPerCall(samples, [&](uint32_t i) {
+        sink += curveLookupOnce(curve, mapPedalOnce(throttle, readings[i & 4095]));
+    });
+    TorqueCurve rebuilt;
+    const double buildNs = nsPerCall(samples / 16, [&](uint32_t i) {
+        curveBuildOnce(rebuilt, TORQUEBENCH_MAP, speeds[i & 4095]);
+        sink += rebuilt.torque[i % TORQUE_MAP_PEDAL_POINTS];
+    });
+
+    printf("per pedal sample (random readings, checksum %lld):\n", static_cast<long long>(sink));
+    printf("  loop + empty call (floor)              %6.2f ns\n", callNs);
+    printf("  old map() to torque                    %6.2f ns\n", mapNs);
+    printf("  mapPedal() (Q12 pedal position)        %6.2f ns\n", pedalNs);
+    printf("  TorqueCurve::lookup()                  %6.2f ns\n", curveNs);
+    printf("  mapPedal() + TorqueCurve::lookup()     %6.2f ns\n", pathNs);
+    printf("  (TorqueMap::lookup(), speed included   %6.2f ns)\n", lookupNs);
+    printf("per motor speed change: TorqueCurve::build() %.2f ns\n", buildNs);
+    return 0;
+}
+
+// STREAMBENCH: StreamFilter COST PER SAMPLE (test_control checks each mode's step response)
+__attribute__((noinline)) static int filterOnce(StreamFilter<int, 8>& filter, int sample) {
+    return filter.update(sample);
+}
+
+static int runStreamBench(int argc, char** argv) {
+    const uint32_t samples = (argc > 0 && argv[0][0] != '-') ? strtoul(argv[0], nullptr, 0) : 10000000;
+    struct Case {
+        const char* name;
+        FilterConfig config;
+    };
+    const Case cases[] = {
+        {"average 1", {FilterMode::MovingAverage, 1}},
+        {"average 2", {FilterMode::MovingAverage, 2}},
+        {"average 4", {FilterMode::MovingAverage, 4}},
+        {"average 8", {FilterMode::MovingAverage, 8}},
+        {"ema 2", {FilterMode::Ema, 2}},
+        {"ema 4", {FilterMode::Ema, 4}},
+        {"ema 8", {FilterMode::Ema, 8}},
+        {"median 3", {FilterMode::Median, 3}},
+        {"median 5", {FilterMode::Median, 5}},
+        {"median 7", {FilterMode::Median, 7}},
+    };
+
+    std::vector<int> noise(4096);
+    uint32_t random = 0xF17E4;
+    for(int& sample : noise) {
+        sample = static_cast<int>(xorshift(random) & 0xFFF);
+    }
+    printf("%-10s %9s\n", "mode", "ns/sample");
+    for(const Case& test : cases) {
+        StreamFilter<int, 8> timed(test.config);
+        int64_t sink = 0;
+        const double ns = nsPerCall(samples, [&](uint32_t i) { sink += filterOnce(timed, noise[i & 4095]); });
+        printf("%-10s %9.2f\n", test.name, ns);
+        if(sink == 42) {
+            printf(" "); // Keeps the timed outputs live
+        }
+    }
+    return 0;
+}
+
+// TRACTIONBENCH: TractionControl ON SYNTHETIC WHEEL-SPIN TRACES, AND ITS COST PER CALL
+// (test_control holds each trace to its pass criteria; this reports them and times the calls)
+__attribute__((noinline)) static void wheelFrameOnce(TractionControl& traction, int16_t rear, uint32_t rxMicros) {
+    traction.setRearWheels(rear, rear, rxMicros);
+}
+
+__attribute__((noinline)) static void tractionStepOnce(TractionControl& traction) {
+    traction.update();
+}
+
+__attribute__((noinline)) static int32_t tractionLimitOnce(const TractionControl& traction, int32_t torque) {
+    return traction.limit(torque);
+}
+
+static int runTractionBench(int argc, char** argv) {
+    const uint32_t samples = (argc > 0 && argv[0][0] != '-') ? strtoul(argv[0], nullptr, 0) : 10000000;
+    struct Case {
+        const char* name;
+        SpinTrace trace;
+    };
+    const Case cases[] = {
+        {"grip", SpinTrace::Grip},
+        {"launch", SpinTrace::Launch},
+        {"oscillate", SpinTrace::Oscillate},
+        {"dropout", SpinTrace::Dropout},
+        {"queued", SpinTrace::Queued},
+    };
+
+    printf("%-10s %13s %10s %14s %13s %10s\n", "trace", "interventions", "min cap", "over -> cut", "-> full", "torque cut");
+    for(const Case& test : cases) {
+        const TractionResult result = runSpinTrace(test.trace);
+        char latency[16] = "-";
+        char recovered[16] = "-";
+        if(result.firstCutUs != 0 && result.firstOverUs != 0) {
+            snprintf(latency, sizeof(latency), "%.1f ms", (result.firstCutUs - result.firstOverUs) / 1000.0);
+        }
+        if(result.recoveredUs != 0) {
+            snprintf(recovered, sizeof(recovered), "%.2f s", result.recoveredUs / 1e6);
+        }
+        printf("%-10s %13u %9.1f%% %14s %13s %9.1f%%\n", test.name, result.interventions,
+               result.minCap * 100.0 / SLIP_ONE, latency, recovered, result.cutShare * 100);
+    }
+
+    // Cost on the oscillating trace, so the limiter keeps cutting and recovering
+    std::vector<int16_t> rears(4096);
+    for(size_t i = 0; i < rears.size(); i++) {
+        rears[i] = static_cast<int16_t>(300 * (1 + traceSlip(SpinTrace::Oscillate, (i % 150) * SENSOR_PERIOD_US)));
+    }
+    SimClock clock;
+    TractionControl traction(clock);
+    traction.setTargetSlip(SPIN_TARGET);
+    traction.setFrontWheels(300, 300, 0);
+    int64_t sink = 0;
+    const double frameNs = nsPerCall(samples, [&](uint32_t i) { wheelFrameOnce(traction, rears[i & 4095], 0); });
+    const double stepNs = nsPerCall(samples, [&](uint32_t i) {
+        wheelFrameOnce(traction, rears[(i >> 1) & 4095], 0);
+        tractionStepOnce(traction);
+        sink += traction.getTorqueCap();
+    });
+    const double limitNs = nsPerCall(samples, [&](uint32_t i) { sink += tractionLimitOnce(traction, i & 4095); });
+    printf("per call (oscillating spin, checksum %lld):\n", static_cast<long long>(sink));
+    printf("  wheel frame, setRearWheels() (slip ratio)   %6.2f ns\n", frameNs);
+    printf("  controller step, update() (+ wheel frame)   %6.2f ns\n", stepNs);
+    printf("  torque command, limit()                     %6.2f ns\n", limitNs);
+    return 0;
+}
+
+// IMUBENCH: ImuFusion COST PER UPDATE, AND ITS YAW RATE ON A RECORDED DRIVE
+// (test_control holds it to the synthetic drive's known truth)
+__attribute__((noinline)) static void imuUpdateOnce(ImuFusion& fusion, const ImuAxesMsg& rates, uint32_t rxMicros) {
+    fusion.updateGyro(rates.x * IMU_GYRO_SCALE, rates.y * IMU_GYRO_SCALE, rates.z * IMU_GYRO_SCALE, rxMicros);
+}
+
+// ns per gyro frame over the drive's own gyro frames, with the accel/wheel values as they were at the end
+static double imuNsPerUpdate(const std::vector<TraceRecord>& records, uint32_t samples) {
+    std::vector<ImuAxesMsg> rates;
+    for(const TraceRecord& record : records) {
+        if(record.id == EcuIDs::ImuGyroId && record.bus == TRACE_BUS_COMS) {
+            rates.push_back(ImuAxesMsg::decode(record.data));
+        }
+    }
+    ImuFusion fusion;
+    fuseImuFrames(records, fusion, [](uint32_t) {});
+    uint32_t rxMicros = 0;
+    const double ns = nsPerCall(samples, [&](uint32_t i) {
+        rxMicros += SENSOR_PERIOD_US;
+        imuUpdateOnce(fusion, rates[i % rates.size()], rxMicros);
+    });
+    if(fusion.getEstimate().heading > 100.0f) {
+        printf(" "); // Keeps the timed updates live
+    }
+    return ns;
+}
+
+// Recorded drive: there is no truth on the car, so the fused yaw rate is held against the front axle's
+static int checkRecordedImu(const char* path, uint32_t samples) {
+    std::vector<TraceRecord> records;
+    if(!LoadTrace(path, records)) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return 2;
+    }
+    std::vector<double> wheelYawRates; // Front axle yaw rate at each gyro frame
+    double wheelYawRate = 0;
+    for(const TraceRecord& record : records) {
+        if(record.bus != TRACE_BUS_COMS || (record.flags & TRACE_FLAG_TX) != 0) {
+            continue;
+        }
+        if(record.id == EcuIDs::FrontWheelSpeedId) {
+            const WheelSpeedMsg speeds = WheelSpeedMsg::decode(record.data);
+            wheelYawRate = (speeds.right - speeds.left) / IMU_DRIVE_RPM_PER_MPS / IMU_DRIVE_TRACK_M;
+        } else if(record.id == EcuIDs::ImuGyroId) {
+            wheelYawRates.push_back(wheelYawRate);
+        }
+    }
+    if(wheelYawRates.empty()) {
+        printf("%s: no IMU gyro frames (0x%03X)\n", path, EcuIDs::ImuGyroId);
+        return 1;
+    }
+
+    ImuFusion fusion;
+    double squareSum = 0;
+    uint32_t moving = 0;
+    fuseImuFrames(records, fusion, [&](uint32_t i) {
+        if(fusion.getEstimate().speed > 2.0f) { // MIN_FUSION_SPEED_MPS in ImuFusion.cpp
+            const double error = fusion.getEstimate().yawRate - wheelYawRates[i];
+            squareSum += error * error;
+            moving++;
+        }
+    });
+    const ImuEstimate& estimate = fusion.getEstimate();
+    printf("%s: %zu gyro frames, %u while moving\n", path, wheelYawRates.size(), moving);
+    if(moving > 0) {
+        printf("  yaw rate against the front axle: %.3f deg/s rms\n", sqrt(squareSum / moving) * IMU_DRIVE_DEG);
+    }
+    printf("  at the end: roll %.2f deg, pitch %.2f deg, heading %.2f deg, slip angle %.2f deg\n",
+           estimate.roll * IMU_DRIVE_DEG, estimate.pitch * IMU_DRIVE_DEG, estimate.heading * IMU_DRIVE_DEG,
+           estimate.slipAngle * IMU_DRIVE_DEG);
+    printf("per gyro frame: ImuFusion::updateGyro() %.2f ns\n", imuNsPerUpdate(records, samples));
+    return 0;
+}
+
+static int runImuBench(int argc, char** argv) {
+    const uint32_t samples = (argc > 0 && argv[0][0] != '-') ? strtoul(argv[0], nullptr, 0) : 2000000;
+    const char* tracePath = option(argc, argv, "--trace", nullptr);
+    if(tracePath != nullptr) {
+        return checkRecordedImu(tracePath, samples);
+    }
+    std::vector<TraceRecord> records;
+    std::vector<ImuTruth> truth;
+    makeImuDrive(records, truth);
+    printf("synthetic 50 s drive (%zu gyro frames)\n", truth.size());
+    printf("per gyro frame: ImuFusion::updateGyro() %.2f ns\n", imuNsPerUpdate(records, samples));
+    return 0;
+}
+
+// ROUTEBENCH: THE BASELINE switch() ROUTER AGAINST THE DISPATCH TABLES
+// Both route ECU_ROUTED_IDS (the IDs the ECU route table is checked against), and every handler is
+// the same out-of-line function either way, so only the dispatch itself differs
+struct RouteBenchSink {
+    uint32_t calls = 0;
+    uint32_t sum = 0;
+};
+
+using RouteBenchHandler = void (*)(RouteBenchSink&, const CAN_message_t&);
+
+template<size_t Index>
+__attribute__((noinline)) static void routeBenchHandler(RouteBenchSink& sink, const CAN_message_t& msg) {
+    sink.calls++;
+    sink.sum += msg.buf[0] * (Index + 1);
+}
+
+constexpr size_t ROUTEBENCH_ROUTE_COUNT = sizeof(ECU_ROUTED_IDS) / sizeof(ECU_ROUTED_IDS[0]);
+
+// The ECU's routed IDs with a bench handler each in place of the ECU one
+template<typename Indices>
+struct RouteBenchRoutes;
+
+template<size_t... Index>
+struct RouteBenchRoutes<std::index_sequence<Index...>> {
+    static constexpr CanRoute<RouteBenchHandler> ROUTES[] = {{ECU_ROUTED_IDS[Index], &routeBenchHandler<Index>}...};
+};
+
+static constexpr const auto& ROUTEBENCH_ROUTES =
+    RouteBenchRoutes<std::make_index_sequence<ROUTEBENCH_ROUTE_COUNT>>::ROUTES;
+constexpr uint32_t ROUTEBENCH_BASE = MinRouteId(ROUTEBENCH_ROUTES, 0, EcuIDs::SchedulerStatsId);
+constexpr uint32_t ROUTEBENCH_DIAGNOSTIC_BASE = MinRouteId(ROUTEBENCH_ROUTES, EcuIDs::SchedulerStatsId);
+static constexpr CanDispatchTable<RouteBenchHandler,
+    MaxRouteId(ROUTEBENCH_ROUTES, 0, EcuIDs::SchedulerStatsId) - ROUTEBENCH_BASE + 1>
+    ROUTEBENCH_TABLE{ROUTEBENCH_ROUTES, ROUTEBENCH_BASE};
+static constexpr CanDispatchTable<RouteBenchHandler,
+    MaxRouteId(ROUTEBENCH_ROUTES, EcuIDs::SchedulerStatsId) - ROUTEBENCH_DIAGNOSTIC_BASE + 1>
+    ROUTEBENCH_DIAGNOSTIC_TABLE{ROUTEBENCH_ROUTES, ROUTEBENCH_DIAGNOSTIC_BASE};
+
+// A switch has to spell its cases out: one per entry of ECU_ROUTED_IDS
+#ifdef ECU_PROFILING
+static_assert(ROUTEBENCH_ROUTE_COUNT == 18, "ECU_ROUTED_IDS changed, update routeBySwitch");
+#else
+static_assert(ROUTEBENCH_ROUTE_COUNT == 17, "ECU_ROUTED_IDS changed, update routeBySwitch");
+#endif
+
+__attribute__((noinline)) static void routeBySwitch(RouteBenchSink& sink, const CAN_message_t& msg) {
+    switch(msg.id) {
+        case ECU_ROUTED_IDS[0]: routeBenchHandler<0>(sink, msg); break;
+        case ECU_ROUTED_IDS[1]: routeBenchHandler<1>(sink, msg); break;
+        case ECU_ROUTED_IDS[2]: routeBenchHandler<2>(sink, msg); break;
+        case ECU_ROUTED_IDS[3]: routeBenchHandler<3>(sink, msg); break;
+        case ECU_ROUTED_IDS[4]: routeBenchHandler<4>(sink, msg); break;
+        case ECU_ROUTED_IDS[5]: routeBenchHandler<5>(sink, msg); break;
+        case ECU_ROUTED_IDS[6]: routeBenchHandler<6>(sink, msg); break;
+        case ECU_ROUTED_IDS[7]: routeBenchHandler<7>(sink, msg); break;
+        case ECU_ROUTED_IDS[8]: routeBenchHandler<8>(sink, msg); break;
+        case ECU_ROUTED_IDS[9]: routeBenchHandler<9>(sink, msg); break;
+        case ECU_ROUTED_IDS[10]: routeBenchHandler<10>(sink, msg); break;
+        case ECU_ROUTED_IDS[11]: routeBenchHandler<11>(sink, msg); break;
+        case ECU_ROUTED_IDS[12]: routeBenchHandler<12>(sink, msg); break;
+        case ECU_ROUTED_IDS[13]: routeBenchHandler<13>(sink, msg); break;
+        case ECU_ROUTED_IDS[14]: routeBenchHandler<14>(sink, msg); break;
+        case ECU_ROUTED_IDS[15]: routeBenchHandler<15>(sink, msg); break;
+        case ECU_ROUTED_IDS[16]: routeBenchHandler<16>(sink, msg); break;
+#ifdef ECU_PROFILING
+        case ECU_ROUTED_IDS[17]: routeBenchHandler<17>(sink, msg); break;
+#endif
+        default: break;
+    }
+}
+
+__attribute__((noinline)) static void routeByTable(RouteBenchSink& sink, const CAN_message_t& msg) {
+    RouteBenchHandler handler = ROUTEBENCH_TABLE.lookup(msg.id);
+    if(handler == nullptr) {
+        handler = ROUTEBENCH_DIAGNOSTIC_TABLE.lookup(msg.id);
+    }
+    if(handler != nullptr) {
+        handler(sink, msg);
+    }
+}
+
+constexpr uint32_t ROUTEBENCH_STREAM = 4096;
+
+// Per-frame cost of the old switch and the dispatch tables over one mixed-ID stream
+static int runRouteBench(int argc, char** argv) {
+    const uint32_t frames = (argc > 0 && argv[0][0] != '-') ? strtoul(argv[0], nullptr, 0) : 50000000;
+    const uint32_t unroutedPercent = strtoul(option(argc, argv, "--unrouted", "20"), nullptr, 0);
+
+    // Routed IDs in random order (the sensors dominate the real mix, but the order is what
+    // defeats the branch predictor) and unrouted IDs from anywhere in the 11-bit range
+    std::vector<CAN_message_t> stream(ROUTEBENCH_STREAM);
+    uint32_t random = 0x2545F491;
+    const size_t routeCount = sizeof(ROUTEBENCH_ROUTES) / sizeof(ROUTEBENCH_ROUTES[0]);
+    for(CAN_message_t& msg : stream) {
+        msg.id = (xorshift(random) % 100 < unroutedPercent) ? xorshift(random) & 0x7FF
+                                                           : ROUTEBENCH_ROUTES[xorshift(random) % routeCount].id;
+        msg.len = 8;
+        msg.buf[0] = xorshift(random) & 0xFF;
+    }
+
+    RouteBenchSink bySwitch;
+    RouteBenchSink byTable;
+    double switchNs = 0;
+    double tableNs = 0;
+    // Alternate the two in rounds so frequency scaling hits both alike
+    const uint32_t rounds = 10;
+    for(uint32_t round = 0; round < rounds; round++) {
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < frames / rounds; i++) {
+            routeBySwitch(bySwitch, stream[i & (ROUTEBENCH_STREAM - 1)]);
+        }
+        switchNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < frames / rounds; i++) {
+            routeByTable(byTable, stream[i & (ROUTEBENCH_STREAM - 1)]);
+        }
+        tableNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const uint32_t timed = frames / rounds * rounds;
+    printf("%zu routed IDs, %u %% unrouted frames, %u frames\n", routeCount, unroutedPercent, timed);
+    printf("switch: %.2f ns/frame, %u handled\n", switchNs / timed, bySwitch.calls);
+    printf("table:  %.2f ns/frame, %u handled\n", tableNs / timed, byTable.calls);
+    if(bySwitch.calls != byTable.calls || bySwitch.sum != byTable.sum) {
+        printf("MISMATCH: the two routers handled different frames\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1 && strcmp(argv[1], "replay") == 0) {
+        return runReplay(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "fdsim") == 0) {
+        return runFdSim(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "boxbench") == 0) {
+        return runBoxBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "busbench") == 0) {
+        return runBusBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "filterbench") == 0) {
+        return runFilterBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "torquebench") == 0) {
+        return runTorqueBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "streambench") == 0) {
+        return runStreamBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "tractionbench") == 0) {
+        return runTractionBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "imubench") == 0) {
+        return runImuBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "routebench") == 0) {
+        return runRouteBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "logbench") == 0) {
+        return runLogBench(argc - 2, argv + 2);
+    }
+    if(argc > 1 && strcmp(argv[1], "sim") == 0) {
+        return runSim(argc - 2, argv + 2);
+    }
+    return runSim(argc - 1, argv + 1);
+}
+
+#endif
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+#include "EcuFixture.h"
+#include "ImuFusion.h"
+#include "StreamFilter.h"
+#include "Throttle.h"
+#include "TorqueMap.h"
+
+// CONTROL BLOCKS ON THEIR OWN: PEDAL MAPPING, TORQUE CURVE, STREAM FILTER, TRACTION CONTROL, IMU FUSION
+// Each block is checked against a reference it must match (the map() it replaced, the full 2D map,
+// the theoretical step response, wheel-spin traces, a drive with known truth). Their cost per call is timed by the benchmarks in
+// src/native/main.cpp.
+
+void setUp() {}
+
+void tearDown() {}
+
+// PEDAL: Throttle::mapPedal() against the map() it replaced
+constexpr long PEDAL_SATURATION = UINT16_MAX; // mapPedal()'s clamp: Q16 product of 32 bits
+
+// Arduino's float map(), truncated like the int it was assigned to
+static long floatMap(long x, long inMin, long inMax, long outMin, long outMax) {
+    return static_cast<long>(static_cast<float>(x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin);
+}
+
+// Every ADC reading for each output scale and calibration is at most 1 count off map()
+static void test_map_pedal_matches_map() {
+    static const int SCALES[] = {PEDAL_FULL_SCALE, 3100, 2200, 1550, 620, 1}; // Q12 position, then Nm*10
+    static const int CALIBRATIONS[][2] = {{8, 1023}, {4, 1023}, {0, 1023}, {100, 900}, {300, 700}, {500, 520},
+                                          {1000, 1023}, {8, 9}};
+
+    long worstInt = 0;
+    long worstFloat = 0;
+    long worstSaturated = LONG_MAX; // Least margin past full scale of a clamped reading
+    uint32_t saturated = 0;
+    for(const int scale : SCALES) {
+        for(const auto& calibration : CALIBRATIONS) {
+            Throttle throttle;
+            throttle.setCalibrationValueMin(calibration[0], calibration[0]);
+            throttle.setCalibrationValueMax(calibration[1], calibration[1]);
+            throttle.setMaxTorque(scale);
+            for(int adc = 0; adc <= 1023; adc++) {
+                const long mapped = throttle.mapPedal(adc);
+                const long byInt = teensyMap(adc, calibration[0], calibration[1], 0, scale);
+                const long byFloat = floatMap(adc, calibration[0], calibration[1], 0, scale);
+                if(std::abs(byInt) > PEDAL_SATURATION) {
+                    // Far outside a narrow calibration: mapPedal() clamps, but must still read past full scale
+                    saturated++;
+                    worstSaturated = std::min(worstSaturated, ((byInt < 0) ? -mapped : mapped) - scale);
+                    continue;
+                }
+                worstInt = std::max(worstInt, std::abs(mapped - byInt));
+                // Past the calibrated travel the +1 branch and the float version disagree with each
+                // other by design, so the float one only counts inside it
+                if(adc >= calibration[0] && adc <= calibration[1]) {
+                    worstFloat = std::max(worstFloat, std::abs(mapped - byFloat));
+                }
+            }
+        }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(1, worstInt);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(1, worstFloat);
+    TEST_ASSERT_TRUE_MESSAGE(saturated == 0 || worstSaturated > 0, "clamped reading not past full scale");
+}
+
+// TORQUE CURVE: the per-speed curve gives exactly what the 2D map gives
+static constexpr TorqueMap FULL_POWER_MAP = MakeTorqueMap({3100, 80000, 0});
+
+static void test_torque_curve_matches_map() {
+    uint32_t mismatches = 0;
+    TorqueCurve curve;
+    for(int32_t rpm = -TORQUE_MAP_SPEED_MAX - 100; rpm <= TORQUE_MAP_SPEED_MAX + 100; rpm += 37) {
+        curve.build(FULL_POWER_MAP, rpm);
+        for(int32_t pedal = -10; pedal <= TORQUE_MAP_PEDAL_FULL_SCALE + 10; pedal++) {
+            mismatches += (curve.lookup(pedal) != FULL_POWER_MAP.lookup(pedal, rpm)) ? 1 : 0;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+}
+
+// STREAM FILTER: step response of each mode and window
+constexpr int32_t FILTER_STEP = 4096; // Full pedal travel (Q12)
+constexpr uint32_t FILTER_SETTLE = 64; // Samples after the step
+
+struct FilterCase {
+    FilterConfig config;
+    float expectedDelay; // Samples (sensor periods on the throttle): (N - 1) / 2 for the average and median, N - 1 for the EMA
+};
+
+// Group delay from the step response: the area between the step and the output, in samples
+// (exact for a linear filter at DC, and the delay to the jump for a median)
+static void checkStepResponse(const FilterCase& test) {
+    StreamFilter<int, 8> filter(test.config);
+    for(int i = 0; i < 16; i++) {
+        filter.update(0);
+    }
+    float area = 0;
+    int peak = 0;
+    int output = 0;
+    for(uint32_t k = 0; k < FILTER_SETTLE; k++) {
+        output = filter.update(FILTER_STEP);
+        area += 1.0f - static_cast<float>(output) / FILTER_STEP;
+        peak = std::max(peak, output);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, test.expectedDelay, area);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(FILTER_STEP, peak);
+    // The Q8 EMA stops a fraction of a count short of the step; everything else lands on it
+    TEST_ASSERT_INT32_WITHIN((test.config.mode == FilterMode::Ema) ? 1 : 0, FILTER_STEP, output);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(FILTER_STEP, output);
+}
+
+static void test_moving_average_step_response() {
+    checkStepResponse({{FilterMode::MovingAverage, 1}, 0.0f});
+    checkStepResponse({{FilterMode::MovingAverage, 2}, 0.5f});
+    checkStepResponse({{FilterMode::MovingAverage, 4}, 1.5f});
+    checkStepResponse({{FilterMode::MovingAverage, 8}, 3.5f});
+}
+
+static void test_ema_step_response() {
+    checkStepResponse({{FilterMode::Ema, 2}, 1.0f});
+    checkStepResponse({{FilterMode::Ema, 4}, 3.0f});
+    checkStepResponse({{FilterMode::Ema, 8}, 7.0f});
+}
+
+static void test_median_step_response() {
+    checkStepResponse({{FilterMode::Median, 3}, 1.0f});
+    checkStepResponse({{FilterMode::Median, 5}, 2.0f});
+    checkStepResponse({{FilterMode::Median, 7}, 3.0f});
+}
+
+// replace() must leave the filter exactly where an update() with the revised sample would have
+static void test_replace_revises_the_newest_sample() {
+    const FilterConfig configs[] = {{FilterMode::MovingAverage, 4}, {FilterMode::Ema, 4}, {FilterMode::Median, 5}};
+    for(const FilterConfig& config : configs) {
+        StreamFilter<int, 8> revised(config);
+        StreamFilter<int, 8> direct(config);
+        revised.update(0);
+        direct.update(0);
+        uint32_t random = 0x5EED;
+        for(uint32_t k = 0; k < 256; k++) {
+            const int first = static_cast<int>(xorshift(random) & 0xFFF);
+            const int later = static_cast<int>(xorshift(random) & 0xFFF);
+            revised.update(first);
+            TEST_ASSERT_EQUAL_INT32(direct.update(later), revised.replace(later));
+        }
+    }
+}
+
+// TRACTION CONTROL: the fixture's wheel-spin traces
+static void test_grip_never_cuts_torque() {
+    const TractionResult result = runSpinTrace(SpinTrace::Grip);
+    TEST_ASSERT_EQUAL_INT32(SPIN_TORQUE, result.maxLimited);
+    TEST_ASSERT_EQUAL_UINT32(0, result.interventions);
+    TEST_ASSERT_EQUAL_INT32(SLIP_ONE, result.minCap);
+}
+
+// First cut on the next step after the frame, full torque again once the spin is over
+static void checkSpinIsCut(SpinTrace trace) {
+    const TractionResult result = runSpinTrace(trace);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(SPIN_TORQUE, result.maxLimited);
+    TEST_ASSERT_TRUE(result.interventions >= 1);
+    TEST_ASSERT_TRUE_MESSAGE(result.firstCutUs != 0, "spin never cut");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(TRACTION_UPDATE_PERIOD_US, result.firstCutUs - result.firstOverUs);
+    TEST_ASSERT_TRUE_MESSAGE(result.recoveredUs != 0, "torque never handed back");
+}
+
+static void test_launch_spin_is_cut_on_the_next_step() {
+    checkSpinIsCut(SpinTrace::Launch);
+}
+
+static void test_oscillating_spin_is_cut_on_the_next_step() {
+    checkSpinIsCut(SpinTrace::Oscillate);
+}
+
+// Stale data must hand the full request back
+static void test_wheel_dropout_releases_the_cut() {
+    const TractionResult result = runSpinTrace(SpinTrace::Dropout);
+    TEST_ASSERT_EQUAL_UINT32(1, result.interventions);
+    TEST_ASSERT_TRUE_MESSAGE(result.recoveredUs != 0, "cut held after the wheel frames stopped");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(SPIN_STALE_US + TRACTION_UPDATE_PERIOD_US, result.recoveredUs - result.lastFrameUs);
+}
+
+// Every frame is past the stale limit by the time it is processed
+static void test_late_frames_never_cut_torque() {
+    const TractionResult result = runSpinTrace(SpinTrace::Queued);
+    TEST_ASSERT_EQUAL_UINT32(0, result.interventions);
+    TEST_ASSERT_EQUAL_INT32(SLIP_ONE, result.minCap);
+}
+
+// IMU FUSION: the synthetic drive with known truth
+// Accuracy limits (deg, deg/s)
+constexpr double IMU_MAX_TILT_ERROR = 0.5; // Parked and driving straight
+constexpr double IMU_MAX_YAW_RATE_RMS = 0.25; // Once the bias has been learned
+// After 30 s on the skidpad, as a share of the raw gyro's drift: the bias is learned against the front axle,
+// whose 1 rpm wheel speed steps are 1 deg/s of yaw rate, so a fraction of it stays
+constexpr double IMU_MAX_HEADING_SHARE = 0.25;
+constexpr double IMU_MAX_SLIDE_ERROR = 1.5; // Peak slip angle of the slide
+
+static double wrapAngle(double angle) {
+    return atan2(sin(angle), cos(angle));
+}
+
+static void test_imu_fusion_tracks_known_truth() {
+    std::vector<TraceRecord> records;
+    std::vector<ImuTruth> truth;
+    makeImuDrive(records, truth);
+
+    ImuFusion fusion;
+    double tiltError = 0; // Parked 3-5 s and straight 11-14 s, three time constants after each change
+    double yawSquareSum = 0;
+    uint32_t yawSamples = 0;
+    double headingStart = 0;
+    double headingEnd = 0;
+    double truthStart = 0;
+    double truthEnd = 0;
+    double slideEstimate = 0;
+    fuseImuFrames(records, fusion, [&](uint32_t i) {
+        const ImuTruth& at = truth[i];
+        const ImuEstimate& estimate = fusion.getEstimate();
+        if((at.seconds >= 3 && at.seconds < 5) || (at.seconds >= 11 && at.seconds < 14)) {
+            tiltError = std::max(tiltError, std::max(std::abs(estimate.roll - at.roll), std::abs(estimate.pitch - at.pitch)));
+        }
+        if(at.seconds >= 15 && at.seconds < 45) {
+            const double error = estimate.yawRate - at.yawRate;
+            yawSquareSum += error * error;
+            yawSamples++;
+            if(yawSamples == 1) {
+                headingStart = estimate.heading;
+                truthStart = at.heading;
+            }
+            headingEnd = estimate.heading;
+            truthEnd = at.heading;
+        }
+        if(at.seconds >= 46 && at.seconds < 48) {
+            slideEstimate = std::max(slideEstimate, static_cast<double>(estimate.slipAngle));
+        }
+    });
+
+    // Heading over the 30 s on the skidpad, wrapped: the car goes round about five times
+    const double headingError = std::abs(wrapAngle((headingEnd - headingStart) - (truthEnd - truthStart))) * IMU_DRIVE_DEG;
+    const double rawDrift = GYRO_Z_BIAS * 0.01 * 30;
+    const double yawRms = sqrt(yawSquareSum / yawSamples) * IMU_DRIVE_DEG;
+    char summary[160];
+    snprintf(summary, sizeof(summary), "tilt %.3f deg, yaw rate %.3f deg/s rms, heading %.3f deg (raw gyro %.1f), slide peak %.3f deg",
+             tiltError * IMU_DRIVE_DEG, yawRms, headingError, rawDrift, slideEstimate * IMU_DRIVE_DEG);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(tiltError * IMU_DRIVE_DEG <= IMU_MAX_TILT_ERROR, "roll/pitch off parked or straight");
+    TEST_ASSERT_TRUE_MESSAGE(yawRms <= IMU_MAX_YAW_RATE_RMS, "yaw rate off on the skidpad");
+    TEST_ASSERT_TRUE_MESSAGE(headingError <= rawDrift * IMU_MAX_HEADING_SHARE, "heading drifted on the skidpad");
+    TEST_ASSERT_TRUE_MESSAGE(std::abs(slideEstimate * IMU_DRIVE_DEG - IMU_DRIVE_SLIDE_DEG) <= IMU_MAX_SLIDE_ERROR,
+                             "slide peak slip angle off");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_map_pedal_matches_map);
+    RUN_TEST(test_torque_curve_matches_map);
+    RUN_TEST(test_moving_average_step_response);
+    RUN_TEST(test_ema_step_response);
+    RUN_TEST(test_median_step_response);
+    RUN_TEST(test_replace_revises_the_newest_sample);
+    RUN_TEST(test_grip_never_cuts_torque);
+    RUN_TEST(test_launch_spin_is_cut_on_the_next_step);
+    RUN_TEST(test_oscillating_spin_is_cut_on_the_next_step);
+    RUN_TEST(test_wheel_dropout_releases_the_cut);
+    RUN_TEST(test_late_frames_never_cut_torque);
+    RUN_TEST(test_imu_fusion_tracks_known_truth);
+    return UNITY_END();
+}
@@ -0,0 +1,487 @@
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <vector>
+#include <unity.h>
+#include "EcuFixture.h"
+
+// ECU BEHAVIOUR ON SIMULATED BUSES: START HORN, THROTTLE PAIRING, STALE THROTTLE, START SWITCH, DRIVE MODE,
+// DRAIN BUDGET
+// Each test drives one EcuFixture with the frames of every node and checks what the ECU sends back.
+
+void setUp() {}
+
+void tearDown() {}
+
+// HORN: frames that arrive while the start horn sounds are routed within one loop pass, like any other
+constexpr uint8_t SIM_HORN_PIN = 19; // HORN_PIN in ECU.cpp
+constexpr uint64_t HORN_TEST_US = 4000000; // Start at 0.5 s, horn until ~2.5 s
+// Longest a frame may wait to be read, horn or not: a tenth of the sensor period, so each frame is
+// handled long before its successor arrives. A loop that reads in the first pass after arrival
+// stays under one LOOP_PERIOD_US; the old delay(2000) horn held frames for up to 2 s.
+constexpr uint64_t HORN_READ_LIMIT_US = SENSOR_PERIOD_US / 10;
+static_assert(HORN_READ_LIMIT_US >= 10 * LOOP_PERIOD_US, "horn read bound leaves no margin over one loop pass");
+
+static void test_frames_are_read_during_the_horn() {
+    EcuFixture sim;
+
+    // Arrival times of the comsCAN frames not read yet: nothing is filtered, so frames are read in
+    // arrival order and (unread - pending) is how many the last pass read
+    std::multiset<uint64_t> arrivals;
+    auto feed = [&](const CAN_message_t& msg, uint64_t atUs) {
+        sim.comsSim.inject(msg, atUs);
+        arrivals.insert(atUs);
+    };
+    sim.setComsFeed(feed);
+    sim.boot();
+    sim.setStartSwitch(START_SWITCH_US);
+    // Every node's frames at 100 Hz with random phase (off the loop grid), brake held throughout
+    uint32_t random = 0x1234567;
+    for(uint64_t t = 0; t < HORN_TEST_US; t += SENSOR_PERIOD_US) {
+        feed(makeFrame(ReservedIDs::BrakePressureId, BRAKE_HELD), t + xorshift(random) % SENSOR_PERIOD_US);
+        feed(makeFrame(ReservedIDs::Throttle1PositionId, PEDAL_MIN), t + xorshift(random) % SENSOR_PERIOD_US);
+        feed(makeFrame(ReservedIDs::Throttle2PositionId, PEDAL_MIN), t + xorshift(random) % SENSOR_PERIOD_US);
+        feed(makeWheelFrame(EcuIDs::FrontWheelSpeedId, 0, 0), t + xorshift(random) % SENSOR_PERIOD_US);
+        feed(makeWheelFrame(EcuIDs::RearWheelSpeedId, 0, 0), t + xorshift(random) % SENSOR_PERIOD_US);
+        feed(makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + xorshift(random) % SENSOR_PERIOD_US);
+        feed(makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0), t + xorshift(random) % SENSOR_PERIOD_US);
+        sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 0), t);
+    }
+
+    uint64_t hornOnUs = 0;
+    uint64_t hornOffUs = 0;
+    uint32_t hornFrames = 0;
+    uint64_t worstHornUs = 0;
+    uint64_t worstOtherUs = 0;
+    uint32_t late = 0; // Passes that left an arrived frame unread
+    while(sim.clock.now() < HORN_TEST_US) {
+        sim.clock.advance(LOOP_PERIOD_US);
+        sim.ecu.run();
+        const bool horn = sim.gpio.level(SIM_HORN_PIN) != 0;
+        if(horn && hornOnUs == 0) {
+            hornOnUs = sim.clock.now();
+        } else if(!horn && hornOnUs != 0 && hornOffUs == 0) {
+            hornOffUs = sim.clock.now();
+        }
+
+        // Every frame read in this pass waited from its arrival until now
+        while(arrivals.size() > sim.comsSim.pending()) {
+            const uint64_t waitedUs = sim.clock.now() - *arrivals.begin();
+            arrivals.erase(arrivals.begin());
+            uint64_t& worst = horn ? worstHornUs : worstOtherUs;
+            worst = std::max(worst, waitedUs);
+            hornFrames += horn ? 1 : 0;
+        }
+        // Anything that had arrived by now and is still unread missed its pass
+        if(!arrivals.empty() && *arrivals.begin() <= sim.clock.now()) {
+            late++;
+        }
+    }
+    sim.finish();
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), "horn %.3f-%.3f s, %u frames during it, worst arrival-to-read %llu us (%llu us outside)",
+             hornOnUs / 1e6, hornOffUs / 1e6, hornFrames, static_cast<unsigned long long>(worstHornUs),
+             static_cast<unsigned long long>(worstOtherUs));
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE_MESSAGE(hornOnUs != 0 && hornOffUs != 0, "horn never sounded");
+    TEST_ASSERT_TRUE_MESSAGE(hornFrames > 0, "no frames arrived during the horn");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(HORN_READ_LIMIT_US, worstHornUs);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(HORN_READ_LIMIT_US, worstOtherUs);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, late, "passes left an arrived frame unread");
+    TEST_ASSERT_TRUE_MESSAGE(sim.ecu.isDriving(), "not driving after the horn");
+}
+
+// THROTTLE PAIRING: pedal frame -> torque command, with channel 2 a fixed time behind channel 1
+constexpr uint64_t PAIR_SKEW_US = 5000;
+constexpr uint32_t PAIR_WINDOW_US = 15000; // DEFAULT_THROTTLE_PAIR_WINDOW_US in ECU.cpp
+constexpr uint64_t PAIR_FIRST_STEP_US = BRAKE_RELEASE_US + 500000;
+constexpr uint64_t PAIR_STEP_US = 200000; // Pedal alternates between two levels this often
+constexpr uint64_t PAIR_END_US = 5000000;
+constexpr int32_t PAIR_PEDAL_LOW = 400;
+constexpr int32_t PAIR_PEDAL_HIGH = 700;
+// Paired, the first frame with the new reading changes the command in the pass that reads it; the
+// bound is a tenth of the sensor period like the horn's, well under PAIR_SKEW_US
+constexpr uint64_t PAIR_LATENCY_LIMIT_US = SENSOR_PERIOD_US / 10;
+static_assert(PAIR_LATENCY_LIMIT_US < PAIR_SKEW_US, "pairing latency bound does not tell the two policies apart");
+
+struct TorqueCommand {
+    uint64_t timeUs;
+    int16_t torque;
+};
+
+// Worst time from the first frame of a pedal step (channel 1) to the first torque command that changed
+static uint64_t simulatePairLatency(uint32_t pairWindowUs, uint32_t& steps) {
+    EcuFixture sim;
+    std::vector<TorqueCommand> commands;
+    sim.ecu.setThrottlePairWindow(pairWindowUs);
+    sim.boot();
+    sim.motorSim.onTransmit([&](const SimTxFrame& frame) {
+        const InverterCommandMsg command = InverterCommandMsg::decode(frame.msg.buf);
+        if(frame.msg.id == ReservedIDs::ControlCommandId && (command.enable & 1) != 0) {
+            commands.push_back({frame.timeUs, command.torque});
+        }
+    });
+    sim.setStartSwitch(START_SWITCH_US);
+    std::vector<uint64_t> stepFrames; // Channel 1's first frame at each new level
+    int32_t lastPedal = PEDAL_MIN;
+    for(uint64_t t = 0; t < PAIR_END_US; t += SENSOR_PERIOD_US) {
+        const int32_t pedal = (t < PAIR_FIRST_STEP_US) ? PEDAL_MIN
+            : (((t - PAIR_FIRST_STEP_US) / PAIR_STEP_US) % 2 == 0) ? PAIR_PEDAL_HIGH : PAIR_PEDAL_LOW;
+        if(pedal != lastPedal) {
+            stepFrames.push_back(t + 100);
+            lastPedal = pedal;
+        }
+        sim.comsSim.inject(makeFrame(ReservedIDs::BrakePressureId, (t >= BRAKE_RELEASE_US) ? BRAKE_RELEASED : BRAKE_HELD), t);
+        sim.comsSim.inject(makeFrame(ReservedIDs::Throttle1PositionId, pedal), t + 100);
+        sim.comsSim.inject(makeFrame(ReservedIDs::Throttle2PositionId, pedal), t + 100 + PAIR_SKEW_US);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::FrontWheelSpeedId, 300, 300), t + 300);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::RearWheelSpeedId, 300, 300), t + 400);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + 500);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0), t + 600);
+        sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 1050), t + 700);
+    }
+    sim.runUntil(PAIR_END_US);
+    sim.finish();
+    TEST_ASSERT_TRUE_MESSAGE(sim.ecu.isDriving(), "not driving");
+
+    uint64_t worst = 0;
+    steps = 0;
+    for(const uint64_t frameUs : stepFrames) {
+        // The command standing when the frame arrived, then the first one after it that differs
+        size_t i = 0;
+        while(i < commands.size() && commands[i].timeUs < frameUs) {
+            i++;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(i > 0 && i < commands.size(), "no torque commands around a pedal step");
+        const int16_t before = commands[i - 1].torque;
+        while(i < commands.size() && commands[i].torque == before) {
+            i++;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(i < commands.size(), "pedal step never changed the torque command");
+        worst = std::max(worst, commands[i].timeUs - frameUs);
+        steps++;
+    }
+    return worst;
+}
+
+static void test_paired_throttle_commands_on_the_first_frame() {
+    uint32_t steps = 0;
+    const uint64_t worst = simulatePairLatency(PAIR_WINDOW_US, steps);
+    char summary[100];
+    snprintf(summary, sizeof(summary), "pairing on: %u pedal steps, worst frame -> command %llu us", steps,
+             static_cast<unsigned long long>(worst));
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE(steps > 0);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PAIR_LATENCY_LIMIT_US, worst);
+}
+
+// Pairing off (window 0) waits for channel 2, so the command trails channel 1 by the skew
+static void test_unpaired_throttle_waits_for_both_channels() {
+    uint32_t steps = 0;
+    const uint64_t worst = simulatePairLatency(0, steps);
+    char summary[100];
+    snprintf(summary, sizeof(summary), "pairing off: %u pedal steps, worst frame -> command %llu us", steps,
+             static_cast<unsigned long long>(worst));
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_TRUE(steps > 0);
+    TEST_ASSERT_TRUE(worst >= PAIR_SKEW_US);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(PAIR_SKEW_US + PAIR_LATENCY_LIMIT_US, worst);
+}
+
+// STALE THROTTLE: last throttle frame -> stale fault and zero torque
+constexpr uint64_t STALE_SILENCE_US = 5000000; // Driving at a steady pedal by then
+constexpr uint64_t STALE_END_US = 5500000;
+constexpr int32_t STALE_PEDAL = 600;
+constexpr uint64_t STALE_PEDAL_US = BRAKE_RELEASE_US + 500000; // Pedal with the brake on would trip the override
+constexpr uint64_t STALE_TRIALS = 16; // Sensor phases spread over one period
+// THROTTLE_STALE_FAULT_US + TORQUE_REFRESH_PERIOD_US in ECU.cpp (the check runs in the torque task), plus a pass
+constexpr uint64_t STALE_LIMIT_US = 50000 + 10000 + LOOP_PERIOD_US;
+
+struct StaleResult {
+    uint64_t lastFrameUs = 0; // Last frame of the silenced channel
+    uint64_t faultUs = 0; // Stale fault frame on comsCAN, EcuFaultId since the dash has no code for it (0 = never)
+    uint64_t zeroTorqueUs = 0; // First zero torque command after the silence (0 = never)
+    uint32_t peakTorque = 0; // Before the silence: the cut must be from a real request
+    uint8_t faultCode = 0;
+};
+
+// phaseUs shifts every sensor frame against the ECU's task schedule
+static StaleResult simulateStaleThrottle(uint32_t channelId, uint64_t phaseUs) {
+    EcuFixture sim;
+    StaleResult result;
+    sim.onComsTransmit([&](const SimTxFrame& frame) {
+        if(frame.msg.id == EcuIDs::EcuFaultId && frame.timeUs >= STALE_SILENCE_US && result.faultUs == 0) {
+            result.faultUs = frame.timeUs;
+            result.faultCode = frame.msg.buf[0];
+        }
+    });
+    sim.boot();
+    sim.motorSim.onTransmit([&](const SimTxFrame& frame) {
+        const InverterCommandMsg command = InverterCommandMsg::decode(frame.msg.buf);
+        const uint32_t torque = static_cast<uint32_t>(command.torque);
+        if(frame.msg.id != ReservedIDs::ControlCommandId || (command.enable & 1) == 0) {
+            return; // Only torque commands, not the keep-alive ping
+        }
+        if(frame.timeUs < STALE_SILENCE_US) {
+            result.peakTorque = std::max(result.peakTorque, torque);
+        } else if(torque == 0 && result.zeroTorqueUs == 0) {
+            result.zeroTorqueUs = frame.timeUs;
+        }
+    });
+    sim.setStartSwitch(START_SWITCH_US);
+    for(uint64_t t = phaseUs; t < STALE_END_US; t += SENSOR_PERIOD_US) {
+        const bool released = t >= BRAKE_RELEASE_US;
+        sim.comsSim.inject(makeFrame(ReservedIDs::BrakePressureId, released ? BRAKE_RELEASED : BRAKE_HELD), t);
+        const uint32_t channels[] = {ReservedIDs::Throttle1PositionId, ReservedIDs::Throttle2PositionId};
+        for(uint8_t c = 0; c < 2; c++) {
+            const uint64_t at = t + 100 * (c + 1);
+            if(channels[c] == channelId && at >= STALE_SILENCE_US) {
+                continue;
+            }
+            if(channels[c] == channelId) {
+                result.lastFrameUs = at;
+            }
+            sim.comsSim.inject(makeFrame(channels[c], (t >= STALE_PEDAL_US) ? STALE_PEDAL : PEDAL_MIN), at);
+        }
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::FrontWheelSpeedId, 300, 300), t + 300);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::RearWheelSpeedId, 300, 300), t + 400);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + 500);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0), t + 600);
+        sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 1050), t + 700);
+    }
+    sim.runUntil(STALE_END_US);
+    sim.finish();
+    return result;
+}
+
+// A throttle channel that goes quiet while driving must fault and cut torque within the stale limit
+static void checkStaleChannel(uint32_t channel) {
+    uint64_t worstFault = 0;
+    uint64_t worstZero = 0;
+    for(uint64_t trial = 0; trial < STALE_TRIALS; trial++) {
+        const StaleResult result = simulateStaleThrottle(channel, trial * SENSOR_PERIOD_US / STALE_TRIALS + 7);
+        TEST_ASSERT_TRUE_MESSAGE(result.peakTorque > 0, "no torque before the silence");
+        TEST_ASSERT_TRUE_MESSAGE(result.faultUs != 0, "no stale fault");
+        TEST_ASSERT_TRUE_MESSAGE(result.zeroTorqueUs != 0, "torque never cut");
+        TEST_ASSERT_EQUAL_UINT8(EcuFaultIDs::ThrottleStaleFaultId, result.faultCode);
+        worstFault = std::max(worstFault, result.faultUs - result.lastFrameUs);
+        worstZero = std::max(worstZero, result.zeroTorqueUs - result.lastFrameUs);
+    }
+    char summary[120];
+    snprintf(summary, sizeof(summary), "throttle 0x%03X silent: last frame -> fault %.1f ms, -> zero torque %.1f ms (max)",
+             channel, worstFault / 1000.0, worstZero / 1000.0);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(STALE_LIMIT_US, worstFault);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(STALE_LIMIT_US, worstZero);
+}
+
+static void test_stale_throttle1_faults_and_cuts_torque() {
+    checkStaleChannel(ReservedIDs::Throttle1PositionId);
+}
+
+static void test_stale_throttle2_faults_and_cuts_torque() {
+    checkStaleChannel(ReservedIDs::Throttle2PositionId);
+}
+
+// START SWITCH: edges -> start, refusal and shutdown
+constexpr uint64_t START_TEST_END_US = 5000000;
+constexpr uint64_t START_NEVER = UINT64_MAX;
+
+struct StartScenario {
+    uint64_t brakeHeldUntilUs; // Brake pressed from 0 until then
+    uint64_t brakeHeldFromUs; // ...and again from then on (START_NEVER = not again)
+    uint64_t switchOnUs[2]; // Start switch flicked on (START_NEVER = unused)
+    uint64_t switchOffUs; // Flicked off in between
+    uint64_t throttleSilentUs; // Throttle 1 stops (heartbeat shutdown)
+};
+
+struct StartResult {
+    uint32_t refusals = 0; // StartFaultId frames
+    bool driving = false;
+};
+
+static StartResult simulateStart(const StartScenario& scenario) {
+    EcuFixture sim;
+    StartResult result;
+    sim.onComsTransmit([&](const SimTxFrame& frame) {
+        if(frame.msg.id == ReservedIDs::FaultId && frame.msg.buf[0] == FaultSourcesIDs::StartFaultId) {
+            result.refusals++;
+        }
+    });
+    sim.boot();
+    for(const uint64_t at : scenario.switchOnUs) {
+        if(at != START_NEVER) {
+            sim.setStartSwitch(at);
+        }
+    }
+    if(scenario.switchOffUs != START_NEVER) {
+        sim.setStartSwitch(scenario.switchOffUs, false);
+    }
+    for(uint64_t t = 0; t < START_TEST_END_US; t += SENSOR_PERIOD_US) {
+        const bool held = t < scenario.brakeHeldUntilUs || t >= scenario.brakeHeldFromUs;
+        sim.comsSim.inject(makeFrame(ReservedIDs::BrakePressureId, held ? BRAKE_HELD : BRAKE_RELEASED), t);
+        if(t < scenario.throttleSilentUs) {
+            sim.comsSim.inject(makeFrame(ReservedIDs::Throttle1PositionId, PEDAL_MIN), t + 100);
+        }
+        sim.comsSim.inject(makeFrame(ReservedIDs::Throttle2PositionId, PEDAL_MIN), t + 200);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::FrontWheelSpeedId, 0, 0), t + 300);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::RearWheelSpeedId, 0, 0), t + 400);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + 500);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0), t + 600);
+        sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 0), t + 700);
+    }
+    sim.runUntil(START_TEST_END_US);
+    sim.finish();
+    result.driving = sim.ecu.isDriving();
+    return result;
+}
+
+// A refused start is reported once per flick of the switch, and only then
+static void test_start_with_brake_held() {
+    const StartResult result = simulateStart({START_TEST_END_US, START_NEVER, {START_SWITCH_US, START_NEVER},
+                                              START_NEVER, START_NEVER});
+    TEST_ASSERT_EQUAL_UINT32(0, result.refusals);
+    TEST_ASSERT_TRUE(result.driving);
+}
+
+static void test_start_without_brake_is_refused_once() {
+    const StartResult result = simulateStart({0, START_NEVER, {START_SWITCH_US, START_NEVER}, START_NEVER,
+                                              START_NEVER});
+    TEST_ASSERT_EQUAL_UINT32(1, result.refusals);
+    TEST_ASSERT_FALSE(result.driving);
+}
+
+static void test_start_after_cycling_the_switch() {
+    const StartResult result = simulateStart({0, 1000000, {START_SWITCH_US, 1500000}, 1000000, START_NEVER});
+    TEST_ASSERT_EQUAL_UINT32(1, result.refusals);
+    TEST_ASSERT_TRUE(result.driving);
+}
+
+static void test_heartbeat_shutdown_with_switch_on() {
+    const StartResult result = simulateStart({BRAKE_RELEASE_US, START_NEVER, {START_SWITCH_US, START_NEVER},
+                                              START_NEVER, 3500000});
+    TEST_ASSERT_EQUAL_UINT32(0, result.refusals);
+    TEST_ASSERT_FALSE(result.driving);
+}
+
+// DRIVE MODE: the dash's DriveModeId frame picks the torque map the next commands use
+constexpr uint64_t MODE_PEDAL_US = BRAKE_RELEASE_US + 500000; // Full pedal from then on
+constexpr uint64_t MODE_SWITCH_US = 4000000; // Dash frame, well into full pedal
+constexpr uint64_t MODE_END_US = 4500000;
+constexpr uint32_t DEFAULT_MODE_TORQUE = 2200; // DEFAULT_DRIVE_MODE in ECU.cpp, until the dash picks one
+
+struct DriveModeResult {
+    uint32_t torqueBefore = 0; // Last torque command before the dash frame
+    uint32_t torqueAfter = 0; // Last one at the end
+    int mode = -1;
+};
+
+static DriveModeResult simulateDriveMode(int32_t mode) {
+    EcuFixture sim;
+    DriveModeResult result;
+    sim.boot();
+    sim.motorSim.onTransmit([&](const SimTxFrame& frame) {
+        const InverterCommandMsg command = InverterCommandMsg::decode(frame.msg.buf);
+        if(frame.msg.id != ReservedIDs::ControlCommandId || (command.enable & 1) == 0) {
+            return;
+        }
+        uint32_t& torque = (frame.timeUs < MODE_SWITCH_US) ? result.torqueBefore : result.torqueAfter;
+        torque = static_cast<uint32_t>(command.torque);
+    });
+    sim.setStartSwitch(START_SWITCH_US);
+    sim.comsSim.inject(makeFrame(ReservedIDs::DriveModeId, mode), MODE_SWITCH_US);
+    for(uint64_t t = 0; t < MODE_END_US; t += SENSOR_PERIOD_US) {
+        const int32_t pedal = (t >= MODE_PEDAL_US) ? PEDAL_MAX : PEDAL_MIN;
+        sim.comsSim.inject(makeFrame(ReservedIDs::BrakePressureId, (t >= BRAKE_RELEASE_US) ? BRAKE_RELEASED : BRAKE_HELD), t);
+        sim.comsSim.inject(makeFrame(ReservedIDs::Throttle1PositionId, pedal), t + 100);
+        sim.comsSim.inject(makeFrame(ReservedIDs::Throttle2PositionId, pedal), t + 200);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::FrontWheelSpeedId, 300, 300), t + 300);
+        sim.comsSim.inject(makeWheelFrame(EcuIDs::RearWheelSpeedId, 300, 300), t + 400);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuAccelId, 0, 0, ACCEL_Z_1G), t + 500);
+        sim.comsSim.inject(makeImuFrame(EcuIDs::ImuGyroId, 0, 0, 0), t + 600);
+        sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 1050), t + 700);
+    }
+    sim.runUntil(MODE_END_US);
+    sim.finish();
+    result.mode = sim.ecu.getDriveMode();
+    return result;
+}
+
+// Full pedal at 1050 rpm is below every mode's power limit, so the command is the mode's peak torque
+static void checkDriveMode(int32_t mode, int expectedMode, uint32_t expectedTorque) {
+    const DriveModeResult result = simulateDriveMode(mode);
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_MODE_TORQUE, result.torqueBefore);
+    TEST_ASSERT_EQUAL_INT32(expectedMode, result.mode);
+    TEST_ASSERT_EQUAL_UINT32(expectedTorque, result.torqueAfter);
+}
+
+static void test_drive_mode_full_beans() {
+    checkDriveMode(0, 0, 3100);
+}
+
+static void test_drive_mode_endurance() {
+    checkDriveMode(1, 1, 1550);
+}
+
+static void test_drive_mode_skidpad() {
+    checkDriveMode(2, 2, 620);
+}
+
+static void test_unknown_drive_mode_is_ignored() {
+    checkDriveMode(3, 0, DEFAULT_MODE_TORQUE);
+}
+
+// DRAIN BUDGET: a pass only counts as over budget when it actually leaves a frame unread
+constexpr uint16_t DRAIN_TEST_BUDGET = 4;
+
+static void injectMotorFrames(EcuFixture& sim, uint16_t count) {
+    for(uint16_t i = 0; i < count; i++) {
+        sim.motorSim.inject(makeWheelFrame(EcuIDs::InverterMotorPositionId, 0, 0));
+    }
+}
+
+static void test_drain_budget_counts_only_frames_left_unread() {
+    EcuFixture sim;
+    sim.boot();
+    sim.runUntil(START_SWITCH_US);
+    sim.ecu.setDrainBudget(DRAIN_TEST_BUDGET, UINT32_MAX);
+    const BusRxStats& motor = sim.ecu.getMotorRxStats();
+    const uint32_t readBefore = motor.framesRead;
+    TEST_ASSERT_EQUAL_UINT32(0, motor.budgetExhausted);
+
+    // Exactly the budget: the last read empties the queue, nothing is left behind
+    injectMotorFrames(sim, DRAIN_TEST_BUDGET);
+    sim.ecu.run();
+    TEST_ASSERT_EQUAL_UINT32(readBefore + DRAIN_TEST_BUDGET, motor.framesRead);
+    TEST_ASSERT_EQUAL_UINT32(0, motor.budgetExhausted);
+
+    // One over: the pass counts once, and the frame left behind is read first in the next pass
+    injectMotorFrames(sim, DRAIN_TEST_BUDGET + 1);
+    sim.ecu.run();
+    TEST_ASSERT_EQUAL_UINT32(readBefore + 2 * DRAIN_TEST_BUDGET, motor.framesRead);
+    TEST_ASSERT_EQUAL_UINT32(1, motor.budgetExhausted);
+    sim.ecu.run();
+    TEST_ASSERT_EQUAL_UINT32(readBefore + 2 * DRAIN_TEST_BUDGET + 1, motor.framesRead);
+    TEST_ASSERT_EQUAL_UINT32(1, motor.budgetExhausted);
+    TEST_ASSERT_EQUAL_UINT32(0, motor.ringDrops);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_are_read_during_the_horn);
+    RUN_TEST(test_paired_throttle_commands_on_the_first_frame);
+    RUN_TEST(test_unpaired_throttle_waits_for_both_channels);
+    RUN_TEST(test_stale_throttle1_faults_and_cuts_torque);
+    RUN_TEST(test_stale_throttle2_faults_and_cuts_torque);
+    RUN_TEST(test_start_with_brake_held);
+    RUN_TEST(test_start_without_brake_is_refused_once);
+    RUN_TEST(test_start_after_cycling_the_switch);
+    RUN_TEST(test_heartbeat_shutdown_with_switch_on);
+    RUN_TEST(test_drive_mode_full_beans);
+    RUN_TEST(test_drive_mode_endurance);
+    RUN_TEST(test_drive_mode_skidpad);
+    RUN_TEST(test_unknown_drive_mode_is_ignored);
+    RUN_TEST(test_drain_budget_counts_only_frames_left_unread);
+    return UNITY_END();
+}
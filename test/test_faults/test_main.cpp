@@ -0,0 +1,127 @@
+#include <unity.h>
+#include "EcuIDs.h"
+#include "FaultManager.h"
+#include "Reserved.h"
+
+// FaultManager BOOKKEEPING: EDGES, DE-DUPLICATION, RATE LIMITS, LATCHING AND WIRE CODES
+// Every case starts from a fresh manager with the default per-fault rate limits.
+
+void setUp() {}
+
+void tearDown() {}
+
+constexpr uint32_t FAULT_LIMIT_MS = 1000; // FAULT_SPECS rate limit of the non-latching faults
+
+// Only the rising edge asks for a frame; repeats while active are counted but stay quiet
+static void test_raise_reports_the_rising_edge_once() {
+    FaultManager faults;
+    TEST_ASSERT_TRUE(faults.raise(FaultThrottleMismatch, 100));
+    for(uint32_t t = 110; t < 5000; t += 10) {
+        TEST_ASSERT_FALSE(faults.raise(FaultThrottleMismatch, t));
+    }
+    const FaultRecord& record = faults.getRecord(FaultThrottleMismatch);
+    TEST_ASSERT_TRUE(faults.isActive(FaultThrottleMismatch));
+    TEST_ASSERT_EQUAL_UINT32(1u << FaultThrottleMismatch, faults.getActiveMask());
+    TEST_ASSERT_EQUAL_UINT32(100, record.firstSeenMs);
+    TEST_ASSERT_EQUAL_UINT32(4990, record.lastSeenMs);
+    TEST_ASSERT_EQUAL_UINT32(100, record.lastReportMs);
+    TEST_ASSERT_EQUAL_UINT32(490, record.count);
+    TEST_ASSERT_EQUAL_UINT32(490, faults.getOccurrences());
+    TEST_ASSERT_EQUAL_UINT8(FaultSourcesIDs::ThrottleMismatchId, faults.getLastCode());
+}
+
+static void test_clear_ends_the_fault() {
+    FaultManager faults;
+    faults.raise(FaultBrakeZero, 0);
+    faults.raise(FaultThrottleZero, 0);
+    faults.clear(FaultBrakeZero);
+    TEST_ASSERT_FALSE(faults.isActive(FaultBrakeZero));
+    TEST_ASSERT_TRUE(faults.isActive(FaultThrottleZero));
+    TEST_ASSERT_EQUAL_UINT32(1u << FaultThrottleZero, faults.getActiveMask());
+    TEST_ASSERT_EQUAL_UINT32(1, faults.getRecord(FaultBrakeZero).count); // History survives the clear
+}
+
+// A fault flapping faster than its rate limit costs one frame per window
+static void test_flapping_fault_is_rate_limited() {
+    FaultManager faults;
+    uint32_t frames = 0;
+    for(uint32_t t = 0; t < 10 * FAULT_LIMIT_MS; t += 20) {
+        frames += faults.raise(FaultThrottleStale, t) ? 1 : 0;
+        faults.clear(FaultThrottleStale);
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, frames);
+    TEST_ASSERT_EQUAL_UINT32(500, faults.getRecord(FaultThrottleStale).count);
+
+    faults.setRateLimit(FaultThrottleStale, 0);
+    TEST_ASSERT_TRUE(faults.raise(FaultThrottleStale, 10 * FAULT_LIMIT_MS));
+    faults.clear(FaultThrottleStale);
+    TEST_ASSERT_TRUE(faults.raise(FaultThrottleStale, 10 * FAULT_LIMIT_MS));
+}
+
+// The rate limit is per fault: one flapping source doesn't hide another's edge
+static void test_rate_limit_is_per_fault() {
+    FaultManager faults;
+    TEST_ASSERT_TRUE(faults.raise(FaultThrottleMismatch, 0));
+    faults.clear(FaultThrottleMismatch);
+    TEST_ASSERT_TRUE(faults.raise(FaultBrakeZero, 10));
+    TEST_ASSERT_FALSE(faults.raise(FaultThrottleMismatch, 20));
+    TEST_ASSERT_EQUAL_UINT8(FaultSourcesIDs::ThrottleMismatchId, faults.getLastCode());
+}
+
+// The start fault latches: clear() leaves it, reset() ends it
+static void test_latched_fault_needs_reset() {
+    FaultManager faults;
+    TEST_ASSERT_TRUE(faults.raise(FaultStartRefused, 0));
+    TEST_ASSERT_EQUAL_UINT32(1u << FaultStartRefused, faults.getLatchedMask());
+    faults.clear(FaultStartRefused);
+    TEST_ASSERT_TRUE(faults.isActive(FaultStartRefused));
+    TEST_ASSERT_FALSE(faults.raise(FaultStartRefused, 1000)); // Still active: no second frame
+
+    faults.reset(FaultStartRefused);
+    TEST_ASSERT_FALSE(faults.isActive(FaultStartRefused));
+    TEST_ASSERT_EQUAL_UINT32(0, faults.getLatchedMask());
+    TEST_ASSERT_TRUE(faults.raise(FaultStartRefused, 1000));
+}
+
+// Counters stop at the top instead of wrapping back to a small, harmless-looking number
+static void test_counts_saturate() {
+    FaultManager faults;
+    for(uint32_t i = 0; i < UINT16_MAX + 10u; i++) {
+        faults.raise(i % 2 ? FaultBrakeZero : FaultThrottleZero, i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(UINT16_MAX, faults.getOccurrences());
+    TEST_ASSERT_EQUAL_UINT32((UINT16_MAX + 11u) / 2, faults.getRecord(FaultThrottleZero).count); // Even raises
+
+    for(uint32_t i = 0; i < UINT16_MAX + 10u; i++) {
+        faults.raise(FaultNodeLost, i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(UINT16_MAX, faults.getRecord(FaultNodeLost).count);
+    TEST_ASSERT_EQUAL_UINT32(UINT16_MAX, faults.getOccurrences());
+}
+
+// Only the shared FaultSourcesIDs codes go to the dash; the ECU's own stay off FaultId
+static void test_only_shared_codes_reach_the_dash() {
+    for(uint8_t i = 0; i < FAULT_COUNT; i++) {
+        const FaultIndex fault = static_cast<FaultIndex>(i);
+        TEST_ASSERT_TRUE(FaultManager::code(fault) != 0);
+        TEST_ASSERT_TRUE(FaultManager::dashDecodes(fault) == (FaultManager::code(fault) < EcuFaultCodeBase));
+    }
+    TEST_ASSERT_TRUE(FaultManager::dashDecodes(FaultThrottleMismatch));
+    TEST_ASSERT_TRUE(FaultManager::dashDecodes(FaultBrakeZero));
+    TEST_ASSERT_TRUE(FaultManager::dashDecodes(FaultStartRefused));
+    TEST_ASSERT_FALSE(FaultManager::dashDecodes(FaultThrottleZero));
+    TEST_ASSERT_FALSE(FaultManager::dashDecodes(FaultThrottleStale));
+    TEST_ASSERT_FALSE(FaultManager::dashDecodes(FaultNodeLost));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_raise_reports_the_rising_edge_once);
+    RUN_TEST(test_clear_ends_the_fault);
+    RUN_TEST(test_flapping_fault_is_rate_limited);
+    RUN_TEST(test_rate_limit_is_per_fault);
+    RUN_TEST(test_latched_fault_needs_reset);
+    RUN_TEST(test_counts_saturate);
+    RUN_TEST(test_only_shared_codes_reach_the_dash);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <unity.h>
+#include "ECU.h"
+#include "SpscRing.h"
+
+// SpscRing UNDER REAL CONCURRENCY
+// A second thread pushes numbered frames while this one pops them. Every frame carries its push
+// attempt number in rxMicros, the ID and all 8 data bytes, so the consumer can tell a reordered,
+// duplicated, lost or torn (half-written) frame apart.
+constexpr double RING_TEST_SECONDS = 0.5; // Per case
+
+void setUp() {}
+
+void tearDown() {}
+
+static void fillRingFrame(RxFrame& frame, uint32_t attempt) {
+    frame.rxMicros = attempt;
+    frame.msg.id = attempt & 0x7FF;
+    frame.msg.len = 8;
+    for(uint8_t i = 0; i < 8; i++) {
+        frame.msg.buf[i] = static_cast<uint8_t>(attempt >> ((i & 3) * 8)) ^ i;
+    }
+}
+
+static bool ringFrameIntact(const RxFrame& frame) {
+    RxFrame expected;
+    fillRingFrame(expected, frame.rxMicros);
+    return frame.msg.id == expected.msg.id && frame.msg.len == 8
+        && memcmp(frame.msg.buf, expected.msg.buf, 8) == 0;
+}
+
+struct RingStressResult {
+    uint32_t attempts = 0;
+    uint32_t accepted = 0;
+    uint32_t received = 0;
+    uint32_t dropped = 0; // As counted by the ring
+    uint32_t errors = 0; // Frames out of order, torn or (lossless) missing
+    double seconds = 0;
+};
+
+// lossy: the producer moves on when the ring is full (like the ISR), else it retries until the
+// frame fits. burst: frames per burst before the producer pauses (0 = never pauses).
+static RingStressResult stressRing(bool lossy, uint32_t burst) {
+    std::unique_ptr<SpscRing<RxFrame, RX_RING_SIZE>> queue(new SpscRing<RxFrame, RX_RING_SIZE>());
+    SpscRing<RxFrame, RX_RING_SIZE>& ring = *queue;
+    RingStressResult result;
+    std::atomic<bool> producerDone{false};
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration<double>(RING_TEST_SECONDS);
+    std::thread producer([&]() {
+        RxFrame frame;
+        uint32_t attempt = 0;
+        uint32_t accepted = 0;
+        while(std::chrono::steady_clock::now() < end) {
+            for(uint32_t i = 0; i < (burst ? burst : 4096); i++) {
+                fillRingFrame(frame, ++attempt);
+                if(ring.push(frame)) {
+                    accepted++;
+                } else if(!lossy) {
+                    attempt--;
+                    std::this_thread::yield(); // Full: let the consumer run if it shares our core
+                }
+            }
+            if(burst) {
+                std::this_thread::yield();
+            }
+        }
+        result.attempts = attempt;
+        result.accepted = accepted;
+        producerDone.store(true, std::memory_order_release);
+    });
+
+    RxFrame frame;
+    uint32_t last = 0;
+    for(;;) {
+        const bool done = producerDone.load(std::memory_order_acquire);
+        if(ring.pop(frame)) {
+            // Attempt numbers only ever go up; without drops they go up by exactly one
+            if(!ringFrameIntact(frame) || frame.rxMicros <= last || (!lossy && frame.rxMicros != last + 1)) {
+                result.errors++;
+            }
+            last = frame.rxMicros;
+            result.received++;
+        } else if(done) {
+            break; // The producer finished before this empty pop, so nothing is left
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.dropped = ring.dropped();
+
+    char summary[120];
+    snprintf(summary, sizeof(summary), "%u frames in %.2f s (%.1f ns/frame), %u dropped", result.received,
+             result.seconds, result.seconds * 1e9 / result.received, result.attempts - result.accepted);
+    TEST_MESSAGE(summary);
+    return result;
+}
+
+static void test_lossless_flat_out() {
+    const RingStressResult result = stressRing(false, 0);
+    TEST_ASSERT_TRUE(result.received > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, result.errors);
+    TEST_ASSERT_EQUAL_UINT32(result.accepted, result.received);
+    TEST_ASSERT_EQUAL_UINT32(result.attempts, result.accepted);
+}
+
+static void test_lossy_flat_out() {
+    const RingStressResult result = stressRing(true, 0);
+    TEST_ASSERT_TRUE(result.received > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, result.errors);
+    TEST_ASSERT_EQUAL_UINT32(result.accepted, result.received);
+    TEST_ASSERT_EQUAL_UINT32(result.attempts - result.accepted, result.dropped);
+}
+
+// Bursts larger than the ring: drops must be counted exactly, and what got in must come out intact
+static void test_lossy_bursts_larger_than_the_ring() {
+    const RingStressResult result = stressRing(true, 300);
+    TEST_ASSERT_TRUE(result.received > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, result.errors);
+    TEST_ASSERT_EQUAL_UINT32(result.accepted, result.received);
+    TEST_ASSERT_EQUAL_UINT32(result.attempts - result.accepted, result.dropped);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_lossless_flat_out);
+    RUN_TEST(test_lossy_flat_out);
+    RUN_TEST(test_lossy_bursts_larger_than_the_ring);
+    return UNITY_END();
+}
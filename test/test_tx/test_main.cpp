@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <unity.h>
+#include <vector>
+#include "SimHal.h"
+#include "TxScheduler.h"
+
+// TxScheduler UNDER A SATURATED BUS: TORQUE COMMANDS AGAINST THEIR DEADLINE
+// A 100 Hz torque command goes through the control slot while the status and diagnostic classes
+// are refilled every service pass, faster than the bus can take them, so their queues stay full.
+
+void setUp() {}
+
+void tearDown() {}
+
+constexpr uint64_t TX_TEST_US = 2000000;
+constexpr uint64_t TX_SERVICE_US = 50; // One ECU loop pass
+constexpr uint64_t TX_COMMAND_US = 10000; // TORQUE_REFRESH_PERIOD_US in ECU.cpp
+constexpr uint32_t TX_COMMAND_ID = 0x0C0;
+constexpr size_t TX_CONTROLLER_RING = 16; // TX_SIZE_16, the FlexCAN_T4 TX ring in TeensyHal.h
+
+// Counts the frames the controller refused because its TX ring was full
+class RefusalCounter : public CanBus {
+    private:
+        SimCanBus& bus;
+
+    public:
+        uint32_t refused = 0;
+
+        explicit RefusalCounter(SimCanBus& busIn) : bus(busIn) {}
+
+        bool read(CAN_message_t& msg) override {
+            return bus.read(msg);
+        }
+
+        bool write(const CAN_message_t& msg) override {
+            const bool accepted = bus.write(msg);
+            refused += accepted ? 0 : 1;
+            return accepted;
+        }
+};
+
+struct TxDeadlineResult {
+    uint32_t commands = 0;
+    uint32_t onWire = 0; // Commands that reached the wire (the rest were replaced while waiting)
+    uint64_t worstUs = 0; // Command handed to the scheduler -> end of its frame on the wire
+    uint32_t classDrops = 0; // Status and diagnostic frames refused by their full class queues
+    uint32_t refused = 0; // Writes refused by the full controller ring
+};
+
+// wireFrameUs: how long each frame really takes (TX_FRAME_TIME_US unless other nodes win arbitration)
+static TxDeadlineResult simulateSaturatedBus(size_t controllerRing, uint32_t wireFrameUs) {
+    SimClock clock;
+    SimCanBus wire(clock);
+    wire.setTxQueue(controllerRing, wireFrameUs);
+    RefusalCounter controller(wire);
+    TxScheduler scheduler(clock);
+    scheduler.attach(controller);
+
+    TxDeadlineResult result;
+    std::vector<uint64_t> sentAt; // By command number
+    CAN_message_t filler;
+    filler.id = 0x400;
+    filler.len = 8;
+    for(uint64_t t = TX_SERVICE_US; t < TX_TEST_US; t += TX_SERVICE_US) {
+        clock.set(t);
+        while(scheduler.send(filler, TxStatus)) {
+        }
+        while(scheduler.send(filler, TxDiagnostic)) {
+        }
+        if(t % TX_COMMAND_US == 0) {
+            CAN_message_t command;
+            command.id = TX_COMMAND_ID;
+            command.len = 8;
+            command.buf[0] = result.commands & 0xFF;
+            command.buf[1] = (result.commands >> 8) & 0xFF;
+            sentAt.push_back(t);
+            result.commands++;
+            scheduler.sendLatest(command);
+        }
+        scheduler.service();
+    }
+    clock.set(TX_TEST_US + 100000); // Lets the controller finish what it holds
+    CAN_message_t unused;
+    wire.read(unused);
+
+    for(const SimTxFrame& frame : wire.transmitted()) {
+        if(frame.msg.id != TX_COMMAND_ID) {
+            continue;
+        }
+        const uint32_t number = frame.msg.buf[0] | (frame.msg.buf[1] << 8);
+        const uint64_t latency = frame.timeUs - sentAt[number];
+        result.worstUs = (latency > result.worstUs) ? latency : result.worstUs;
+        result.onWire++;
+    }
+    result.classDrops = scheduler.getStats(TxStatus).dropped + scheduler.getStats(TxDiagnostic).dropped;
+    result.refused = controller.refused;
+
+    char summary[160];
+    snprintf(summary, sizeof(summary), "%u commands, %u on the wire, worst %llu us; %u class drops, %u refused writes",
+             result.commands, result.onWire, static_cast<unsigned long long>(result.worstUs), result.classDrops,
+             result.refused);
+    TEST_MESSAGE(summary);
+    return result;
+}
+
+// Ahead of a command there are at most TX_IN_FLIGHT_LIMIT frames by the estimate, then its own
+// frame, and the scheduler only moves it on a service pass
+constexpr uint64_t TX_DEADLINE_US = (TX_IN_FLIGHT_LIMIT + 1) * TX_FRAME_TIME_US + TX_SERVICE_US;
+static_assert(TX_DEADLINE_US < TX_COMMAND_US / 4, "deadline leaves no margin before the next command");
+
+// Full class queues: the command still goes out within the deadline, every time
+static void test_control_deadline_with_full_class_queues() {
+    const TxDeadlineResult result = simulateSaturatedBus(TX_CONTROLLER_RING, TX_FRAME_TIME_US);
+    TEST_ASSERT_TRUE_MESSAGE(result.classDrops > 0, "class queues never filled");
+    TEST_ASSERT_EQUAL_UINT32(result.commands, result.onWire);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(TX_DEADLINE_US, result.worstUs);
+}
+
+// The wire at half the estimated rate (other nodes win arbitration): the estimate lets frames in
+// faster than they leave, the controller ring fills and write() refuses. What is ahead of a command
+// is then bounded by the ring, not the estimate.
+static void test_control_deadline_with_full_controller_ring() {
+    const uint32_t wireFrameUs = 2 * TX_FRAME_TIME_US;
+    const size_t ring = TX_IN_FLIGHT_LIMIT;
+    const TxDeadlineResult result = simulateSaturatedBus(ring, wireFrameUs);
+    TEST_ASSERT_TRUE_MESSAGE(result.refused > 0, "controller ring never filled");
+    TEST_ASSERT_EQUAL_UINT32(result.commands, result.onWire);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32((ring + 1) * wireFrameUs + TX_SERVICE_US, result.worstUs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_control_deadline_with_full_class_queues);
+    RUN_TEST(test_control_deadline_with_full_controller_ring);
+    return UNITY_END();
+}
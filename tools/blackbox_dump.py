@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Rebuild a black box snapshot from its CAN dump (0x7E6 frames) as an ECUTRACE file.
+
+Usage: blackbox_dump.py <candump log> <out.trace>
+
+Request the dump with `cansend can0 7E5#00` while `candump -L can0,7E6:7FF > dump.log` runs.
+Every frame is [uint16 index, 6 data bytes]. Frame 0 is [uint16 records, uint16 triggerIndex,
+reason, state]; the rest are the 20-byte TraceRecords back to back, oldest first.
+"""
+
+import struct
+import sys
+
+DATA_ID = 0x7E6
+RECORD_SIZE = 20
+HEADER = b"ECUTRACE" + struct.pack("<HHI", 1, RECORD_SIZE, 0)
+STATES = ["recording", "triggered", "frozen"]
+
+
+def read_frames(path):
+    """Yields the 8-byte payload of every DATA_ID frame in a candump -L log."""
+    with open(path) as log:
+        for line in log:
+            fields = line.split()
+            if len(fields) < 3 or "#" not in fields[2]:
+                continue
+            can_id, payload = fields[2].split("#", 1)
+            if int(can_id, 16) == DATA_ID and len(payload) == 16:
+                yield bytes.fromhex(payload)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 2
+
+    chunks = {}
+    for payload in read_frames(sys.argv[1]):
+        chunks[struct.unpack_from("<H", payload)[0]] = payload[2:]
+    if 0 not in chunks:
+        print("no dump header frame found")
+        return 1
+
+    records, trigger, reason, state = struct.unpack("<HHBB", chunks[0])
+    total = records * RECORD_SIZE
+    frames = (total + 5) // 6
+    missing = [i for i in range(1, frames + 1) if i not in chunks]
+    if missing:
+        print(f"{len(missing)} of {frames} data frames missing (first {missing[0]}), request the dump again")
+        return 1
+
+    data = b"".join(chunks[i] for i in range(1, frames + 1))[:total]
+    with open(sys.argv[2], "wb") as out:
+        out.write(HEADER + data)
+    state_name = STATES[state] if state < len(STATES) else str(state)
+    print(f"{records} records ({state_name}, reason {reason}, trigger at record {trigger}) to {sys.argv[2]}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
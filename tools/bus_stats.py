@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Print the ECU's bus analyzer snapshot from its CAN dump (0x7E8 frames).
+
+Usage: bus_stats.py <candump log> [--sort load|id|count]
+
+Request the dump with `cansend can0 7E7#00` (7E7#01 resets the counters) while
+`candump -L can0,7E8:7FF > dump.log` runs. Every frame is [slot, part, 6 data bytes].
+Slot 0xFF carries the bus summaries: part 3*bus is [u32 frames, u16 load of the last 100 ms],
+part 3*bus+1 is [u16 peak load, u16 average load, u16 untracked frames] (loads in 0.01 %),
+part 3*bus+2 is [u8 flags] (bit 0: acceptance filters on, so only routed IDs were counted and
+the load leaves out all other traffic).
+Other slots are one CAN ID each in five parts: [u32 key, u16 load], [u32 count, u8 dlc],
+[u32 mean gap, u16 jitter], [u32 min gap], [u32 max gap] (gaps in us). The key is
+id | extended << 29 | bus << 30.
+"""
+
+import struct
+import sys
+
+DATA_ID = 0x7E8
+SUMMARY_SLOT = 0xFF
+ID_PARTS = 5
+BUS_PARTS = 3
+FLAG_FILTERED = 0x01
+BUS_NAMES = ["coms", "motor"]
+
+
+def read_frames(path):
+    """Yields the 8-byte payload of every DATA_ID frame in a candump -L log."""
+    with open(path) as log:
+        for line in log:
+            fields = line.split()
+            if len(fields) < 3 or "#" not in fields[2]:
+                continue
+            can_id, payload = fields[2].split("#", 1)
+            if int(can_id, 16) == DATA_ID and len(payload) == 16:
+                yield bytes.fromhex(payload)
+
+
+def main():
+    args = sys.argv[1:]
+    sort = "load"
+    if "--sort" in args:
+        at = args.index("--sort")
+        sort = args[at + 1] if at + 1 < len(args) else sort
+        del args[at:at + 2]
+    if len(args) != 1 or sort not in ("load", "id", "count"):
+        print(__doc__)
+        return 2
+
+    summaries = {}
+    slots = {}
+    for payload in read_frames(args[0]):
+        slot, part = payload[0], payload[1]
+        if slot == SUMMARY_SLOT:
+            summaries[part] = payload[2:]
+        else:
+            slots.setdefault(slot, {})[part] = payload[2:]
+    if not summaries and not slots:
+        print("no bus stats frames found")
+        return 1
+
+    for bus, name in enumerate(BUS_NAMES):
+        first = BUS_PARTS * bus
+        if first not in summaries or first + 1 not in summaries:
+            continue
+        frames, last = struct.unpack_from("<IH", summaries[first])
+        peak, average, untracked = struct.unpack_from("<HHH", summaries[first + 1])
+        flags = summaries[first + 2][0] if first + 2 in summaries else 0
+        print(f"{name:5s}: {frames} frames, load {last / 100:.2f} % (last 100 ms), {average / 100:.2f} % average, "
+              f"{peak / 100:.2f} % peak" + (f", {untracked} frames of untracked IDs" if untracked else ""))
+        if flags & FLAG_FILTERED:
+            print("       filtered: routed IDs only, other traffic is not counted in the frames or the load")
+
+    rows = []
+    incomplete = 0
+    for parts in slots.values():
+        if len(parts) != ID_PARTS:
+            incomplete += 1
+            continue
+        key, load = struct.unpack_from("<IH", parts[0])
+        count, dlc = struct.unpack_from("<IB", parts[1])
+        mean, jitter = struct.unpack_from("<IH", parts[2])
+        minimum = struct.unpack_from("<I", parts[3])[0]
+        maximum = struct.unpack_from("<I", parts[4])[0]
+        rows.append((key >> 30, key & 0x1FFFFFFF, bool(key & (1 << 29)), load, count, dlc, mean, jitter, minimum,
+                     maximum))
+
+    order = {"load": lambda r: (r[0], -r[3]), "id": lambda r: (r[0], r[1]), "count": lambda r: (r[0], -r[4])}
+    rows.sort(key=order[sort])
+    print(f"\n{'bus':5s} {'id':>9s} {'dlc':>3s} {'count':>8s} {'rate':>9s} {'mean':>9s} {'jitter':>8s} "
+          f"{'min':>9s} {'max':>9s} {'load':>7s}")
+    for bus, can_id, extended, load, count, dlc, mean, jitter, minimum, maximum in rows:
+        name = BUS_NAMES[bus] if bus < len(BUS_NAMES) else str(bus)
+        ident = f"{can_id:08X}x" if extended else f"{can_id:03X}"
+        rate = f"{1e6 / mean:7.1f}Hz" if mean else "        -"
+        print(f"{name:5s} {ident:>9s} {dlc:3d} {count:8d} {rate} {mean:7d}us {jitter:6d}us {minimum:7d}us "
+              f"{maximum:7d}us {load / 100:6.2f}%")
+    if incomplete:
+        print(f"\n{incomplete} IDs incomplete (frames missing), request the dump again")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
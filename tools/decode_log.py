@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Decode framed BinaryLog records (firmware built with -D ECU_LOG_BINARY).
+
+Usage: decode_log.py <capture file | serial device>
+
+Each frame is two sync bytes (0xEC 0x10) followed by a 16-byte little-endian record:
+uint32 timestampUs, uint8 event, uint8 level, uint16 sequence, int32 a, int32 b.
+"""
+
+import struct
+import sys
+
+SYNC = b"\xec\x10"
+RECORD = struct.Struct("<IBBHii")
+
+# Same order as LogEvent in include/BinaryLog.h
+EVENT_NAMES = [
+    "T1",
+    "T2",
+    "MOTOR_COMMAND",
+    "MOTOR_START",
+    "INITIAL_START",
+    "START_ABORTED",
+    "START_FAULT",
+    "SHUTDOWN",
+    "BTO_SET",
+    "BTO_RELEASED",
+    "TC_START",
+    "TC_END",
+    "FAULT",
+    "NODE_LOST",
+    "NODE_BACK",
+]
+
+LEVEL_NAMES = ["DEBUG", "INFO", "WARN"]
+
+
+def decode(stream):
+    """Yields (record tuple, records lost before it) for every valid frame in the byte stream."""
+    data = b""
+    expected_sequence = None
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        data += chunk
+        while True:
+            start = data.find(SYNC)
+            if start < 0:
+                data = data[-1:]
+                break
+            if len(data) - start < len(SYNC) + RECORD.size:
+                data = data[start:]
+                break
+            record = RECORD.unpack_from(data, start + len(SYNC))
+            data = data[start + len(SYNC) + RECORD.size:]
+            sequence = record[3]
+            lost = 0 if expected_sequence is None else (sequence - expected_sequence) & 0xFFFF
+            expected_sequence = (sequence + 1) & 0xFFFF
+            yield record, lost
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+    total_lost = 0
+    with open(sys.argv[1], "rb") as stream:
+        for (timestamp, event, level, sequence, a, b), lost in decode(stream):
+            if lost:
+                total_lost += lost
+                print(f"-- {lost} record(s) dropped --")
+            name = EVENT_NAMES[event] if event < len(EVENT_NAMES) else f"EVENT_{event}"
+            level_name = LEVEL_NAMES[level] if level < len(LEVEL_NAMES) else str(level)
+            print(f"{timestamp / 1e6:12.6f} {level_name:5} {name:14} {a:8} {b:8}  #{sequence}")
+    if total_lost:
+        print(f"{total_lost} record(s) dropped in total", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,10 @@
+# PlatformIO post-build hook ([env:teensy41] extra_scripts): prints tools/section_sizes.py for the firmware
+Import("env")  # noqa: F821 (provided by SCons)
+
+env.AddPostAction(  # noqa: F821
+    "$BUILD_DIR/${PROGNAME}.elf",
+    env.VerboseAction(  # noqa: F821
+        '"$PYTHONEXE" "$PROJECT_DIR/tools/section_sizes.py" "$BUILD_DIR/${PROGNAME}.elf"',
+        "Section sizes per memory region",
+    ),
+)
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+"""Print the ECU's loop probes from its profile dump (0x7E2 frames, ECU_PROFILING builds).
+
+Usage: profile_dump.py <candump log> [--compare <candump log>]
+
+Request the dump with `cansend can0 7E1#00` while `candump -L can0,7E2:7FF > dump.log` runs.
+Every frame is [probe, part, 6 data bytes]. Parts 0-3 are u32 count, min, max and mean in CPU
+cycles (DWT CYCCNT, 600 MHz); the rest are the log2 histogram, three u16 bins per part.
+With --compare, the first log is the baseline and each probe's mean and max are shown against
+the second, e.g. a build before and after a code placement change under the same driving.
+"""
+
+import struct
+import sys
+
+DATA_ID = 0x7E2
+CPU_MHZ = 600
+SUMMARY_PARTS = 4
+BINS_PER_PART = 3
+PROBE_NAMES = ["run", "route", "updateThrottle", "sendMotorCommand", "traction", "imuFusion"]
+
+
+def read_frames(path):
+    """Yields the 8-byte payload of every DATA_ID frame in a candump -L log."""
+    with open(path) as log:
+        for line in log:
+            fields = line.split()
+            if len(fields) < 3 or "#" not in fields[2]:
+                continue
+            can_id, payload = fields[2].split("#", 1)
+            if int(can_id, 16) == DATA_ID and len(payload) == 16:
+                yield bytes.fromhex(payload)
+
+
+def read_probes(path):
+    """Returns {probe: (count, min, max, mean, histogram)} for the probes whose summary arrived."""
+    parts = {}
+    for payload in read_frames(path):
+        parts.setdefault(payload[0], {})[payload[1]] = payload[2:]
+    probes = {}
+    for probe, frames in parts.items():
+        if any(part not in frames for part in range(SUMMARY_PARTS)):
+            continue
+        count, minimum, maximum, mean = (struct.unpack_from("<I", frames[part])[0] for part in range(SUMMARY_PARTS))
+        histogram = []
+        for part in sorted(p for p in frames if p >= SUMMARY_PARTS):
+            histogram.extend(struct.unpack_from("<HHH", frames[part]))
+        probes[probe] = (count, minimum, maximum, mean, histogram)
+    return probes
+
+
+def name(probe):
+    return PROBE_NAMES[probe] if probe < len(PROBE_NAMES) else f"probe {probe}"
+
+
+def main():
+    args = sys.argv[1:]
+    compare = None
+    if "--compare" in args:
+        at = args.index("--compare")
+        compare = args[at + 1] if at + 1 < len(args) else None
+        del args[at:at + 2]
+        if compare is None:
+            print(__doc__)
+            return 2
+    if len(args) != 1:
+        print(__doc__)
+        return 2
+
+    probes = read_probes(args[0])
+    if not probes:
+        print("no profile frames found (built with -D ECU_PROFILING?)")
+        return 1
+
+    if compare is None:
+        print(f"{'probe':18s} {'calls':>10s} {'min':>8s} {'mean':>8s} {'max':>8s}  cycles ({CPU_MHZ} MHz), mean in ns")
+        for probe, (count, minimum, maximum, mean, histogram) in sorted(probes.items()):
+            if count == 0:
+                continue
+            print(f"{name(probe):18s} {count:10d} {minimum:8d} {mean:8d} {maximum:8d}  {mean * 1000 / CPU_MHZ:8.1f} ns")
+            # Bin n holds [2^(n-1), 2^n) cycles
+            busy = [(n, c) for n, c in enumerate(histogram) if c]
+            print("    " + "  ".join(f"<{1 << n}:{c}" for n, c in busy))
+        return 0
+
+    after = read_probes(compare)
+    print(f"{'probe':18s} {'mean':>17s} {'change':>8s} {'max':>17s}  cycles, {args[0]} -> {compare}")
+    for probe in sorted(set(probes) | set(after)):
+        if probe not in probes or probe not in after or probes[probe][0] == 0 or after[probe][0] == 0:
+            print(f"{name(probe):18s} missing in one of the dumps")
+            continue
+        mean0, mean1 = probes[probe][3], after[probe][3]
+        max0, max1 = probes[probe][2], after[probe][2]
+        print(f"{name(probe):18s} {mean0:8d} -> {mean1:6d} {(mean1 - mean0) * 100 / mean0:+7.1f}% "
+              f"{max0:8d} -> {max1:6d}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Report RAM and flash use per memory region of a firmware ELF, plus the largest symbols.
+
+Usage: section_sizes.py <firmware.elf> [--top N]
+
+Run after every Teensy build by tools/pio_section_sizes.py. On the Teensy 4.1 (i.MX RT1062) the
+sections are grouped by address into ITCM, DTCM, OCRAM (DMAMEM), flash and PSRAM (EXTMEM).
+ITCM is handed out in 32 KiB banks taken from the same 512 KiB as DTCM, so the DTCM line shows
+what is left for the stack after both. Any other ELF (e.g. the native build) is listed per section.
+"""
+
+import struct
+import subprocess
+import sys
+
+ARM = 40
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+STT_OBJECT = 1
+STT_FUNC = 2
+
+RAM1_SIZE = 512 * 1024
+ITCM_BANK = 32 * 1024
+
+# name, first address, size (i.MX RT1062 memory map as used by the Teensy 4.1 linker script)
+REGIONS = [
+    ("ITCM", 0x00000000, 512 * 1024),
+    ("DTCM", 0x20000000, 512 * 1024),
+    ("OCRAM", 0x20200000, 512 * 1024),
+    ("FLASH", 0x60000000, 7936 * 1024),
+    ("PSRAM", 0x70000000, 16 * 1024 * 1024),
+]
+
+
+def region_of(address):
+    for name, start, size in REGIONS:
+        if start <= address < start + size:
+            return name
+    return None
+
+
+def read_elf(path):
+    """Returns (machine, sections, symbols); sections are dicts, symbols (name, address, size, type)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[5] != 1:
+        raise SystemExit(f"{path}: not a little-endian ELF file")
+    is64 = data[4] == 2
+    if is64:
+        machine, = struct.unpack_from("<H", data, 18)
+        shoff, = struct.unpack_from("<Q", data, 40)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 58)
+        header = struct.Struct("<IIQQQQIIQQ")
+    else:
+        machine, = struct.unpack_from("<H", data, 18)
+        shoff, = struct.unpack_from("<I", data, 32)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 46)
+        header = struct.Struct("<IIIIIIIIII")
+
+    sections = []
+    for i in range(shnum):
+        name, kind, flags, addr, offset, size, link, _, _, entsize = header.unpack_from(data, shoff + i * shentsize)
+        sections.append({"name": name, "type": kind, "flags": flags, "addr": addr, "offset": offset,
+                         "size": size, "link": link, "entsize": entsize})
+    names = sections[shstrndx]
+    for section in sections:
+        start = names["offset"] + section["name"]
+        section["name"] = data[start:data.index(b"\0", start)].decode()
+
+    symbols = []
+    symtab = next((s for s in sections if s["name"] == ".symtab"), None)
+    if symtab is not None:
+        strtab = sections[symtab["link"]]
+        for off in range(symtab["offset"], symtab["offset"] + symtab["size"], symtab["entsize"]):
+            if is64:
+                name, info, _, _, value, size = struct.unpack_from("<IBBHQQ", data, off)
+            else:
+                name, value, size, info, _, _ = struct.unpack_from("<IIIBBH", data, off)
+            kind = info & 0xF
+            if size == 0 or kind not in (STT_OBJECT, STT_FUNC):
+                continue
+            start = strtab["offset"] + name
+            symbols.append((data[start:data.index(b"\0", start)].decode(), value, size, kind))
+    return machine, [s for s in sections if s["flags"] & SHF_ALLOC and s["size"] > 0], symbols
+
+
+def demangle(names):
+    try:
+        out = subprocess.run(["c++filt"], input="\n".join(names), capture_output=True, text=True, check=True)
+        return out.stdout.splitlines()
+    except (OSError, subprocess.CalledProcessError):
+        return names
+
+
+def kib(size):
+    return f"{size / 1024:8.1f} KiB"
+
+
+def print_top(title, symbols, top):
+    if not symbols or top == 0:
+        return
+    symbols = sorted(symbols, key=lambda s: s[2], reverse=True)[:top]
+    print(f"  largest in {title}:")
+    for name, (_, _, size, kind) in zip(demangle([s[0] for s in symbols]), symbols):
+        print(f"    {size:8d}  {'code' if kind == STT_FUNC else 'data'}  {name}")
+
+
+def report_teensy(sections, symbols, top):
+    used = {name: 0 for name, _, _ in REGIONS}
+    flash_images = 0  # Initialised RAM sections (ITCM code, .data) are copied from flash at boot
+    print(f"{'section':24s} {'region':6s} {'size':>12s}")
+    for section in sections:
+        region = region_of(section["addr"])
+        if region is None:
+            continue
+        used[region] += section["size"]
+        if region != "FLASH" and section["type"] != SHT_NOBITS:
+            flash_images += section["size"]
+        print(f"{section['name']:24s} {region:6s} {kib(section['size'])}")
+
+    itcm_banks = (used["ITCM"] + ITCM_BANK - 1) // ITCM_BANK
+    stack = RAM1_SIZE - itcm_banks * ITCM_BANK - used["DTCM"]
+    print()
+    print(f"ITCM  {kib(used['ITCM'])} code in {itcm_banks} x 32 KiB banks"
+          f" ({kib(itcm_banks * ITCM_BANK - used['ITCM']).strip()} padding)")
+    print(f"DTCM  {kib(used['DTCM'])} data/bss, {kib(stack).strip()} left for the stack")
+    print(f"OCRAM {kib(used['OCRAM'])} DMAMEM of {kib(512 * 1024).strip()} (heap gets the rest)")
+    print(f"FLASH {kib(used['FLASH'] + flash_images)} ({kib(flash_images).strip()} of it copied to RAM at boot)")
+    if used["PSRAM"]:
+        print(f"PSRAM {kib(used['PSRAM'])} EXTMEM")
+    for name in ("ITCM", "DTCM", "OCRAM"):
+        print_top(name, [s for s in symbols if region_of(s[1]) == name], top)
+    return 0 if stack > 0 else 1
+
+
+def report_generic(sections, symbols, top):
+    print(f"{'section':24s} {'size':>12s}")
+    for section in sections:
+        print(f"{section['name']:24s} {kib(section['size'])}")
+    print_top("the image", symbols, top)
+    return 0
+
+
+def main():
+    args = sys.argv[1:]
+    top = 10
+    if "--top" in args:
+        at = args.index("--top")
+        top = int(args[at + 1])
+        del args[at:at + 2]
+    if len(args) != 1:
+        print(__doc__)
+        return 2
+    machine, sections, symbols = read_elf(args[0])
+    if machine == ARM:
+        return report_teensy(sections, symbols, top)
+    return report_generic(sections, symbols, top)
+
+
+if __name__ == "__main__":
+    sys.exit(main())